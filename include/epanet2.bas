@@ -59,6 +59,7 @@ Public Const EN_PRICEPATTERN = 19
 Public Const EN_STATE = 20
 Public Const EN_CONST_POWER = 21
 Public Const EN_SPEED = 22
+Public Const EN_STATUSFLIPS = 23
 
 Public Const EN_DURATION = 0      ' Time parameters
 Public Const EN_HYDSTEP = 1
@@ -81,6 +82,24 @@ Public Const EN_RELATIVEERROR = 1
 Public Const EN_MAXHEADERROR = 2
 Public Const EN_MAXFLOWCHANGE = 3
 Public Const EN_MASSBALANCE = 4
+Public Const EN_SOLVERMEMORY = 5
+Public Const EN_NONZEROS = 6
+Public Const EN_FACTORFLOPS = 7
+Public Const EN_PCGITERATIONS = 8
+Public Const EN_FACTORIZATIONS = 9
+Public Const EN_FACTORUPDATES = 10
+Public Const EN_REFINEMENTS = 11
+Public Const EN_CORENODES = 12
+Public Const EN_BLOCKS = 13
+Public Const EN_SEPARATOR = 14
+Public Const EN_LOOPS = 15
+Public Const EN_TRIALSSAVED = 16
+Public Const EN_STEPCUTS = 17
+Public Const EN_HELDLINKS = 18
+Public Const EN_CACHEHITS = 19
+Public Const EN_CACHESTARTS = 20
+Public Const EN_CACHEHITRATE = 21
+Public Const EN_CACHEMEMORY = 22
 
 Public Const EN_NODECOUNT = 0     'Component counts
 Public Const EN_TANKCOUNT = 1
@@ -132,6 +151,18 @@ Public Const EN_CMD = 9
 Public Const EN_DDA = 0           ' Demand driven analysis
 Public Const EN_PDA = 1           ' Pressure driven analysis
 
+Public Const EN_CHOLESKY = 0      ' Hydraulic linear solvers
+Public Const EN_SUPERNODAL = 1
+Public Const EN_PCG = 2
+Public Const EN_SCHUR = 3
+
+Public Const EN_MMD = 0           ' Matrix re-orderings
+Public Const EN_ND = 1
+Public Const EN_AMD = 2
+
+Public Const EN_GGA = 0           ' Hydraulic solution engines
+Public Const EN_NULLSPACE = 1
+
 Public Const EN_TRIALS = 0       ' Misc. options
 Public Const EN_ACCURACY = 1
 Public Const EN_TOLERANCE = 2
@@ -141,6 +172,23 @@ Public Const EN_HEADERROR = 5
 Public Const EN_FLOWCHANGE = 6
 Public Const EN_DEMANDDEFPAT = 7
 Public Const EN_HEADLOSSFORM = 8
+Public Const EN_LINSOLVER = 9
+Public Const EN_THREADS = 10
+Public Const EN_ORDERING = 11
+Public Const EN_CHORDTOL = 12
+Public Const EN_MIXEDPRECISION = 13
+Public Const EN_SKELETONIZE = 14
+Public Const EN_BLOCKSOLVE = 15
+Public Const EN_SUBDOMAINS = 16
+Public Const EN_HYDENGINE = 17
+Public Const EN_SIMD = 18
+Public Const EN_PREDICTOR = 19
+Public Const EN_STEPCONTROL = 20
+Public Const EN_FLIPLIMIT = 21
+Public Const EN_CACHESIZE = 22
+Public Const EN_CACHETOL = 23
+Public Const EN_PCGLIMIT = 24
+Public Const EN_STATUSLISTS = 25
 
 Public Const EN_LOWLEVEL = 0     ' Control types
 Public Const EN_HILEVEL = 1
@@ -193,6 +241,7 @@ Public Const EN_CONDITIONAL = 1   ' Conditional object deletion
  Declare Function ENinitH Lib "epanet2.dll" (ByVal SaveFlag As Long) As Long
  Declare Function ENrunH Lib "epanet2.dll" (T As Long) As Long
  Declare Function ENnextH Lib "epanet2.dll" (Tstep As Long) As Long
+ Declare Function ENsolvedemands Lib "epanet2.dll" (ByVal Count As Long, Demands As Single, Heads As Single) As Long
  Declare Function ENcloseH Lib "epanet2.dll" () As Long
  Declare Function ENsavehydfile Lib "epanet2.dll" (ByVal F As String) As Long
  Declare Function ENusehydfile Lib "epanet2.dll" (ByVal F As String) As Long
@@ -124,7 +124,8 @@ typedef enum {
   EN_PRICEPATTERN = 19,
   EN_STATE        = 20,
   EN_CONST_POWER  = 21,
-  EN_SPEED        = 22
+  EN_SPEED        = 22,
+  EN_STATUSFLIPS  = 23  /**< Status reversals of the link in last hydraulic solution */
 } EN_LinkProperty;
 
 /// Time parameter codes
@@ -152,7 +153,25 @@ typedef enum {
   EN_RELATIVEERROR = 1,
   EN_MAXHEADERROR  = 2,
   EN_MAXFLOWCHANGE = 3,
-  EN_MASSBALANCE   = 4  
+  EN_MASSBALANCE   = 4,
+  EN_SOLVERMEMORY  = 5,  /**< Bytes held by the hydraulic linear solver */
+  EN_NONZEROS      = 6,  /**< Non-zero coeffs. in the factorized hydraulic matrix */
+  EN_FACTORFLOPS   = 7,  /**< Predicted flops to factorize the hydraulic matrix */
+  EN_PCGITERATIONS = 8,  /**< Conjugate gradient iterations of last hydraulic solution */
+  EN_FACTORIZATIONS = 9, /**< Matrix factorizations of last hydraulic solution */
+  EN_FACTORUPDATES = 10, /**< Rank-1 updates of kept factor in last hydraulic solution */
+  EN_REFINEMENTS   = 11, /**< Mixed precision refinement steps of last hydraulic solution */
+  EN_CORENODES     = 12, /**< Junctions left in the hydraulic matrix once tree branches are removed */
+  EN_BLOCKS        = 13, /**< Hydraulically independent blocks of junctions in the network */
+  EN_SEPARATOR     = 14, /**< Junctions in the separator between the Schur solver's subdomains */
+  EN_LOOPS         = 15, /**< Loop flows solved for by the null-space engine in last hydraulic solution */
+  EN_TRIALSSAVED   = 16, /**< Estimated trials saved by predicting the starting flows of the last time period */
+  EN_STEPCUTS      = 17, /**< Trials whose flow step was cut back by step control in last hydraulic solution */
+  EN_HELDLINKS     = 18, /**< Times a link was held at its status by the status reversal limit in last hydraulic solution */
+  EN_CACHEHITS     = 19, /**< Time periods so far whose hydraulic solution was taken from the solution cache */
+  EN_CACHESTARTS   = 20, /**< Time periods so far whose hydraulic solution was started from a cached one */
+  EN_CACHEHITRATE  = 21, /**< Percent of time periods so far that found a solution in the solution cache */
+  EN_CACHEMEMORY   = 22  /**< Bytes held by the hydraulic solution cache */
 } EN_AnalysisStatistic;
 
 typedef enum {
@@ -221,6 +240,24 @@ typedef enum {           /* Demand model types. */
   EN_PDA         = 1    /**< Pressure driven analysis */
 } EN_DemandModel;
 
+typedef enum {           /* Hydraulic linear solvers. */
+  EN_CHOLESKY    = 0,   /**< Column-by-column sparse Cholesky */
+  EN_SUPERNODAL  = 1,   /**< Supernodal sparse Cholesky */
+  EN_PCG         = 2,   /**< Incomplete Cholesky preconditioned conjugate gradient */
+  EN_SCHUR       = 3    /**< Subdomains factorized in parallel with a Schur complement separator */
+} EN_LinSolverType;
+
+typedef enum {           /* Hydraulic matrix re-orderings. */
+  EN_MMD         = 0,   /**< Multiple minimum degree */
+  EN_ND          = 1,   /**< Nested dissection */
+  EN_AMD         = 2    /**< Approximate minimum degree */
+} EN_OrderingType;
+
+typedef enum {           /* Hydraulic solution engines. */
+  EN_GGA         = 0,   /**< Global gradient algorithm (nodal heads) */
+  EN_NULLSPACE   = 1    /**< Null-space Newton method (loop flows) */
+} EN_HydEngineType;
+
 /// Simulation Option codes
 typedef enum {
   EN_TRIALS         = 0,
@@ -231,7 +268,24 @@ typedef enum {
   EN_HEADERROR      = 5,
   EN_FLOWCHANGE     = 6,
   EN_DEMANDDEFPAT   = 7,
-  EN_HEADLOSSFORM 	= 8
+  EN_HEADLOSSFORM 	= 8,
+  EN_LINSOLVER      = 9,   /**< Linear solver (see EN_LinSolverType) */
+  EN_THREADS        = 10,  /**< Threads used to factorize the hydraulic matrix (1 to 256) */
+  EN_ORDERING       = 11,  /**< Hydraulic matrix re-ordering (see EN_OrderingType) */
+  EN_CHORDTOL       = 12,  /**< 100 times the relative matrix coeff. change that makes a kept factor stale (0 = always re-factorize; experimental) */
+  EN_MIXEDPRECISION = 13,  /**< Single precision factor with iterative refinement (0 = off, 1 = on) */
+  EN_SKELETONIZE    = 14,  /**< Series junctions solved outside the hydraulic matrix (0 = off, 1 = on) */
+  EN_BLOCKSOLVE     = 15,  /**< Converged independent blocks held fixed while others iterate (0 = off, 1 = on) */
+  EN_SUBDOMAINS     = 16,  /**< Subdomains the hydraulic matrix is split into by the Schur solver */
+  EN_HYDENGINE      = 17,  /**< Hydraulic solution engine (see EN_HydEngineType) */
+  EN_SIMD           = 18,  /**< Pipe head loss coeffs. found with SIMD instructions when the CPU has them (0 = off, 1 = on) */
+  EN_PREDICTOR      = 19,  /**< Extrapolation of past flows that starts each time period (0 = off, 1 = linear, 2 = quadratic) */
+  EN_STEPCONTROL    = 20,  /**< Flow steps cut back while the convergence error fails to fall (0 = off, 1 = on) */
+  EN_FLIPLIMIT      = 21,  /**< Status reversals a link may make in one hydraulic solution before it is held (0 = no limit) */
+  EN_CACHESIZE      = 22,  /**< Time period solutions kept for reuse by periods with the same inputs (0 = none) */
+  EN_CACHETOL       = 23,  /**< Tank head change within which a cached solution is reused as it is */
+  EN_PCGLIMIT       = 24,  /**< Conjugate gradient iterations allowed per trial of the PCG solver (0 = twice the number of equations) */
+  EN_STATUSLISTS    = 25   /**< Status checked only for links whose status can change (0 = every link, 1 = on) */
 } EN_Option;
 
 typedef enum {
@@ -401,6 +455,19 @@ extern "C" {
    See ENsolveH() for an example.
    */
   int  DLLEXPORT ENnextH(long *tStep);
+
+  /**
+   @brief Find the heads of several sets of junction demands with one matrix factorization
+   @param count The number of demand scenarios
+   @param[in] demands The junction demands of each scenario (flow units), with demands[s*nNodes + i-1] holding node i's demand in scenario s (entries for tanks and reservoirs are ignored)
+   @param[out] heads The node heads of each scenario, stored in the same way as demands
+   @return Error code
+
+   The heads are found by linearizing the network equations about the current hydraulic solution,
+   as the next trial of ENrunH() would, so they are exact to first order in the demand changes.
+   Call this function after ENrunH(); it does not change the current solution.
+   */
+  int  DLLEXPORT ENsolvedemands(int count, EN_API_FLOAT_TYPE *demands, EN_API_FLOAT_TYPE *heads);
   
   
   /**
@@ -1347,6 +1414,7 @@ extern "C" {
   int DLLEXPORT EN_initH(EN_ProjectHandle ph, int saveFlag);
   int DLLEXPORT EN_runH(EN_ProjectHandle ph, long *currentTime);
   int DLLEXPORT EN_nextH(EN_ProjectHandle ph, long *tStep);
+  int DLLEXPORT EN_solvedemands(EN_ProjectHandle ph, int count, EN_API_FLOAT_TYPE *demands, EN_API_FLOAT_TYPE *heads);
   int DLLEXPORT EN_closeH(EN_ProjectHandle ph);
   int DLLEXPORT EN_savehydfile(EN_ProjectHandle ph, char *filename);
   int DLLEXPORT EN_usehydfile(EN_ProjectHandle ph, char *filename);
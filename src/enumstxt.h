@@ -78,6 +78,11 @@ char *DemandModelTxt[] = { w_DDA,
                            w_PDA,
                            NULL };
 
+char *OrderingTxt[]     = {w_MMD,
+                           w_ND,
+                           w_AMD,
+                           NULL};
+
 char *QualTxt[]         = {w_NONE,
                            w_CHEM,
                            w_AGE,
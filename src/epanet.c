@@ -236,6 +236,11 @@ int DLLEXPORT ENnextH(long *tstep) { return EN_nextH(_defaultModel, tstep); }
 
 int DLLEXPORT ENcloseH() { return EN_closeH(_defaultModel); }
 
+int DLLEXPORT ENsolvedemands(int count, EN_API_FLOAT_TYPE *demands,
+                             EN_API_FLOAT_TYPE *heads) {
+  return EN_solvedemands(_defaultModel, count, demands, heads);
+}
+
 int DLLEXPORT ENsavehydfile(char *filename) {
   return EN_savehydfile(_defaultModel, filename);
 }
@@ -1105,6 +1110,40 @@ int DLLEXPORT EN_nextH(EN_ProjectHandle ph, long *tstep) {
   return errcode;
 }
 
+int DLLEXPORT EN_solvedemands(EN_ProjectHandle ph, int count,
+                              EN_API_FLOAT_TYPE *demands,
+                              EN_API_FLOAT_TYPE *heads) {
+  int errcode, i, size;
+  double *d, *h;
+
+  EN_Project *p = (EN_Project*)ph;
+  double *Ucf = p->Ucf;
+
+  if (!p->hydraulics.OpenHflag)
+    return (103);
+  if (count < 1)
+    return (202);
+
+  size = count * p->network.Nnodes;
+  d = (double *)calloc(size, sizeof(double));
+  h = (double *)calloc(size, sizeof(double));
+  if (d == NULL || h == NULL)
+    errcode = 101;
+  else {
+    for (i = 0; i < size; i++)
+      d[i] = demands[i] / Ucf[FLOW];
+    errcode = demandheads(p, count, d, h);
+    if (!errcode)
+      for (i = 0; i < size; i++)
+        heads[i] = (EN_API_FLOAT_TYPE)(h[i] * Ucf[HEAD]);
+  }
+  free(d);
+  free(h);
+  if (errcode)
+    errmsg(p, errcode);
+  return errcode;
+}
+
 int DLLEXPORT EN_closeH(EN_ProjectHandle ph)
 {
   EN_Project *p = (EN_Project*)ph;
@@ -1537,6 +1576,57 @@ int DLLEXPORT EN_getoption(EN_ProjectHandle ph, EN_Option code,
   case EN_HEADLOSSFORM:
     v = hyd->Formflag;
     break;
+  case EN_LINSOLVER:
+    v = hyd->LinSolver;
+    break;
+  case EN_THREADS:
+    v = hyd->Threads;
+    break;
+  case EN_ORDERING:
+    v = hyd->Ordering;
+    break;
+  case EN_CHORDTOL:
+    v = hyd->ChordTol;
+    break;
+  case EN_MIXEDPRECISION:
+    v = hyd->MixedPrec;
+    break;
+  case EN_SKELETONIZE:
+    v = hyd->Skeletonize;
+    break;
+  case EN_BLOCKSOLVE:
+    v = hyd->BlockSolve;
+    break;
+  case EN_SUBDOMAINS:
+    v = hyd->Subdomains;
+    break;
+  case EN_HYDENGINE:
+    v = hyd->Engine;
+    break;
+  case EN_SIMD:
+    v = hyd->Simd;
+    break;
+  case EN_PREDICTOR:
+    v = hyd->Predictor;
+    break;
+  case EN_STEPCONTROL:
+    v = hyd->StepControl;
+    break;
+  case EN_FLIPLIMIT:
+    v = hyd->FlipLimit;
+    break;
+  case EN_CACHESIZE:
+    v = hyd->CacheSize;
+    break;
+  case EN_CACHETOL:
+    v = hyd->CacheTol * Ucf[HEAD];
+    break;
+  case EN_PCGLIMIT:
+    v = hyd->PcgLimit;
+    break;
+  case EN_STATUSLISTS:
+    v = hyd->StatusLists;
+    break;
 
   default:
     return (251);
@@ -1723,6 +1813,7 @@ int DLLEXPORT EN_setdemandmodel(EN_ProjectHandle ph, int type, EN_API_FLOAT_TYPE
     p->hydraulics.Pmin = pmin / p->Ucf[PRESSURE];
     p->hydraulics.Preq = preq / p->Ucf[PRESSURE];
     p->hydraulics.Pexp = pexp;
+    if (p->hydraulics.OpenHflag) setkernels(p);
 
     return (0);
 }
@@ -1957,6 +2048,65 @@ int DLLEXPORT EN_getstatistic(EN_ProjectHandle ph, int code, EN_API_FLOAT_TYPE *
   case EN_MASSBALANCE:
       *value = (EN_API_FLOAT_TYPE)(p->quality.massbalance.ratio);
       break;
+  case EN_SOLVERMEMORY:
+      *value = (EN_API_FLOAT_TYPE)sparsesize(p);
+      break;
+  case EN_NONZEROS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.Ncoeffs;
+      break;
+  case EN_FACTORFLOPS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Flops;
+      break;
+  case EN_PCGITERATIONS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Cgiter;
+      break;
+  case EN_FACTORIZATIONS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Nfactor;
+      break;
+  case EN_FACTORUPDATES:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Nupdate;
+      break;
+  case EN_REFINEMENTS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Nrefine;
+      break;
+  case EN_CORENODES:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Ncore;
+      break;
+  case EN_BLOCKS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Nblocks;
+      break;
+  case EN_SEPARATOR:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.solver.Nsep;
+      break;
+  case EN_LOOPS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.loops.Nloops;
+      break;
+  case EN_TRIALSSAVED:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.predictor.Saved;
+      break;
+  case EN_STEPCUTS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.StepCuts;
+      break;
+  case EN_HELDLINKS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.HeldLinks;
+      break;
+  case EN_CACHEHITS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.cache.Hits;
+      break;
+  case EN_CACHESTARTS:
+      *value = (EN_API_FLOAT_TYPE)p->hydraulics.cache.Starts;
+      break;
+  case EN_CACHEHITRATE:
+      *value = 0.0;
+      if (p->hydraulics.cache.Lookups > 0)
+      {
+          *value = (EN_API_FLOAT_TYPE)(100.0 * (p->hydraulics.cache.Hits +
+                   p->hydraulics.cache.Starts) / p->hydraulics.cache.Lookups);
+      }
+      break;
+  case EN_CACHEMEMORY:
+      *value = (EN_API_FLOAT_TYPE)cachesize(p);
+      break;
   default:
     break;
   }
@@ -2483,6 +2633,11 @@ int DLLEXPORT EN_getlinkvalue(EN_ProjectHandle ph, int index, EN_LinkProperty co
       }
       break;
 
+    case EN_STATUSFLIPS:
+      if (hyd->Flips != NULL)
+        v = hyd->Flips[index];
+      break;
+
     case EN_SETTING:
       if (Link[index].Type == EN_PIPE || Link[index].Type == EN_CVPIPE) {
         return EN_getlinkvalue(p, index, EN_ROUGHNESS, value);
@@ -2959,6 +3114,7 @@ int DLLEXPORT EN_setnodevalue(EN_ProjectHandle ph, int index, int code, EN_API_F
     if (value > 0.0)
       value = pow((Ucf[FLOW] / value), hyd->Qexp) / Ucf[PRESSURE];
     Node[index].Ke = value;
+    if (hyd->OpenHflag) setkernels(p);
     break;
 
   case EN_INITQUAL:
@@ -3826,6 +3982,151 @@ int DLLEXPORT EN_setoption(EN_ProjectHandle ph, int code, EN_API_FLOAT_TYPE v)
     strncpy(p->parser.DefPatID, tmpId, MAXID);
     hyd->DefPat = (int)value;
     break;
+  case EN_LINSOLVER:
+    if (value != floor(value))
+      return (213);
+    if (value < CHOLESKY || value > SCHUR)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->LinSolver = (int)value;
+    break;
+  case EN_THREADS:
+    if (value != floor(value))
+      return (213);
+    if (value < 1.0 || value > MAXTHREADS)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Threads = (int)value;
+    break;
+  case EN_ORDERING:
+    if (value != floor(value))
+      return (213);
+    if (value < MMD || value > AMD)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Ordering = (int)value;
+    break;
+  case EN_CHORDTOL:
+    if (value < 0.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->ChordTol = value;
+    break;
+  case EN_MIXEDPRECISION:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->MixedPrec = (int)value;
+    break;
+  case EN_SKELETONIZE:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Skeletonize = (int)value;
+    break;
+  case EN_BLOCKSOLVE:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->BlockSolve = (int)value;
+    break;
+  case EN_SUBDOMAINS:
+    if (value != floor(value))
+      return (213);
+    if (value < 2.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Subdomains = (int)value;
+    break;
+  case EN_HYDENGINE:
+    if (value != floor(value))
+      return (213);
+    if (value < GGA || value > NULLSPACE)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Engine = (int)value;
+    break;
+  case EN_SIMD:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Simd = (int)value;
+    break;
+  case EN_PREDICTOR:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0 && value != 2.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->Predictor = (int)value;
+    break;
+  case EN_STEPCONTROL:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->StepControl = (int)value;
+    break;
+  case EN_FLIPLIMIT:
+    if (value != floor(value))
+      return (213);
+    if (value < 0.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->FlipLimit = (int)value;
+    break;
+  case EN_CACHESIZE:
+    if (value != floor(value))
+      return (213);
+    if (value < 0.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->CacheSize = (int)value;
+    break;
+  case EN_CACHETOL:
+    if (value < 0.0)
+      return (202);
+    hyd->CacheTol = value / Ucf[HEAD];
+    break;
+  case EN_PCGLIMIT:
+    if (value != floor(value))
+      return (213);
+    if (value < 0.0)
+      return (202);
+    hyd->PcgLimit = (int)value;
+    break;
+  case EN_STATUSLISTS:
+    if (value != floor(value))
+      return (213);
+    if (value != 0.0 && value != 1.0)
+      return (202);
+    if (hyd->OpenHflag)
+      return (262);
+    hyd->StatusLists = (int)value;
+    break;
 
   default:
     return (251);
@@ -4228,6 +4529,8 @@ void initpointers(EN_Project *p)
   EN_Network *n = &p->network;
   parser_data_t *pars = &p->parser;
   solver_t *s = &p->hydraulics.solver;
+  loops_t *lp = &p->hydraulics.loops;
+  linkarrays_t *la = &p->hydraulics.links;
 
   hyd->NodeDemand = NULL;
   q->NodeQual = NULL;
@@ -4265,6 +4568,143 @@ void initpointers(EN_Project *p)
   s->XLNZ = NULL;
   s->NZSUB = NULL;
   s->LNZ = NULL;
+  s->Temp = NULL;
+  s->Link = NULL;
+  s->First = NULL;
+  s->Lsn = NULL;
+  s->Work = NULL;
+  s->Xsuper = NULL;
+  s->Snode = NULL;
+  s->Xblock = NULL;
+  s->Slink = NULL;
+  s->Sfirst = NULL;
+  s->Map = NULL;
+  s->Parent = NULL;
+  s->Nchild = NULL;
+  s->Pending = NULL;
+  s->Bad = NULL;
+  s->Xrow = NULL;
+  s->RowK = NULL;
+  s->RowPos = NULL;
+  s->Xtask = NULL;
+  s->Tcols = NULL;
+  s->Xfill = NULL;
+  s->NodeBlock = NULL;
+  s->LinkBlock = NULL;
+  s->Xbrow = NULL;
+  s->Frozen = NULL;
+  s->Bqsum = NULL;
+  s->Bdqsum = NULL;
+  s->Xdom = NULL;
+  s->Xif = NULL;
+  s->Ifrows = NULL;
+  s->Ifloc = NULL;
+  s->Xupd = NULL;
+  s->Upd = NULL;
+  s->Ywork = NULL;
+  s->Sdense = NULL;
+  s->Ncore = 0;
+  s->Nblocks = 0;
+  s->Nfrozen = 0;
+  s->Ndomains = 0;
+  s->Nsep = 0;
+  s->Nsuper = 0;
+  s->Nwork = 0;
+  s->Nthreads = 1;
+  s->Ntasks = 0;
+  s->Flops = 0.0;
+  s->Lic = NULL;
+  s->Dic = NULL;
+  s->Cgwork = NULL;
+  s->Cgiter = 0;
+  s->Adiag0 = NULL;
+  s->Lii = NULL;
+  s->Lij = NULL;
+  s->Aij0 = NULL;
+  s->Mpwork = NULL;
+  s->Fii = NULL;
+  s->Fij = NULL;
+  s->Ftemp = NULL;
+  s->Resid = NULL;
+  s->Nfactor = 0;
+  s->Nupdate = 0;
+  s->Nrefine = 0;
+  s->Mpfail = FALSE;
+  s->Chord = FALSE;
+  s->Chordstep = FALSE;
+  s->Refactor = FALSE;
+
+  lp->Ea = NULL;
+  lp->Eb = NULL;
+  lp->Esort = NULL;
+  lp->Set = NULL;
+  lp->Xtree = NULL;
+  lp->Tree = NULL;
+  lp->Parent = NULL;
+  lp->Pedge = NULL;
+  lp->Border = NULL;
+  lp->Cotree = NULL;
+  lp->G = NULL;
+  lp->G0 = NULL;
+  lp->Cur = NULL;
+  lp->Head = NULL;
+  lp->M = NULL;
+  lp->Xloop = NULL;
+  lp->Nedges = 0;
+  lp->Nloops = 0;
+  lp->Mcap = 0;
+  lp->Treeok = 0;
+
+  la->N1 = NULL;
+  la->N2 = NULL;
+  la->Pipe = NULL;
+  la->Other = NULL;
+  la->Checked = NULL;
+  la->Pvalves = NULL;
+  la->R = NULL;
+  la->Km = NULL;
+  la->Qa = NULL;
+  la->Erel = NULL;
+  la->Vd = NULL;
+  la->Q = NULL;
+  la->Pp = NULL;
+  la->Yp = NULL;
+  la->Npipes = 0;
+  la->Nother = 0;
+  la->Nchecked = 0;
+  la->Npvalves = 0;
+  la->Width = 1;
+  hyd->kernels.Pipecoeffs = NULL;
+  hyd->kernels.Pipecoeff = NULL;
+  hyd->kernels.Emittercoeffs = NULL;
+  hyd->kernels.Demandcoeffs = NULL;
+  hyd->kernels.Junctioncoeffs = NULL;
+  hyd->kernels.Emitter = NULL;
+  hyd->kernels.Nemitters = 0;
+  hyd->predictor.Q[0] = NULL;
+  hyd->predictor.Q[1] = NULL;
+  hyd->predictor.Q[2] = NULL;
+  hyd->predictor.E[0] = NULL;
+  hyd->predictor.E[1] = NULL;
+  hyd->predictor.E[2] = NULL;
+  hyd->predictor.Stat = NULL;
+  hyd->predictor.Nsame = NULL;
+  hyd->predictor.Nsaved = 0;
+  hyd->predictor.Saved = 0.0;
+  hyd->cache.Key = NULL;
+  hyd->cache.X = NULL;
+  hyd->cache.S = NULL;
+  hyd->cache.Used = NULL;
+  hyd->cache.Size = 0;
+  hyd->cache.Reused = FALSE;
+  hyd->cache.Lookups = 0;
+  hyd->cache.Hits = 0;
+  hyd->cache.Starts = 0;
+  hyd->StepCuts = 0;
+  hyd->Flips = NULL;
+  hyd->PrevStat = NULL;
+  hyd->Held = NULL;
+  hyd->HeldLinks = 0;
 
   n->NodeHashTable = NULL;
   n->LinkHashTable = NULL;
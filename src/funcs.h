@@ -140,6 +140,8 @@ int     writeresults(EN_Project *pr);               /* Writes node/link results
 void    writeheader(EN_Project *pr, int,int);       /* Writes heading on report   */
 void    writeline(EN_Project *pr, char *);          /* Writes line to report file */
 void    writerelerr(EN_Project *pr, int, double);   /* Writes convergence error   */
+void    writeordering(EN_Project *pr, int, int,     /* Writes re-ordering cost    */
+                      double);
 void    writestatchange(EN_Project *pr, int,char,char);   /* Writes link status change  */
 void    writecontrolaction(EN_Project *pr, int, int);     /* Writes control action taken*/
 void    writeruleaction(EN_Project *pr, int, char *);     /* Writes rule action taken   */
@@ -175,11 +177,16 @@ double  tankgrade(EN_Project *pr, int, double);     /* Finds tank grade from vol
 
 /* ----------- HYDSOLVER.C -  ----------*/
 int     hydsolve(EN_Project *pr, int *,double *);   /* Solves network equations   */
+int     demandheads(EN_Project *pr, int, double *,  /* Heads of several demand    */
+                    double *);                      /* scenarios at once          */
 
 /* ----------- HYDCOEFFS.C --------------*/
 void    resistcoeff(EN_Project *pr, int k);         /* Finds pipe flow resistance */
 void    headlosscoeffs(EN_Project *pr);             // Finds link head loss coeffs.
+void    loadlinkarrays(EN_Project *pr);             // Copies link data used by above
+void    setkernels(EN_Project *pr);                 // Selects coeff. kernels of a run
 void    matrixcoeffs(EN_Project *pr);               /* Finds hyd. matrix coeffs.  */
+void    trialcoeffs(EN_Project *pr);                // Both of above in one pass
 void    emitheadloss(EN_Project *pr, int,           // Finds emitter head loss
                      double *, double *);           
 double  demandflowchange(EN_Project *pr, int,       // Change in demand outflow
@@ -191,6 +198,32 @@ void    demandparams(EN_Project *pr, double *,      // PDA function parameters
 int     createsparse(EN_Project *pr);               /* Creates sparse matrix      */
 void    freesparse(EN_Project *pr);                 /* Frees matrix memory        */
 int     linsolve(EN_Project *pr, int);              /* Solves set of linear eqns. */
+int     linsolvemulti(EN_Project *pr, int, int,     /* Solves linear eqns. for    */
+                      double *);                    /* several r.h.s. at once     */
+double  sparsesize(EN_Project *pr);                 /* Solver memory in bytes     */
+
+/* ----------- HYDLOOPS.C --------------*/
+int     createloops(EN_Project *pr);                // Allocates null-space engine
+void    freeloops(EN_Project *pr);                  // Frees null-space engine
+int     loopsolve(EN_Project *pr);                  // Solves eqns. by loop flows
+
+/* ----------- HYDCACHE.C --------------*/
+int     createcache(EN_Project *pr);                // Allocates solution cache
+void    freecache(EN_Project *pr);                  // Frees solution cache
+void    clearcache(EN_Project *pr);                 // Empties solution cache
+int     usecached(EN_Project *pr);                  // Looks up current period
+void    savecached(EN_Project *pr, double);         // Caches current solution
+double  cachesize(EN_Project *pr);                  // Cache memory in bytes
+
+/* ----------- HYDSIMD.C ---------------*/
+int     simdwidth(void);                            // SIMD width of this CPU
+void    simdpipecoeffs(int width, int n, double hexp,
+                       double rq, double *flow, double *r,
+                       double *km, double *qa, double *p,
+                       double *y);                  // H-W & C-M pipe coeffs.
+void    simdDWcoeffs(int width, int n, double *flow,
+                     double *r, double *km, double *e,
+                     double *s, double *p, double *y); // D-W pipe coeffs.
 
 /* ----------- QUALITY.C ---------------*/
 int     openqual(EN_Project *pr);                   /* Opens WQ solver system     */
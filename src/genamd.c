@@ -0,0 +1,282 @@
+/*  APPROXIMATE MINIMUM DEGREE ROW RE-ORDERING ALGORITHM
+ *
+ *  Works with Fortran-style (1-based) arrays like genmmd.c.
+ *
+ */
+
+/*
+**  The graph is eliminated through its quotient graph: each
+**  eliminated node becomes an "element" holding the list of
+**  un-eliminated nodes it connects, so no fill is ever formed
+**  explicitly. Instead of the exact external degree of each node
+**  affected by an elimination, the upper bound of Amestoy, Davis
+**  and Duff (SIAM J. Matrix Anal. Appl. 17(4), 1996) is used,
+**  which only needs the size of each adjacent element outside of
+**  the new element. Elements that become subsets of the new element
+**  are absorbed into it. Supervariables are not detected since
+**  the nodes of water networks rarely become indistinguishable.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+int genamd(int neqns, int *xadj, int *adjncy, int *invp, int *perm);
+
+typedef struct          /* Growable list of node indexes */
+{
+    int *x;
+    int  n;
+    int  size;
+} List;
+
+static int  append(List *, int);
+static void insertnode(int, int, int *, int *, int *);
+static void removenode(int, int, int *, int *, int *);
+
+//=============================================================================
+
+int genamd(int neqns, int *xadj, int *adjncy, int *invp, int *perm)
+/*
+**--------------------------------------------------------------
+** Input:   neqns = number of equations
+**          xadj, adjncy = adjacency structure of the matrix
+** Output:  invp = position of each node in the new ordering
+**          perm = node at each position of the new ordering
+**          returns 0 if successful or 101 if out of memory
+** Purpose: finds an approximate minimum degree ordering
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, k, m, e, p, d, dmin, lpsize, nleft, deg;
+    int  errcode = 0;
+    List *A = NULL;          // Node lists of each un-eliminated node
+    List *E = NULL;          // Element lists of each un-eliminated node
+    List *L = NULL;          // Node list of each element
+    int  *degree = NULL;     // Approximate degree of each node
+    int  *head = NULL;       // First node of each degree
+    int  *next = NULL;       // Next node of the same degree
+    int  *prev = NULL;       // Previous node of the same degree
+    int  *status = NULL;     // 0 = node, 1 = element, 2 = absorbed
+    int  *mark = NULL;       // Marks nodes in the current element
+    int  *w = NULL;          // Size of each element outside of it
+
+    A = (List *) calloc(neqns+1, sizeof(List));
+    E = (List *) calloc(neqns+1, sizeof(List));
+    L = (List *) calloc(neqns+1, sizeof(List));
+    degree = (int *) calloc(neqns+1, sizeof(int));
+    head   = (int *) calloc(neqns+1, sizeof(int));
+    next   = (int *) calloc(neqns+1, sizeof(int));
+    prev   = (int *) calloc(neqns+1, sizeof(int));
+    status = (int *) calloc(neqns+1, sizeof(int));
+    mark   = (int *) calloc(neqns+1, sizeof(int));
+    w      = (int *) calloc(neqns+1, sizeof(int));
+    if (!A || !E || !L || !degree || !head || !next || !prev ||
+        !status || !mark || !w)
+    {
+        errcode = 101;
+        goto ENDAMD;
+    }
+
+    // Initialize node lists and degrees (self-loops are ignored)
+    for (i = 1; i <= neqns; i++)
+    {
+        for (m = xadj[i]; m < xadj[i+1]; m++)
+        {
+            j = adjncy[m];
+            if (j != i && !append(&A[i], j))
+            {
+                errcode = 101;
+                goto ENDAMD;
+            }
+        }
+        degree[i] = A[i].n < neqns ? A[i].n : neqns - 1;
+        insertnode(i, degree[i], head, next, prev);
+        w[i] = -1;
+    }
+
+    dmin = 0;
+    for (k = 1; k <= neqns; k++)
+    {
+        // Select the node p of least degree
+        while (head[dmin] == 0) dmin++;
+        p = head[dmin];
+        removenode(p, degree[p], head, next, prev);
+        perm[k] = p;
+        invp[p] = k;
+        nleft = neqns - k;
+
+        // Form the new element's node list as the union of p's
+        // nodes and the nodes of each element adjacent to p
+        mark[p] = k;
+        for (m = 0; m < A[p].n; m++)
+        {
+            j = A[p].x[m];
+            if (mark[j] == k) continue;
+            mark[j] = k;
+            if (!append(&L[p], j))
+            {
+                errcode = 101;
+                goto ENDAMD;
+            }
+        }
+        for (m = 0; m < E[p].n; m++)
+        {
+            e = E[p].x[m];
+            if (status[e] != 1) continue;
+            for (i = 0; i < L[e].n; i++)
+            {
+                j = L[e].x[i];
+                if (mark[j] == k) continue;
+                mark[j] = k;
+                if (!append(&L[p], j))
+                {
+                    errcode = 101;
+                    goto ENDAMD;
+                }
+            }
+            status[e] = 2;
+            free(L[e].x);
+            L[e].x = NULL;
+        }
+        status[p] = 1;
+        free(A[p].x);
+        free(E[p].x);
+        A[p].x = NULL;
+        E[p].x = NULL;
+        lpsize = L[p].n;
+
+        // Find the size of each other element outside of the new one
+        for (m = 0; m < lpsize; m++)
+        {
+            i = L[p].x[m];
+            for (j = 0; j < E[i].n; j++)
+            {
+                e = E[i].x[j];
+                if (status[e] != 1) continue;
+                if (w[e] < 0) w[e] = L[e].n;
+                w[e]--;
+            }
+        }
+
+        // Update the lists and approximate degree of each node
+        // in the new element
+        for (m = 0; m < lpsize; m++)
+        {
+            i = L[p].x[m];
+            removenode(i, degree[i], head, next, prev);
+
+            // Drop absorbed elements, absorb those inside the new
+            // element and add the new element to i's list
+            deg = 0;
+            d = 0;
+            for (j = 0; j < E[i].n; j++)
+            {
+                e = E[i].x[j];
+                if (status[e] != 1) continue;
+                if (w[e] == 0)
+                {
+                    status[e] = 2;
+                    free(L[e].x);
+                    L[e].x = NULL;
+                    continue;
+                }
+                deg += w[e] < 0 ? L[e].n : w[e];
+                E[i].x[d++] = e;
+            }
+            E[i].n = d;
+            if (!append(&E[i], p))
+            {
+                errcode = 101;
+                goto ENDAMD;
+            }
+
+            // Remove p and the new element's nodes from i's node list
+            d = 0;
+            for (j = 0; j < A[i].n; j++)
+            {
+                if (mark[A[i].x[j]] != k) A[i].x[d++] = A[i].x[j];
+            }
+            A[i].n = d;
+            deg += d + lpsize - 1;
+
+            // Use the least of the three degree bounds
+            d = degree[i] + lpsize - 1;
+            if (deg < d) d = deg;
+            if (nleft - 1 < d) d = nleft - 1;
+            if (d < 0) d = 0;
+            degree[i] = d;
+            insertnode(i, d, head, next, prev);
+            if (d < dmin) dmin = d;
+        }
+
+        // Reset element sizes for the next elimination
+        for (m = 0; m < lpsize; m++)
+        {
+            i = L[p].x[m];
+            for (j = 0; j < E[i].n; j++) w[E[i].x[j]] = -1;
+        }
+    }
+
+ENDAMD:
+    if (A) for (i = 1; i <= neqns; i++) free(A[i].x);
+    if (E) for (i = 1; i <= neqns; i++) free(E[i].x);
+    if (L) for (i = 1; i <= neqns; i++) free(L[i].x);
+    free(A);
+    free(E);
+    free(L);
+    free(degree);
+    free(head);
+    free(next);
+    free(prev);
+    free(status);
+    free(mark);
+    free(w);
+    return errcode;
+}                        /* End of genamd */
+
+
+int append(List *list, int i)
+/*
+**--------------------------------------------------------------
+** Adds index i to the end of a list, returning 0 if out of memory
+**--------------------------------------------------------------
+*/
+{
+    int *x;
+    if (list->n == list->size)
+    {
+        x = (int *) realloc(list->x, (2*list->size + 4) * sizeof(int));
+        if (x == NULL) return 0;
+        list->x = x;
+        list->size = 2*list->size + 4;
+    }
+    list->x[list->n++] = i;
+    return 1;
+}
+
+
+void insertnode(int i, int d, int *head, int *next, int *prev)
+/*
+**--------------------------------------------------------------
+** Adds node i to the front of the list of nodes of degree d
+**--------------------------------------------------------------
+*/
+{
+    next[i] = head[d];
+    prev[i] = 0;
+    if (head[d] > 0) prev[head[d]] = i;
+    head[d] = i;
+}
+
+
+void removenode(int i, int d, int *head, int *next, int *prev)
+/*
+**--------------------------------------------------------------
+** Removes node i from the list of nodes of degree d
+**--------------------------------------------------------------
+*/
+{
+    if (prev[i] > 0) next[prev[i]] = next[i];
+    else head[d] = next[i];
+    if (next[i] > 0) prev[next[i]] = prev[i];
+}
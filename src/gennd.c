@@ -0,0 +1,549 @@
+/*  NESTED DISSECTION ROW RE-ORDERING ALGORITHM
+ *
+ *  Works with Fortran-style (1-based) arrays like genmmd.c.
+ *
+ */
+
+/*
+**  The graph is split recursively by vertex separators found from
+**  the level structure of a pseudo-peripheral node (George and Liu,
+**  "Computer Solution of Large Sparse Positive Definite Systems",
+**  1981). Among the levels near the middle of the structure, the one
+**  with the fewest nodes adjacent to the next level is chosen, and
+**  only those nodes form the separator. Separator nodes are numbered
+**  after the two parts they divide, so no fill occurs between the
+**  parts, and parts too small to split are ordered by approximate
+**  minimum degree (see genamd.c). Disconnected parts are ordered
+**  independently.
+**
+**  gendomains() uses the same separators to split a graph into a
+**  given number of subdomains, bisecting the largest one each time.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define  NDLEAF     64    /* Parts at or below this size are not split    */
+#define  NDSEPRATIO 4.0   /* Max. squared separator size per node of part */
+
+int gennd(int neqns, int *xadj, int *adjncy, int *invp, int *perm);
+int gendomains(int neqns, int *xadj, int *adjncy, int *ndomains, int *part);
+int genamd(int neqns, int *xadj, int *adjncy, int *invp, int *perm);
+
+typedef struct           /* Work arrays shared by all parts */
+{
+    int *xadj;
+    int *adjncy;
+    int *mark;           // Tag of the part each node belongs to
+    int *level;          // Level of each node in a level structure
+    int *queue;          // Nodes in level structure order
+    int *local;          // Index of each node within a leaf part
+    int *perm;
+    int *invp;
+    int  tag;            // Tag of the most recent part
+    int  last;           // Last position not yet assigned
+} NDwork;
+
+static int  dissect(NDwork *, int *, int);
+static int  bisect(NDwork *, int *, int, int *);
+static void split(NDwork *, int, int, int *, int *, int *, int *, int *,
+                  int *);
+static int  components(NDwork *, int *, int);
+static int  levels(NDwork *, int *, int, int, int *);
+static int  reach(NDwork *, int, int *);
+static int  orderleaf(NDwork *, int *, int);
+static void number(NDwork *, int *, int);
+
+//=============================================================================
+
+int gennd(int neqns, int *xadj, int *adjncy, int *invp, int *perm)
+/*
+**--------------------------------------------------------------
+** Input:   neqns = number of equations
+**          xadj, adjncy = adjacency structure of the matrix
+** Output:  invp = position of each node in the new ordering
+**          perm = node at each position of the new ordering
+**          returns 0 if successful or 101 if out of memory
+** Purpose: finds a nested dissection ordering
+**--------------------------------------------------------------
+*/
+{
+    int  i, errcode = 0;
+    int *nodes = NULL;
+    NDwork nd;
+
+    memset(&nd, 0, sizeof(NDwork));
+    nd.xadj = xadj;
+    nd.adjncy = adjncy;
+    nd.perm = perm;
+    nd.invp = invp;
+    nd.last = neqns;
+    nd.mark  = (int *) calloc(neqns+1, sizeof(int));
+    nd.level = (int *) calloc(neqns+1, sizeof(int));
+    nd.queue = (int *) calloc(neqns+1, sizeof(int));
+    nd.local = (int *) calloc(neqns+1, sizeof(int));
+    nodes    = (int *) calloc(neqns+1, sizeof(int));
+    if (!nd.mark || !nd.level || !nd.queue || !nd.local || !nodes)
+    {
+        errcode = 101;
+    }
+    else
+    {
+        for (i = 0; i < neqns; i++) nodes[i] = i + 1;
+        errcode = dissect(&nd, nodes, neqns);
+    }
+    free(nd.mark);
+    free(nd.level);
+    free(nd.queue);
+    free(nd.local);
+    free(nodes);
+    return errcode;
+}                        /* End of gennd */
+
+
+int gendomains(int neqns, int *xadj, int *adjncy, int *ndomains, int *part)
+/*
+**--------------------------------------------------------------
+** Input:   neqns = number of equations
+**          xadj, adjncy = adjacency structure of the matrix
+**          ndomains = number of subdomains wanted
+** Output:  ndomains = number of subdomains found
+**          part = subdomain (1 to ndomains) of each node, or 0
+**                 for nodes of the separator between them
+**          returns 0 if successful or 101 if out of memory
+** Purpose: splits a graph into subdomains that are connected
+**          only through a set of separator nodes
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, d, n, nd0, best, sepsize, nsep, na, nb, errcode = 0;
+    int *nodes = NULL, *size = NULL, *sep = NULL, *parta = NULL;
+    int *partb = NULL;
+    char *fixed = NULL;
+    NDwork nd;
+
+    memset(&nd, 0, sizeof(NDwork));
+    nd.xadj = xadj;
+    nd.adjncy = adjncy;
+    nd.mark  = (int *) calloc(neqns+1, sizeof(int));
+    nd.level = (int *) calloc(neqns+1, sizeof(int));
+    nd.queue = (int *) calloc(neqns+1, sizeof(int));
+    nodes = (int *) calloc(neqns+1, sizeof(int));
+    sep   = (int *) calloc(neqns+1, sizeof(int));
+    parta = (int *) calloc(neqns+1, sizeof(int));
+    partb = (int *) calloc(neqns+1, sizeof(int));
+    size  = (int *) calloc(*ndomains+1, sizeof(int));
+    fixed = (char *) calloc(*ndomains+1, sizeof(char));
+    if (!nd.mark || !nd.level || !nd.queue || !nodes || !sep || !parta ||
+        !partb || !size || !fixed)
+    {
+        errcode = 101;
+        goto ENDDOMAINS;
+    }
+
+    // Start with the whole graph as a single subdomain
+    for (i = 1; i <= neqns; i++) part[i] = 1;
+    size[1] = neqns;
+    nd0 = 1;
+    while (nd0 < *ndomains)
+    {
+        // Pick the largest subdomain not yet found to be unsplittable
+        d = 0;
+        for (i = 1; i <= nd0; i++)
+        {
+            if (!fixed[i] && size[i] > 1 && (d == 0 || size[i] > size[d]))
+            {
+                d = i;
+            }
+        }
+        if (d == 0) break;
+        n = 0;
+        for (i = 1; i <= neqns; i++) if (part[i] == d) nodes[n++] = i;
+
+        // A disconnected subdomain gives up the nodes not reached
+        // from its first node, with no separator needed
+        best = bisect(&nd, nodes, n, &sepsize);
+        if (best < 0)
+        {
+            nd0++;
+            for (i = 0; i < n; i++)
+            {
+                j = nodes[i];
+                if (nd.level[j] < 0)
+                {
+                    part[j] = nd0;
+                    size[nd0]++;
+                }
+            }
+            size[d] -= size[nd0];
+        }
+
+        // Otherwise the subdomain is split by a vertex separator
+        else if (best == 0) fixed[d] = 1;
+        else
+        {
+            split(&nd, n, best, sep, &nsep, parta, &na, partb, &nb);
+            nd0++;
+            for (i = 0; i < nsep; i++) part[sep[i]] = 0;
+            for (i = 0; i < nb; i++) part[partb[i]] = nd0;
+            size[d] = na;
+            size[nd0] = nb;
+        }
+    }
+    *ndomains = nd0;
+
+ENDDOMAINS:
+    free(nd.mark);
+    free(nd.level);
+    free(nd.queue);
+    free(nodes);
+    free(sep);
+    free(parta);
+    free(partb);
+    free(size);
+    free(fixed);
+    return errcode;
+}                        /* End of gendomains */
+
+
+int dissect(NDwork *nd, int *nodes, int n)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes forming a part of the graph
+** Output:  returns error code
+** Purpose: orders a part of the graph, numbering its separator
+**          last and then ordering the parts it separates
+**--------------------------------------------------------------
+*/
+{
+    int  best, bestsize, nsep, na, nb, errcode = 0;
+    int *sep = NULL, *parta = NULL, *partb = NULL;
+
+    if (n <= NDLEAF) return orderleaf(nd, nodes, n);
+
+    // Order each component of a disconnected part separately
+    best = bisect(nd, nodes, n, &bestsize);
+    if (best < 0) return components(nd, nodes, n);
+
+    // A part with no small, balanced separator is not planar-like
+    // enough to benefit from dissection and is ordered as a leaf
+    if (best == 0 || (double)bestsize * bestsize > NDSEPRATIO * n)
+    {
+        return orderleaf(nd, nodes, n);
+    }
+
+    // Split the part into the separator and the parts before and after it
+    sep   = (int *) calloc(n, sizeof(int));
+    parta = (int *) calloc(n, sizeof(int));
+    partb = (int *) calloc(n, sizeof(int));
+    if (!sep || !parta || !partb) errcode = 101;
+    else
+    {
+        split(nd, n, best, sep, &nsep, parta, &na, partb, &nb);
+        number(nd, sep, nsep);
+        errcode = dissect(nd, partb, nb);
+        if (!errcode) errcode = dissect(nd, parta, na);
+    }
+    free(sep);
+    free(parta);
+    free(partb);
+    return errcode;
+}                        /* End of dissect */
+
+
+int bisect(NDwork *nd, int *nodes, int n, int *sepsize)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes forming a part of the graph
+** Output:  sepsize = number of nodes in the separator found
+**          returns the separating level of the part's level
+**          structure (left in nd->queue), 0 if there is none
+**          or -1 if the part is disconnected
+** Purpose: finds a vertex separator that splits a part of the
+**          graph into two parts of similar size
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, k, m, root, nlevels, nreach, l, best, size, cnt;
+    int *xadj = nd->xadj;
+    int *adjncy = nd->adjncy;
+    int *level = nd->level;
+    int *queue = nd->queue;
+
+    // Tag the part's nodes
+    nd->tag++;
+    for (i = 0; i < n; i++) nd->mark[nodes[i]] = nd->tag;
+    *sepsize = n + 1;
+
+    // A disconnected part is not split by a separator
+    root = nodes[0];
+    nlevels = levels(nd, nodes, n, root, &nreach);
+    if (nreach < n) return -1;
+
+    // Find a pseudo-peripheral node by repeatedly starting a level
+    // structure from a node of least degree in the last level
+    for (;;)
+    {
+        k = 0;
+        for (i = n - 1; i >= 0 && level[queue[i]] == nlevels - 1; i--)
+        {
+            j = queue[i];
+            if (k == 0 || xadj[j+1] - xadj[j] < xadj[k+1] - xadj[k]) k = j;
+        }
+        m = levels(nd, nodes, n, k, &nreach);
+        if (m <= nlevels) break;
+        root = k;
+        nlevels = m;
+    }
+    nlevels = levels(nd, nodes, n, root, &nreach);
+
+    // A part without enough levels cannot be split
+    if (nlevels < 3) return 0;
+
+    // Choose the separating level among the middle levels: only its
+    // nodes adjacent to the next level are needed to separate the part
+    best = 0;
+    cnt = 0;
+    for (i = 0, l = 0; l < nlevels - 1; l++)
+    {
+        size = 0;
+        for (; i < n && level[queue[i]] == l; i++)
+        {
+            j = queue[i];
+            for (m = xadj[j]; m < xadj[j+1]; m++)
+            {
+                k = adjncy[m];
+                if (nd->mark[k] == nd->tag && level[k] == l + 1)
+                {
+                    size++;
+                    break;
+                }
+            }
+        }
+        if (l > 0 && 4*cnt >= n && 4*i <= 3*n && size < *sepsize)
+        {
+            best = l;
+            *sepsize = size;
+        }
+        cnt = i;
+    }
+    return best;
+}                        /* End of bisect */
+
+
+void split(NDwork *nd, int n, int best, int *sep, int *nsep, int *parta,
+           int *na, int *partb, int *nb)
+/*
+**--------------------------------------------------------------
+** Input:   n    = number of nodes in the part
+**          best = separating level found by bisect()
+** Output:  sep, parta, partb = nodes of the separator and of the
+**          parts before and after it, and their sizes
+** Purpose: splits a part of the graph at a level of its level
+**          structure
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, k, m;
+    int *xadj = nd->xadj;
+    int *adjncy = nd->adjncy;
+    int *level = nd->level;
+    int *queue = nd->queue;
+
+    *nsep = *na = *nb = 0;
+    for (i = 0; i < n; i++)
+    {
+        j = queue[i];
+        if (level[j] < best) parta[(*na)++] = j;
+        else if (level[j] > best) partb[(*nb)++] = j;
+        else
+        {
+            for (m = xadj[j]; m < xadj[j+1]; m++)
+            {
+                k = adjncy[m];
+                if (nd->mark[k] == nd->tag && level[k] == best + 1) break;
+            }
+            if (m < xadj[j+1]) sep[(*nsep)++] = j;
+            else parta[(*na)++] = j;
+        }
+    }
+}                        /* End of split */
+
+
+int components(NDwork *nd, int *nodes, int n)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes forming a part of the graph
+** Output:  returns error code
+** Purpose: orders each connected component of a part
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, cnt, size, errcode = 0;
+    int *comp = NULL, *xcomp = NULL, ncomp = 0;
+
+    comp  = (int *) calloc(n, sizeof(int));
+    xcomp = (int *) calloc(n+1, sizeof(int));
+    if (!comp || !xcomp) errcode = 101;
+    else
+    {
+        // List the nodes of each component in turn
+        for (i = 0; i < n; i++) nd->level[nodes[i]] = -1;
+        cnt = 0;
+        for (i = 0; i < n; i++)
+        {
+            j = nodes[i];
+            if (nd->level[j] >= 0) continue;
+            xcomp[ncomp++] = cnt;
+            cnt += reach(nd, j, comp + cnt);
+        }
+        xcomp[ncomp] = cnt;
+
+        // Dissect the components (re-tagging each one)
+        for (i = ncomp - 1; i >= 0 && !errcode; i--)
+        {
+            size = xcomp[i+1] - xcomp[i];
+            errcode = dissect(nd, comp + xcomp[i], size);
+        }
+    }
+    free(comp);
+    free(xcomp);
+    return errcode;
+}
+
+
+int levels(NDwork *nd, int *nodes, int n, int root, int *nreach)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes forming the current part
+**          root = starting node
+** Output:  nreach = number of nodes reached from root
+**          returns number of levels in the level structure
+** Purpose: builds the level structure rooted at a node of
+**          the current part in nd->queue
+**--------------------------------------------------------------
+*/
+{
+    int i;
+    for (i = 0; i < n; i++) nd->level[nodes[i]] = -1;
+    *nreach = reach(nd, root, nd->queue);
+    return nd->level[nd->queue[*nreach-1]] + 1;
+}
+
+
+int reach(NDwork *nd, int root, int *queue)
+/*
+**--------------------------------------------------------------
+** Input:   root = starting node
+** Output:  queue = nodes reached from root in level order
+**          returns number of nodes reached
+** Purpose: assigns levels to the unvisited nodes (level < 0)
+**          of the current part reachable from a node
+**--------------------------------------------------------------
+*/
+{
+    int j, k, m, head, tail;
+    int *level = nd->level;
+
+    head = 0;
+    tail = 0;
+    queue[tail++] = root;
+    level[root] = 0;
+    while (head < tail)
+    {
+        j = queue[head++];
+        for (m = nd->xadj[j]; m < nd->xadj[j+1]; m++)
+        {
+            k = nd->adjncy[m];
+            if (nd->mark[k] != nd->tag || level[k] >= 0) continue;
+            level[k] = level[j] + 1;
+            queue[tail++] = k;
+        }
+    }
+    return tail;
+}
+
+
+int orderleaf(NDwork *nd, int *nodes, int n)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes forming a part of the graph
+** Output:  returns error code
+** Purpose: orders a small part by approximate minimum degree
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, k, m, cnt, errcode = 0;
+    int *xadj = NULL, *adjncy = NULL, *perm = NULL, *invp = NULL;
+    int *order = NULL;
+
+    if (n == 0) return 0;
+    nd->tag++;
+    cnt = 0;
+    for (i = 0; i < n; i++)
+    {
+        j = nodes[i];
+        nd->mark[j] = nd->tag;
+        nd->local[j] = i + 1;
+        cnt += nd->xadj[j+1] - nd->xadj[j];
+    }
+
+    // Build the part's own adjacency structure
+    xadj   = (int *) calloc(n+2, sizeof(int));
+    adjncy = (int *) calloc(cnt+1, sizeof(int));
+    perm   = (int *) calloc(n+1, sizeof(int));
+    invp   = (int *) calloc(n+1, sizeof(int));
+    order  = (int *) calloc(n, sizeof(int));
+    if (!xadj || !adjncy || !perm || !invp || !order) errcode = 101;
+    else
+    {
+        xadj[1] = 1;
+        m = 1;
+        for (i = 0; i < n; i++)
+        {
+            j = nodes[i];
+            for (k = nd->xadj[j]; k < nd->xadj[j+1]; k++)
+            {
+                if (nd->mark[nd->adjncy[k]] == nd->tag)
+                {
+                    adjncy[m++] = nd->local[nd->adjncy[k]];
+                }
+            }
+            xadj[i+2] = m;
+        }
+        errcode = genamd(n, xadj, adjncy, invp, perm);
+        if (!errcode)
+        {
+            for (i = 0; i < n; i++) order[i] = nodes[perm[i+1]-1];
+            number(nd, order, n);
+        }
+    }
+    free(xadj);
+    free(adjncy);
+    free(perm);
+    free(invp);
+    free(order);
+    return errcode;
+}
+
+
+void number(NDwork *nd, int *nodes, int n)
+/*
+**--------------------------------------------------------------
+** Input:   nodes = list of n nodes in elimination order
+** Output:  none
+** Purpose: assigns the last n unassigned positions to a
+**          list of nodes
+**--------------------------------------------------------------
+*/
+{
+    int i, k;
+
+    nd->last -= n;
+    for (i = 0; i < n; i++)
+    {
+        k = nd->last + i + 1;
+        nd->perm[k] = nodes[i];
+        nd->invp[nodes[i]] = k;
+    }
+}
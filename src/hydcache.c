@@ -0,0 +1,384 @@
+/*
+*******************************************************************
+
+HYDCACHE.C -- Hydraulic solution cache for EPANET.
+
+This module keeps the solutions of past time periods so that later
+periods with the same inputs can reuse them. Its entry points are:
+   createcache() -- called from openhyd() in HYDRAUL.C
+   freecache()   -- called from closehyd() in HYDRAUL.C
+   clearcache()  -- called from inithyd() in HYDRAUL.C
+   usecached()   -- called from runhyd() in HYDRAUL.C
+   savecached()  -- called from runhyd() in HYDRAUL.C
+   cachesize()   -- called from EN_getstatistic() in EPANET.C
+
+The inputs of a period's solution are its junction demands (found
+by demands()), the statuses and settings of its links (once
+controls() has been applied) and the heads of its tanks and
+reservoirs. An extended period run whose demands repeat each day
+meets the same demands and link states at the same time of every
+day, with tank levels that differ only a little. So the signature
+(Key) of a period is a hash of its demands, rounded to the flow
+tolerance Qtol, and of its link statuses and settings, and picks
+one of the CacheSize entries. If that entry holds a solution with
+the same demands (to within Qtol) and link states then:
+   - if each tank's head is within CacheTol of the entry's, the
+     entry's solution (with the link statuses and settings that
+     hydsolve() ended with, which pressure switch controls may have
+     changed) is taken as the period's without calling hydsolve();
+   - otherwise hydsolve() starts from the entry's flows.
+The solution that hydsolve() finds then replaces the entry's.
+
+Tank heads are compared rather than hashed so that levels either
+side of a rounding boundary still match. Other network data (such
+as pipe roughness) are not part of the signature, so the cache is
+emptied by inithyd() and must not be used when such data are
+changed through the toolkit during a run.
+*******************************************************************
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "types.h"
+#include "funcs.h"
+
+#define  NSTATS  3           // Convergence error, max. head error & flow change
+
+// The values that an entry holds in X and S
+typedef struct {
+    double   *stats;         // Convergence info of the solution
+    double   *d;             // Junction demands
+    double   *hf;            // Heads of tanks & reservoirs
+    double   *k0;            // Link settings before the solution
+    double   *h;             // Junction heads
+    double   *nd;            // Node outflows (net inflows at tanks)
+    double   *df;            // Junction demand flows
+    double   *ef;            // Junction emitter flows
+    double   *q;             // Link flows
+    double   *k1;            // Link settings of the solution
+    StatType *s0;            // Link statuses before the solution
+    StatType *s1;            // Link statuses of the solution
+} Sentry;
+
+// Local functions
+static void          getentry(EN_Project *pr, int slot, Sentry *e);
+static unsigned int  signature(EN_Project *pr);
+static unsigned int  hashbytes(unsigned int h, const void *x, size_t n);
+static int           samestate(EN_Project *pr, Sentry *e);
+
+
+int  createcache(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns error code
+**  Purpose: allocates the solution cache
+**--------------------------------------------------------------
+*/
+{
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    cache_t      *c = &hyd->cache;
+    int errcode = 0;
+
+    c->Size = 0;
+    if (hyd->CacheSize <= 0) return 0;
+    c->Size = hyd->CacheSize;
+    c->Nx = NSTATS + 3 * net->Njuncs + 2 * net->Nnodes + 3 * net->Nlinks;
+    c->Key  = (unsigned int *) calloc(c->Size, sizeof(unsigned int));
+    c->X    = (double *) calloc((size_t)c->Size * c->Nx, sizeof(double));
+    c->S    = (StatType *) calloc((size_t)c->Size * 2 * net->Nlinks,
+                                  sizeof(StatType));
+    c->Used = (char *) calloc(c->Size, sizeof(char));
+    ERRCODE(MEMCHECK(c->Key));
+    ERRCODE(MEMCHECK(c->X));
+    ERRCODE(MEMCHECK(c->S));
+    ERRCODE(MEMCHECK(c->Used));
+    clearcache(pr);
+    return errcode;
+}
+
+
+void  freecache(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  none
+**  Purpose: frees the solution cache
+**--------------------------------------------------------------
+*/
+{
+    cache_t *c = &pr->hydraulics.cache;
+
+    FREE(c->Key);
+    FREE(c->X);
+    FREE(c->S);
+    FREE(c->Used);
+    c->Size = 0;
+}
+
+
+void  clearcache(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  none
+**  Purpose: empties the solution cache and resets its counts
+**--------------------------------------------------------------
+*/
+{
+    cache_t *c = &pr->hydraulics.cache;
+
+    if (c->Size > 0) memset(c->Used, 0, c->Size * sizeof(char));
+    c->Slot = 0;
+    c->Reused = FALSE;
+    c->Lookups = 0;
+    c->Hits = 0;
+    c->Starts = 0;
+}
+
+
+int  usecached(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns TRUE if the current period's solution was
+**           taken from the cache
+**  Purpose: looks up the inputs of the current period in the
+**           cache and either takes its solution from there or
+**           starts hydsolve() from the flows found there
+**
+**  Note:    A period that does not take its solution from the
+**           cache has its inputs put in the entry it maps to,
+**           whose solution savecached() supplies once found.
+**--------------------------------------------------------------
+*/
+{
+    int      i, k;
+    unsigned int key;
+    Sentry   e;
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    cache_t      *c = &hyd->cache;
+    int njuncs = net->Njuncs;
+    int nfixed = net->Nnodes - net->Njuncs;
+
+    c->Reused = FALSE;
+    if (c->Size == 0) return FALSE;
+    c->Lookups++;
+    key = signature(pr);
+    c->Slot = key % c->Size;
+    getentry(pr, c->Slot, &e);
+
+    if (c->Used[c->Slot] && c->Key[c->Slot] == key && samestate(pr, &e))
+    {
+        // Take the entry's solution if the tanks are at its levels
+        for (i = 1; i <= nfixed; i++)
+        {
+            if (ABS(hyd->NodeHead[njuncs+i] - e.hf[i-1]) > hyd->CacheTol) break;
+        }
+        if (i > nfixed)
+        {
+            memcpy(&hyd->NodeHead[1], e.h, njuncs * sizeof(double));
+            memcpy(&hyd->NodeDemand[1], e.nd, net->Nnodes * sizeof(double));
+            memcpy(&hyd->DemandFlows[1], e.df, njuncs * sizeof(double));
+            memcpy(&hyd->EmitterFlows[1], e.ef, njuncs * sizeof(double));
+            memcpy(&hyd->LinkFlows[1], e.q, net->Nlinks * sizeof(double));
+            memcpy(&hyd->LinkStatus[1], e.s1, net->Nlinks * sizeof(StatType));
+            memcpy(&hyd->LinkSetting[1], e.k1, net->Nlinks * sizeof(double));
+            hyd->predictor.Predicted = FALSE;
+            hyd->RelativeError = e.stats[0];
+            hyd->MaxHeadError = e.stats[1];
+            hyd->MaxFlowChange = e.stats[2];
+            hyd->Iterations = 0;
+            c->Hits++;
+            c->Reused = TRUE;
+            return TRUE;
+        }
+
+        // ... otherwise start from its flows (which are no longer
+        // those of the flow predictor)
+        for (k = 1; k <= net->Nlinks; k++)
+        {
+            if (hyd->LinkStatus[k] > CLOSED) hyd->LinkFlows[k] = e.q[k-1];
+        }
+        memcpy(&hyd->EmitterFlows[1], e.ef, njuncs * sizeof(double));
+        hyd->predictor.Predicted = FALSE;
+        c->Starts++;
+    }
+
+    // Put the period's inputs in its entry
+    c->Used[c->Slot] = FALSE;
+    c->Key[c->Slot] = key;
+    memcpy(e.d, &hyd->NodeDemand[1], njuncs * sizeof(double));
+    memcpy(e.hf, &hyd->NodeHead[njuncs+1], nfixed * sizeof(double));
+    memcpy(e.k0, &hyd->LinkSetting[1], net->Nlinks * sizeof(double));
+    memcpy(e.s0, &hyd->LinkStatus[1], net->Nlinks * sizeof(StatType));
+    return FALSE;
+}
+
+
+void  savecached(EN_Project *pr, double relerr)
+/*
+**--------------------------------------------------------------
+**  Input:   relerr = convergence error of current solution
+**  Output:  none
+**  Purpose: puts the solution found by hydsolve() for the
+**           current period into the cache
+**--------------------------------------------------------------
+*/
+{
+    Sentry e;
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    cache_t      *c = &hyd->cache;
+    int njuncs = net->Njuncs;
+
+    // Unbalanced solutions are not kept
+    if (c->Size == 0 || c->Reused || relerr > hyd->Hacc) return;
+
+    getentry(pr, c->Slot, &e);
+    e.stats[0] = relerr;
+    e.stats[1] = hyd->MaxHeadError;
+    e.stats[2] = hyd->MaxFlowChange;
+    memcpy(e.h, &hyd->NodeHead[1], njuncs * sizeof(double));
+    memcpy(e.nd, &hyd->NodeDemand[1], net->Nnodes * sizeof(double));
+    memcpy(e.df, &hyd->DemandFlows[1], njuncs * sizeof(double));
+    memcpy(e.ef, &hyd->EmitterFlows[1], njuncs * sizeof(double));
+    memcpy(e.q, &hyd->LinkFlows[1], net->Nlinks * sizeof(double));
+    memcpy(e.s1, &hyd->LinkStatus[1], net->Nlinks * sizeof(StatType));
+    memcpy(e.k1, &hyd->LinkSetting[1], net->Nlinks * sizeof(double));
+    c->Used[c->Slot] = TRUE;
+}
+
+
+double  cachesize(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns number of bytes used by the solution cache
+**  Purpose: computes the memory held by the solution cache
+**--------------------------------------------------------------
+*/
+{
+    cache_t *c = &pr->hydraulics.cache;
+
+    if (c->Size == 0) return 0.0;
+    return (double)c->Size * (c->Nx * sizeof(double) +
+           2.0 * pr->network.Nlinks * sizeof(StatType) +
+           sizeof(unsigned int) + sizeof(char));
+}
+
+
+void  getentry(EN_Project *pr, int slot, Sentry *e)
+/*
+**--------------------------------------------------------------
+**  Input:   slot = index of a cache entry
+**  Output:  e = pointers to the values the entry holds
+**  Purpose: locates the values of a cache entry in X and S
+**--------------------------------------------------------------
+*/
+{
+    EN_Network *net = &pr->network;
+    cache_t    *c = &pr->hydraulics.cache;
+
+    e->stats = c->X + (size_t)slot * c->Nx;
+    e->d  = e->stats + NSTATS;
+    e->hf = e->d + net->Njuncs;
+    e->k0 = e->hf + net->Nnodes - net->Njuncs;
+    e->h  = e->k0 + net->Nlinks;
+    e->nd = e->h + net->Njuncs;
+    e->df = e->nd + net->Nnodes;
+    e->ef = e->df + net->Njuncs;
+    e->q  = e->ef + net->Njuncs;
+    e->k1 = e->q + net->Nlinks;
+    e->s0 = c->S + (size_t)slot * 2 * net->Nlinks;
+    e->s1 = e->s0 + net->Nlinks;
+}
+
+
+unsigned int  signature(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns signature of current period's inputs
+**  Purpose: hashes the junction demands (in units of Qtol) and
+**           the link statuses and settings of the current period
+**--------------------------------------------------------------
+*/
+{
+    int    i, k, s;
+    double d;
+    unsigned int h = 2166136261u;
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        d = floor(hyd->NodeDemand[i] / hyd->Qtol + 0.5);
+        h = hashbytes(h, &d, sizeof(double));
+    }
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        s = hyd->LinkStatus[k];
+        h = hashbytes(h, &s, sizeof(int));
+        h = hashbytes(h, &hyd->LinkSetting[k], sizeof(double));
+    }
+    return h;
+}
+
+
+unsigned int  hashbytes(unsigned int h, const void *x, size_t n)
+/*
+**--------------------------------------------------------------
+**  Input:   h = hash so far
+**           x = bytes to add to it
+**           n = number of bytes
+**  Output:  returns new hash
+**  Purpose: adds bytes to a hash (32-bit FNV-1a)
+**--------------------------------------------------------------
+*/
+{
+    const unsigned char *b = (const unsigned char *)x;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        h ^= b[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+
+int  samestate(EN_Project *pr, Sentry *e)
+/*
+**--------------------------------------------------------------
+**  Input:   e = a cache entry
+**  Output:  returns TRUE if the current period has the entry's
+**           demands and link statuses and settings
+**  Purpose: checks that a cache entry matches the current
+**           period and not just its signature
+**--------------------------------------------------------------
+*/
+{
+    int i, k;
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        if (ABS(hyd->NodeDemand[i] - e->d[i-1]) > hyd->Qtol) return FALSE;
+    }
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        if (hyd->LinkStatus[k] != e->s0[k-1]) return FALSE;
+        if (hyd->LinkSetting[k] != e->k0[k-1]) return FALSE;
+    }
+    return TRUE;
+}
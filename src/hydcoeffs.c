@@ -29,25 +29,42 @@ const double AA = -1.5634601348517065795e+00;   // -2*.9*2/ln(10)
 const double AB = 3.28895476345399058690e-03;   // 5.74/(4000^.9)
 const double AC = -5.14214965799093883760e-03;  // AA*AB
 
+// Pipes whose coeffs. are found before their links are assembled
+// into the solution matrix (see trialcoeffs())
+#define PIPECHUNK 256
+
 // External functions
 //void   resistcoeff(EN_Project *pr, int k);
 //void   headlosscoeffs(EN_Project *pr);
+//void   loadlinkarrays(EN_Project *pr);
+//void   setkernels(EN_Project *pr);
 //void   matrixcoeffs(EN_Project *pr);
+//void   trialcoeffs(EN_Project *pr);
 //void   emitheadloss(EN_Project *pr, int i, double *hloss, double *dhdq);
 //double demandflowchange(EN_Project *pr, int i, double dp, double n);
 //void   demandparams(EN_Project *pr, double *dp, double *n);
 
 // Local functions
-static void    linkcoeffs(EN_Project *pr);
+static void    linkcoeffs(EN_Project *pr, int k1, int k2);
+static void    ddajunctioncoeffs(EN_Project *pr);
+static void    pdajunctioncoeffs(EN_Project *pr);
+static void    linkcoeff(EN_Project *pr, int k);
 static void    nodecoeffs(EN_Project *pr);
 static void    valvecoeffs(EN_Project *pr);
 static void    emittercoeffs(EN_Project *pr);
 static void    demandcoeffs(EN_Project *pr);
+static void    nocoeffs(EN_Project *pr);
 static void    demandheadloss(double d, double dfull, double dp,
                double n, double *hloss, double *hgrad);
 
 static void    pipecoeff(EN_Project *pr, int k);
+static void    pipecoeffs(EN_Project *pr, int i1, int i2);
 static void    DWpipecoeff(EN_Project *pr, int k);
+static void    DWpipecoeffs(EN_Project *pr, int i1, int i2);
+static void    loadpipeflows(EN_Project *pr, int i1, int i2);
+static void    storepipecoeffs(EN_Project *pr, int i1, int i2);
+static void    DWcoeff(double flow, double r, double ml, double e,
+               double s, double *p, double *y);
 static double  frictionFactor(double q, double e, double s, double *dfdq);
 
 static void    pumpcoeff(EN_Project *pr, int k);
@@ -121,6 +138,143 @@ void  resistcoeff(EN_Project *pr, int k)
 }
 
 
+void loadlinkarrays(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: copies the link data used to find head loss coeffs.
+**            into contiguous arrays, with the pipes listed apart
+**            from the pumps and valves, and lists the links whose
+**            status can change during a solution.
+**
+**   Note: called at the start of each hydraulic solution since
+**         link properties can be changed between time periods.
+**         Only CVs, pumps, FCVs and links to tanks can have their
+**         status changed by linkstatus() (no other link can be
+**         XHEAD or TEMPCLOSED), and only PRVs & PSVs by
+**         valvestatus(), so those are the only links they visit
+**         unless the StatusLists option is off, when every link
+**         and valve is listed.
+**--------------------------------------------------------------
+*/
+{
+    int i, k, n;
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    linkarrays_t *la = &hyd->links;
+    Slink *link;
+
+    la->Npipes = 0;
+    la->Nother = 0;
+    la->Nchecked = 0;
+    la->Npvalves = 0;
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        link = &net->Link[k];
+        la->N1[k] = link->N1;
+        la->N2[k] = link->N2;
+        if (!hyd->StatusLists ||
+            link->Type == CVPIPE || link->Type == PUMP || link->Type == FCV ||
+            link->N1 > net->Njuncs || link->N2 > net->Njuncs)
+        {
+            la->Checked[++la->Nchecked] = k;
+        }
+        if (link->Type > PIPE)
+        {
+            la->Other[++la->Nother] = k;
+            continue;
+        }
+        n = ++la->Npipes;
+        la->Pipe[n] = k;
+        la->R[n] = link->R;
+        la->Km[n] = link->Km;
+        la->Qa[n] = link->Qa;
+        la->Erel[n] = link->Kc / link->Diam;
+        la->Vd[n] = hyd->Viscos * link->Diam;
+    }
+    for (i = 1; i <= net->Nvalves; i++)
+    {
+        k = net->Valve[i].Link;
+        if (!hyd->StatusLists ||
+            net->Link[k].Type == PRV || net->Link[k].Type == PSV)
+        {
+            la->Pvalves[++la->Npvalves] = k;
+        }
+    }
+}
+
+
+void setkernels(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: selects the kernels that find pipe, emitter,
+**            demand and junction coeffs. for the head loss
+**            formula, demand model and emitters in use, and
+**            lists the junctions that have emitters.
+**
+**   Note: called when the hydraulic solver is opened and again
+**         if the demand model or an emitter is changed while
+**         it is open.
+**--------------------------------------------------------------
+*/
+{
+    int i;
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    kernels_t    *kn = &hyd->kernels;
+
+    // Head loss formula
+    if (hyd->Formflag == DW)
+    {
+        kn->Pipecoeffs = DWpipecoeffs;
+        kn->Pipecoeff = DWpipecoeff;
+    }
+    else
+    {
+        kn->Pipecoeffs = pipecoeffs;
+        kn->Pipecoeff = pipecoeff;
+    }
+
+    // Junctions with emitters
+    kn->Nemitters = 0;
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        if (net->Node[i].Ke > 0.0) kn->Emitter[++kn->Nemitters] = i;
+    }
+    if (kn->Nemitters > 0) kn->Emittercoeffs = emittercoeffs;
+    else kn->Emittercoeffs = nocoeffs;
+
+    // Demand model
+    if (hyd->DemandModel == PDA)
+    {
+        kn->Demandcoeffs = demandcoeffs;
+        kn->Junctioncoeffs = pdajunctioncoeffs;
+    }
+    else
+    {
+        kn->Demandcoeffs = nocoeffs;
+        kn->Junctioncoeffs = ddajunctioncoeffs;
+    }
+}
+
+
+void nocoeffs(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: kernel used for emitters or pressure dependent
+**            demands when there are none.
+**--------------------------------------------------------------
+*/
+{
+    (void)pr;
+}
+
+
 void headlosscoeffs(EN_Project *pr)
 /*
 **--------------------------------------------------------------
@@ -128,39 +282,74 @@ void headlosscoeffs(EN_Project *pr)
 **   Output:  none
 **   Purpose: computes coefficients P (1 / head loss gradient)
 **            and Y (head loss / gradient) for all links.
+**
+**   Note: The links of blocks held at their solution (see
+**         hydsolve() in HYDSOLVER.C) keep their coefficients,
+**         so while any block is held each link is examined in
+**         turn. Otherwise all pipes are done at once from the
+**         contiguous link arrays (see loadlinkarrays()).
 **--------------------------------------------------------------
 */
 {
-    int k;
+    int i, k;
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    linkarrays_t *la = &hyd->links;
 
-    for (k = 1; k <= net->Nlinks; k++)
+    // Examine each link in turn while any block is held
+    if (sol->Nfrozen > 0)
     {
-        switch (net->Link[k].Type)
+        for (k = 1; k <= net->Nlinks; k++)
         {
-        case CVPIPE:
-        case PIPE:
-            pipecoeff(pr, k);
-            break;
-        case PUMP:
-            pumpcoeff(pr, k);
-            break;
-        case PBV:
-            pbvcoeff(pr, k);
-            break;
-        case TCV:
-            tcvcoeff(pr, k);
-            break;
-        case GPV:
-            gpvcoeff(pr, k);
-            break;
-        case FCV:
-        case PRV:
-        case PSV:
-            if (hyd->LinkSetting[k] == MISSING) valvecoeff(pr, k);
-            else hyd->solver.P[k] = 0.0;
+            if (sol->Frozen[sol->LinkBlock[k]]) continue;
+            linkcoeff(pr, k);
         }
+        return;
+    }
+
+    // Otherwise find the coeffs. of all pipes at once
+    // before those of the pumps and valves
+    hyd->kernels.Pipecoeffs(pr, 1, la->Npipes);
+    for (i = 1; i <= la->Nother; i++) linkcoeff(pr, la->Other[i]);
+}
+
+
+void linkcoeff(EN_Project *pr, int k)
+/*
+**--------------------------------------------------------------
+**   Input:   k = link index
+**   Output:  none
+**   Purpose: computes coefficients P and Y for link k according
+**            to its type.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+
+    switch (pr->network.Link[k].Type)
+    {
+    case CVPIPE:
+    case PIPE:
+        hyd->kernels.Pipecoeff(pr, k);
+        break;
+    case PUMP:
+        pumpcoeff(pr, k);
+        break;
+    case PBV:
+        pbvcoeff(pr, k);
+        break;
+    case TCV:
+        tcvcoeff(pr, k);
+        break;
+    case GPV:
+        gpvcoeff(pr, k);
+        break;
+    case FCV:
+    case PRV:
+    case PSV:
+        if (hyd->LinkSetting[k] == MISSING) valvecoeff(pr, k);
+        else hyd->solver.P[k] = 0.0;
     }
 }
 
@@ -186,9 +375,9 @@ void   matrixcoeffs(EN_Project *pr)
     memset(hyd->X_tmp, 0, (net->Nnodes + 1) * sizeof(double));
 
     // Compute matrix coeffs. from links, emitters, and nodal demands
-    linkcoeffs(pr);
-    emittercoeffs(pr);
-    demandcoeffs(pr);
+    linkcoeffs(pr, 1, net->Nlinks);
+    hyd->kernels.Emittercoeffs(pr);
+    hyd->kernels.Demandcoeffs(pr);
 
     // Update nodal flow balances with demands and add onto r.h.s. coeffs.
     nodecoeffs(pr);
@@ -199,13 +388,14 @@ void   matrixcoeffs(EN_Project *pr)
 }
 
 
-void  linkcoeffs(EN_Project *pr)
+void  linkcoeffs(EN_Project *pr, int k1, int k2)
 /*
 **--------------------------------------------------------------
-**   Input:   none
+**   Input:   k1, k2 = first and last link
 **   Output:  none
-**   Purpose: computes coefficients contributed by links to the
-**            linearized system of hydraulic equations.
+**   Purpose: computes coefficients contributed by a range of
+**            links to the linearized system of hydraulic
+**            equations.
 **--------------------------------------------------------------
 */
 {
@@ -214,15 +404,15 @@ void  linkcoeffs(EN_Project *pr)
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
     solver_t     *sol = &hyd->solver;
-    Slink *link;
+    linkarrays_t *la = &hyd->links;
 
-    // Examine each link of network
-    for (k = 1; k <= net->Nlinks; k++)
+    // Examine each link in the range
+    for (k = k1; k <= k2; k++)
     {
         if (sol->P[k] == 0.0) continue;
-        link = &net->Link[k];
-        n1 = link->N1;           // Start node of link
-        n2 = link->N2;           // End node of link
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->LinkBlock[k]]) continue;
+        n1 = la->N1[k];          // Start node of link
+        n2 = la->N2[k];          // End node of link
 
         // Update nodal flow balance (X_tmp)
         // (Flow out of node is (-), flow into node is (+))
@@ -257,6 +447,177 @@ void  linkcoeffs(EN_Project *pr)
 }
 
 
+void  trialcoeffs(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: computes the head loss coeffs. of all links and the
+**            coeffs. of the linearized hydraulic eqns. for a
+**            trial of hydsolve().
+**
+**   Note: The results are those of headlosscoeffs() followed by
+**         matrixcoeffs(), but found with one pass over the links
+**         and one over the junctions. The pipes are taken in
+**         chunks small enough for their coeffs. to still be in
+**         cache when the links up to the chunk's last pipe are
+**         added into the matrix, in the same order as before.
+**--------------------------------------------------------------
+*/
+{
+    int i1, i2, j, k1, k2;
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    linkarrays_t *la = &hyd->links;
+
+    // Links of blocks held at their solution are skipped link by link
+    if (sol->Nfrozen > 0)
+    {
+        headlosscoeffs(pr);
+        matrixcoeffs(pr);
+        return;
+    }
+
+    // Reset the matrix coeffs. and node flow balances
+    memset(sol->Aii, 0, (net->Nnodes + 1) * sizeof(double));
+    memset(sol->Aij, 0, (hyd->Ncoeffs + 1) * sizeof(double));
+    memset(sol->F, 0, (net->Nnodes + 1) * sizeof(double));
+    memset(hyd->X_tmp, 0, (net->Nnodes + 1) * sizeof(double));
+
+    // Find the coeffs. of each chunk of pipes and of the pumps and
+    // valves that come before its last pipe, then add their links
+    // into the matrix
+    j = 1;
+    k1 = 1;
+    for (i1 = 1; i1 <= la->Npipes; i1 += PIPECHUNK)
+    {
+        i2 = MIN(i1 + PIPECHUNK - 1, la->Npipes);
+        hyd->kernels.Pipecoeffs(pr, i1, i2);
+        k2 = la->Pipe[i2];
+        while (j <= la->Nother && la->Other[j] < k2)
+        {
+            linkcoeff(pr, la->Other[j++]);
+        }
+        linkcoeffs(pr, k1, k2);
+        k1 = k2 + 1;
+    }
+
+    // ... then do the same for the links after the last pipe
+    while (j <= la->Nother) linkcoeff(pr, la->Other[j++]);
+    linkcoeffs(pr, k1, net->Nlinks);
+
+    // Add the emitters, demands and flow balance of each junction
+    hyd->kernels.Junctioncoeffs(pr);
+
+    // Finally, find coeffs. for PRV/PSV/FCV control valves whose
+    // status is not fixed to OPEN/CLOSED
+    valvecoeffs(pr);
+}
+
+
+void  ddajunctioncoeffs(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: adds the coeffs. contributed by emitters and nodal
+**            flow balances to the linearized hydraulic eqns. in
+**            one pass over the junctions (demand driven analysis).
+**
+**   Note: Each junction's terms are added in the same order as
+**         by emittercoeffs() and nodecoeffs(), which it replaces
+**         when no block is held at its solution.
+**--------------------------------------------------------------
+*/
+{
+    int    i, e, row;
+    double hloss, hgrad;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    kernels_t    *kn = &hyd->kernels;
+    EN_Network   *net = &pr->network;
+
+    e = 1;
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        row = sol->Row[i];
+
+        // Emitter (see emittercoeffs())
+        if (e <= kn->Nemitters && kn->Emitter[e] == i)
+        {
+            emitheadloss(pr, i, &hloss, &hgrad);
+            sol->Aii[row] += 1.0 / hgrad;
+            sol->F[row] += (hloss + net->Node[i].El) / hgrad;
+            hyd->X_tmp[i] -= hyd->EmitterFlows[i];
+            e++;
+        }
+
+        // Flow balance (see nodecoeffs())
+        hyd->X_tmp[i] -= hyd->DemandFlows[i];
+        sol->F[row] += hyd->X_tmp[i];
+    }
+}
+
+
+void  pdajunctioncoeffs(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  none
+**   Purpose: adds the coeffs. contributed by emitters, pressure
+**            dependent demands and nodal flow balances to the
+**            linearized hydraulic eqns. in one pass over the
+**            junctions (pressure driven analysis).
+**
+**   Note: Each junction's terms are added in the same order as
+**         by emittercoeffs(), demandcoeffs() and nodecoeffs(),
+**         which it replaces when no block is held at its
+**         solution.
+**--------------------------------------------------------------
+*/
+{
+    int    i, e, row;
+    double dp, n, hloss, hgrad;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    kernels_t    *kn = &hyd->kernels;
+    EN_Network   *net = &pr->network;
+
+    demandparams(pr, &dp, &n);
+    e = 1;
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        row = sol->Row[i];
+
+        // Emitter (see emittercoeffs())
+        if (e <= kn->Nemitters && kn->Emitter[e] == i)
+        {
+            emitheadloss(pr, i, &hloss, &hgrad);
+            sol->Aii[row] += 1.0 / hgrad;
+            sol->F[row] += (hloss + net->Node[i].El) / hgrad;
+            hyd->X_tmp[i] -= hyd->EmitterFlows[i];
+            e++;
+        }
+
+        // Pressure dependent demand (see demandcoeffs())
+        if (hyd->NodeDemand[i] > 0.0)
+        {
+            demandheadloss(hyd->DemandFlows[i], hyd->NodeDemand[i], dp, n,
+                           &hloss, &hgrad);
+            sol->Aii[row] += 1.0 / hgrad;
+            sol->F[row] += (hloss + net->Node[i].El + hyd->Pmin) / hgrad;
+        }
+
+        // Flow balance (see nodecoeffs())
+        hyd->X_tmp[i] -= hyd->DemandFlows[i];
+        sol->F[row] += hyd->X_tmp[i];
+    }
+}
+
+
 void  nodecoeffs(EN_Project *pr)
 /*
 **----------------------------------------------------------------
@@ -264,6 +625,10 @@ void  nodecoeffs(EN_Project *pr)
 **  Output:  none
 **  Purpose: completes calculation of nodal flow balance array
 **           (X_tmp) & r.h.s. (F) of linearized hydraulic eqns.
+**
+**  Note: The head of a junction in a block held at its solution
+**        is fixed by giving it an identity row (no other coeffs.
+**        are formed for the block).
 **----------------------------------------------------------------
 */
 {
@@ -276,6 +641,12 @@ void  nodecoeffs(EN_Project *pr)
     // flow balance & add flow balance to RHS array F
     for (i = 1; i <= net->Njuncs; i++)
     {
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->NodeBlock[i]])
+        {
+            sol->Aii[sol->Row[i]] = 1.0;
+            sol->F[sol->Row[i]] = hyd->NodeHead[i];
+            continue;
+        }
         hyd->X_tmp[i] -= hyd->DemandFlows[i];
         sol->F[sol->Row[i]] += hyd->X_tmp[i];
     }
@@ -296,6 +667,7 @@ void  valvecoeffs(EN_Project *pr)
     int i, k, n1, n2;
 
     hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
     EN_Network   *net = &pr->network;
     Slink *link;
     Svalve *valve;
@@ -309,6 +681,7 @@ void  valvecoeffs(EN_Project *pr)
 
         // Coeffs. for fixed status valves have already been computed
         if (hyd->LinkSetting[k] == MISSING) continue;
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->LinkBlock[k]]) continue;
 
         // Start & end nodes of valve's link        
         link = &net->Link[k];
@@ -348,19 +721,21 @@ void  emittercoeffs(EN_Project *pr)
 **--------------------------------------------------------------
 */
 {
-    int     i, row;
+    int     i, j, row;
     double  hloss, hgrad;
 
     hydraulics_t *hyd = &pr->hydraulics;
     solver_t     *sol = &hyd->solver;
+    kernels_t    *kn = &hyd->kernels;
     EN_Network   *net = &pr->network;
     Snode *node;
 
-    for (i = 1; i <= net->Njuncs; i++)
+    // Examine each junction with an emitter
+    for (j = 1; j <= kn->Nemitters; j++)
     {
-        // Skip junctions without emitters
+        i = kn->Emitter[j];
         node = &net->Node[i];
-        if (node->Ke == 0.0) continue;
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->NodeBlock[i]]) continue;
 
         // Find emitter head loss and gradient
         emitheadloss(pr, i, &hloss, &hgrad);
@@ -473,7 +848,6 @@ void  demandcoeffs(EN_Project *pr)
     EN_Network   *net = &pr->network;
 
     // Get demand function parameters
-    if (hyd->DemandModel == DDA) return;
     demandparams(pr, &dp, &n);
 
     // Examine each junction node
@@ -481,6 +855,7 @@ void  demandcoeffs(EN_Project *pr)
     {
         // Skip junctions with non-positive demands
         if (hyd->NodeDemand[i] <= 0.0) continue;
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->NodeBlock[i]]) continue;
 
         // Find head loss for demand outflow at node's elevation
         demandheadloss(hyd->DemandFlows[i], hyd->NodeDemand[i], dp, n,
@@ -568,7 +943,8 @@ void  pipecoeff(EN_Project *pr, int k)
 **--------------------------------------------------------------
 **   Input:   k = link index
 **   Output:  none
-**   Purpose:  computes P & Y coefficients for pipe k.
+**   Purpose:  computes P & Y coefficients for pipe k for the
+**             Hazen-Williams or Chezy-Manning formula.
 **
 **    P = inverse head loss gradient = 1/hgrad
 **    Y = flow correction term = hloss / hgrad
@@ -592,13 +968,6 @@ void  pipecoeff(EN_Project *pr, int k)
         return;
     }
 
-    // Use custom function for Darcy-Weisbach formula
-    if (hyd->Formflag == DW)
-    {
-        DWpipecoeff(pr, k);
-        return;
-    }
-
     q = ABS(hyd->LinkFlows[k]);
     ml = pr->network.Link[k].Km;
     r = pr->network.Link[k].R;
@@ -633,6 +1002,69 @@ void  pipecoeff(EN_Project *pr, int k)
 }
 
 
+void  pipecoeffs(EN_Project *pr, int i1, int i2)
+/*
+**--------------------------------------------------------------
+**   Input:   i1, i2 = first and last pipe (see loadlinkarrays())
+**   Output:  none
+**   Purpose: computes P & Y coefficients of a range of pipes for
+**            the Hazen-Williams or Chezy-Manning formula.
+**
+**   Note: The same values as pipecoeff() are found, but each
+**         choice it makes is replaced by a selection between
+**         values that are both computed (adding a zero minor
+**         loss changes nothing), so the loop has no branches
+**         and reads only the contiguous pipe arrays. When the
+**         CPU has SIMD instructions several pipes are done at
+**         once by the kernels of HYDSIMD.C instead.
+**--------------------------------------------------------------
+*/
+{
+    int    i, k;
+    double flow, q, hloss, hgrad, hlin;
+    int    closed;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    linkarrays_t *la = &hyd->links;
+    double n = hyd->Hexp;
+    double rq = hyd->RQtol;
+
+    if (la->Width > 1)
+    {
+        loadpipeflows(pr, i1, i2);
+        simdpipecoeffs(la->Width, i2 - i1 + 1, n, rq, la->Q+i1, la->R+i1,
+                       la->Km+i1, la->Qa+i1, la->Pp+i1, la->Yp+i1);
+        storepipecoeffs(pr, i1, i2);
+        return;
+    }
+
+    for (i = i1; i <= i2; i++)
+    {
+        k = la->Pipe[i];
+        flow = hyd->LinkFlows[k];
+        q = ABS(flow);
+
+        // Friction head loss, linear for small flows
+        hgrad = n * la->R[i] * pow(q, n - 1.0);
+        hloss = hgrad * q / n;
+        hlin = rq * q;
+        hloss = (q <= la->Qa[i]) ? hlin : hloss;
+        hgrad = (q <= la->Qa[i]) ? rq : hgrad;
+
+        // Minor head loss
+        hloss += la->Km[i] * q * q;
+        hgrad += 2.0 * la->Km[i] * q;
+        hloss = (flow < 0.0) ? -hloss : hloss;
+
+        // P and Y coeffs. (closed pipe uses hloss = CBIG*q)
+        closed = (hyd->LinkStatus[k] <= CLOSED);
+        sol->P[k] = closed ? 1.0 / CBIG : 1.0 / hgrad;
+        sol->Y[k] = closed ? flow : hloss / hgrad;
+    }
+}
+
+
 void DWpipecoeff(EN_Project *pr, int k)
 /*
 **--------------------------------------------------------------
@@ -647,36 +1079,155 @@ void DWpipecoeff(EN_Project *pr, int k)
     solver_t     *sol = &hyd->solver;
     Slink *link = &pr->network.Link[k];
 
-    double q = ABS(hyd->LinkFlows[k]);
-    double r = link->R;                         // Resistance coeff. 
-    double ml = link->Km;                       // Minor loss coeff. 
-    double e = link->Kc / link->Diam;           // Relative roughness
-    double s = hyd->Viscos * link->Diam;        // Viscosity / diameter
-    
+    // For closed pipe use headloss formula: hloss = CBIG*q
+    if (hyd->LinkStatus[k] <= CLOSED)
+    {
+        sol->P[k] = 1.0 / CBIG;
+        sol->Y[k] = hyd->LinkFlows[k];
+        return;
+    }
+
+    DWcoeff(hyd->LinkFlows[k], link->R, link->Km, link->Kc / link->Diam,
+            hyd->Viscos * link->Diam, &sol->P[k], &sol->Y[k]);
+}
+
+
+void DWpipecoeffs(EN_Project *pr, int i1, int i2)
+/*
+**--------------------------------------------------------------
+**   Input:   i1, i2 = first and last pipe (see loadlinkarrays())
+**   Output:  none
+**   Purpose: computes P & Y coefficients of a range of pipes for
+**            the Darcy-Weisbach formula from the contiguous pipe
+**            arrays (with the SIMD kernels of HYDSIMD.C when the
+**            CPU has them).
+**--------------------------------------------------------------
+*/
+{
+    int i, k;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    linkarrays_t *la = &hyd->links;
+
+    if (la->Width > 1)
+    {
+        loadpipeflows(pr, i1, i2);
+        simdDWcoeffs(la->Width, i2 - i1 + 1, la->Q+i1, la->R+i1, la->Km+i1,
+                     la->Erel+i1, la->Vd+i1, la->Pp+i1, la->Yp+i1);
+        storepipecoeffs(pr, i1, i2);
+        return;
+    }
+
+    for (i = i1; i <= i2; i++)
+    {
+        k = la->Pipe[i];
+        if (hyd->LinkStatus[k] <= CLOSED)
+        {
+            sol->P[k] = 1.0 / CBIG;
+            sol->Y[k] = hyd->LinkFlows[k];
+            continue;
+        }
+        DWcoeff(hyd->LinkFlows[k], la->R[i], la->Km[i], la->Erel[i],
+                la->Vd[i], &sol->P[k], &sol->Y[k]);
+    }
+}
+
+
+void loadpipeflows(EN_Project *pr, int i1, int i2)
+/*
+**--------------------------------------------------------------
+**   Input:   i1, i2 = first and last pipe
+**   Output:  none
+**   Purpose: copies the flow of each pipe into the contiguous
+**            pipe arrays used by the SIMD kernels.
+**--------------------------------------------------------------
+*/
+{
+    int i;
+    hydraulics_t *hyd = &pr->hydraulics;
+    linkarrays_t *la = &hyd->links;
+
+    for (i = i1; i <= i2; i++)
+    {
+        la->Q[i] = hyd->LinkFlows[la->Pipe[i]];
+    }
+}
+
+
+void storepipecoeffs(EN_Project *pr, int i1, int i2)
+/*
+**--------------------------------------------------------------
+**   Input:   i1, i2 = first and last pipe
+**   Output:  none
+**   Purpose: copies the P & Y coeffs. found by the SIMD kernels
+**            back to each pipe, replacing those of closed pipes
+**            (which use hloss = CBIG*q).
+**--------------------------------------------------------------
+*/
+{
+    int i, k;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    linkarrays_t *la = &hyd->links;
+
+    for (i = i1; i <= i2; i++)
+    {
+        k = la->Pipe[i];
+        if (hyd->LinkStatus[k] <= CLOSED)
+        {
+            sol->P[k] = 1.0 / CBIG;
+            sol->Y[k] = la->Q[i];
+        }
+        else
+        {
+            sol->P[k] = la->Pp[i];
+            sol->Y[k] = la->Yp[i];
+        }
+    }
+}
+
+
+void DWcoeff(double flow, double r, double ml, double e, double s,
+             double *p, double *y)
+/*
+**--------------------------------------------------------------
+**   Input:   flow = pipe flow
+**            r    = resistance coeff.
+**            ml   = minor loss coeff.
+**            e    = pipe roughness / diameter
+**            s    = viscosity * pipe diameter
+**   Output:  p = inverse head loss gradient
+**            y = flow correction term
+**   Purpose: computes a pipe's head loss coeffs. for the
+**            Darcy-Weisbach formula.
+**--------------------------------------------------------------
+*/
+{
+    double q = ABS(flow);
     double hloss, hgrad, f, dfdq, r1;
-    
+
     // Compute head loss and its derivative
     // ... use Hagen-Poiseuille formula for laminar flow (Re <= 2000)
     if (q <= A2 * s)
     {
         r = 16.0 * PI * s * r;
-        hloss = hyd->LinkFlows[k] * (r + ml * q);
+        hloss = flow * (r + ml * q);
         hgrad  = r + 2.0 * ml * q;
     }
-    
+
     // ... otherwise use Darcy-Weisbach formula with friction factor
     else
     {
         dfdq = 0.0;
         f = frictionFactor(q, e, s, &dfdq);
         r1 = f * r + ml;
-        hloss = r1 * q * hyd->LinkFlows[k];
+        hloss = r1 * q * flow;
         hgrad = (2.0 * r1 * q) + (dfdq * r * q * q);
     }
-    
+
     // Compute P and Y coefficients
-    sol->P[k] = 1.0 / hgrad;
-    sol->Y[k] = hloss / hgrad;
+    *p = 1.0 / hgrad;
+    *y = hloss / hgrad;
 }
 
 
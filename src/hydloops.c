@@ -0,0 +1,577 @@
+/*
+*******************************************************************
+
+HYDLOOPS.C -- Null-space (loop flow) hydraulic engine for EPANET.
+
+This module solves the linearized hydraulic equations of each
+trial of hydsolve() by the null-space method instead of factorizing
+the nodal matrix. The entry points into this module are:
+   createloops() -- called from openhyd() in HYDRAUL.C
+   freeloops()   -- called from closehyd() in HYDRAUL.C
+   loopsolve()   -- called from hydsolve() in HYDSOLVER.C
+
+The coefficients formed by headlosscoeffs() and matrixcoeffs()
+describe a network of conductances: one for each link between two
+junctions (P) and one from each junction to a ground node standing
+for all nodes of known head (what is left of the junction's
+diagonal coeff.). The r.h.s. coeffs. are the flows injected at
+each junction. loopsolve() does the following:
+   1. builds a spanning tree of this graph from its edges of
+      highest conductance (see spantree()), or keeps that of the
+      previous trial if the graph's edges and their conductances
+      have changed little (see findedges())
+   2. finds the flows and heads that the injected flows produce
+      in the tree alone (see treeflows() and treeheads())
+   3. solves the dense symmetric system for the flow in each
+      co-tree edge that makes its head loss agree with the heads
+      of its end nodes (see loopflows())
+   4. finds the heads produced by the injected flows plus the
+      loop flows, which are returned in the r.h.s. array F in
+      place of those that linsolve() would have found.
+
+Each trial costs little more than a tree traversal per loop, so
+the engine suits networks with few loops compared to their size.
+Emitters, pressure dependent demands and links to tanks all add
+edges to ground, so each such junction beyond the first on a tree
+branch adds a loop.
+*******************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+#ifndef __APPLE__
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include <math.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "funcs.h"
+
+#define   GTOL   1.e-12  // Least ground coeff. relative to diagonal
+#define   TREETOL 10.0   // Conductance change that makes a tree stale
+
+// External functions
+//int   createloops(EN_Project *pr);
+//void  freeloops(EN_Project *pr);
+//int   loopsolve(EN_Project *pr);
+
+// Local functions
+static int   findedges(EN_Project *pr);
+static int   spantree(EN_Project *pr);
+static int   findset(int *set, int i);
+static void  sortedges(int n, int *e, double *g);
+static int   loopflows(EN_Project *pr);
+static void  treeflows(loops_t *lp, int n);
+static void  treeheads(loops_t *lp, int n);
+
+
+int  createloops(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: allocates memory used by the null-space engine
+**--------------------------------------------------------------
+*/
+{
+    int nj = pr->network.Njuncs;
+    int ne = pr->network.Nlinks + nj;
+    loops_t *lp = &pr->hydraulics.loops;
+    int errcode = 0;
+
+    lp->Ea     = (int *)    calloc(ne+1, sizeof(int));
+    lp->Eb     = (int *)    calloc(ne+1, sizeof(int));
+    lp->Esort  = (int *)    calloc(ne+1, sizeof(int));
+    lp->Cotree = (int *)    calloc(ne+1, sizeof(int));
+    lp->G      = (double *) calloc(ne+1, sizeof(double));
+    lp->G0     = (double *) calloc(ne+1, sizeof(double));
+    lp->Xloop  = (double *) calloc(ne+1, sizeof(double));
+    lp->Set    = (int *)    calloc(nj+1, sizeof(int));
+    lp->Xtree  = (int *)    calloc(nj+2, sizeof(int));
+    lp->Tree   = (int *)    calloc(2*nj+1, sizeof(int));
+    lp->Parent = (int *)    calloc(nj+1, sizeof(int));
+    lp->Pedge  = (int *)    calloc(nj+1, sizeof(int));
+    lp->Border = (int *)    calloc(nj+1, sizeof(int));
+    lp->Cur    = (double *) calloc(nj+1, sizeof(double));
+    lp->Head   = (double *) calloc(nj+1, sizeof(double));
+    ERRCODE(MEMCHECK(lp->Ea));
+    ERRCODE(MEMCHECK(lp->Eb));
+    ERRCODE(MEMCHECK(lp->Esort));
+    ERRCODE(MEMCHECK(lp->Cotree));
+    ERRCODE(MEMCHECK(lp->G));
+    ERRCODE(MEMCHECK(lp->G0));
+    ERRCODE(MEMCHECK(lp->Xloop));
+    ERRCODE(MEMCHECK(lp->Set));
+    ERRCODE(MEMCHECK(lp->Xtree));
+    ERRCODE(MEMCHECK(lp->Tree));
+    ERRCODE(MEMCHECK(lp->Parent));
+    ERRCODE(MEMCHECK(lp->Pedge));
+    ERRCODE(MEMCHECK(lp->Border));
+    ERRCODE(MEMCHECK(lp->Cur));
+    ERRCODE(MEMCHECK(lp->Head));
+    lp->M = NULL;
+    lp->Mcap = 0;
+    lp->Nedges = 0;
+    lp->Nloops = 0;
+    lp->Treeok = FALSE;
+    return(errcode);
+}                        /* End of createloops */
+
+
+void  freeloops(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  none
+** Purpose: frees memory used by the null-space engine
+**--------------------------------------------------------------
+*/
+{
+    loops_t *lp = &pr->hydraulics.loops;
+
+    FREE(lp->Ea);
+    FREE(lp->Eb);
+    FREE(lp->Esort);
+    FREE(lp->Cotree);
+    FREE(lp->G);
+    FREE(lp->G0);
+    FREE(lp->Xloop);
+    FREE(lp->Set);
+    FREE(lp->Xtree);
+    FREE(lp->Tree);
+    FREE(lp->Parent);
+    FREE(lp->Pedge);
+    FREE(lp->Border);
+    FREE(lp->Cur);
+    FREE(lp->Head);
+    FREE(lp->M);
+    lp->Mcap = 0;
+    lp->Treeok = FALSE;
+}                        /* End of freeloops */
+
+
+int  loopsolve(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns 0 if solution found, or index of
+**          equation causing ill-conditioning problem,
+**          or -1 if out of memory
+** Purpose: solves the linearized hydraulic equations formed
+**          by matrixcoeffs() for the junction heads, which
+**          replace the r.h.s. coeffs. in F as with linsolve()
+**--------------------------------------------------------------
+*/
+{
+    int i, errcode;
+    int nj = pr->network.Njuncs;
+    solver_t *solver = &pr->hydraulics.solver;
+    loops_t  *lp = &pr->hydraulics.loops;
+
+    // The tree of the last trial is kept while the graph has the
+    // same edges and no conductance has changed by more than a
+    // factor of TREETOL (opening or closing a link always does)
+    if (findedges(pr) || !lp->Treeok)
+    {
+        lp->Treeok = FALSE;
+        errcode = spantree(pr);
+        if (errcode) return(errcode);
+        lp->Treeok = TRUE;
+    }
+    errcode = loopflows(pr);
+    if (errcode) return(errcode);
+    for (i = 1; i <= nj; i++) solver->F[solver->Row[i]] = lp->Head[i];
+    return(0);
+}                        /* End of loopsolve */
+
+
+int  findedges(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns 1 if the edges differ from those the current
+**          spanning tree was found for, or if the conductance
+**          of any of them has changed by more than a factor of
+**          TREETOL since then, 0 otherwise
+** Purpose: forms the edges of the graph of conductances from
+**          the coeffs. of the linearized hydraulic equations
+**--------------------------------------------------------------
+*/
+{
+    int i, k, n1, n2, ne = 0, changed = 0;
+    int nj = pr->network.Njuncs;
+    Slink    *link;
+    solver_t *solver = &pr->hydraulics.solver;
+    loops_t  *lp = &pr->hydraulics.loops;
+    double   *gnd = lp->Head;
+
+    // Start each junction's ground coeff. from its diagonal coeff.
+    for (i = 1; i <= nj; i++) gnd[i] = solver->Aii[solver->Row[i]];
+
+    // Add an edge for each link between two junctions that has a
+    // coeff. in the matrix (see linkcoeffs() and valvecoeffs())
+    for (k = 1; k <= pr->network.Nlinks; k++)
+    {
+        if (solver->P[k] <= 0.0) continue;
+        if (solver->Nfrozen > 0 && solver->Frozen[solver->LinkBlock[k]]) continue;
+        link = &pr->network.Link[k];
+        n1 = link->N1;
+        n2 = link->N2;
+        if (n1 > nj || n2 > nj) continue;
+        ne++;
+        if (ne > lp->Nedges || lp->Ea[ne] != n1 || lp->Eb[ne] != n2) changed = 1;
+        lp->Ea[ne] = n1;
+        lp->Eb[ne] = n2;
+        lp->G[ne] = solver->P[k];
+        if (lp->G[ne] > TREETOL * lp->G0[ne] || lp->G[ne] * TREETOL < lp->G0[ne]) changed = 1;
+        gnd[n1] -= solver->P[k];
+        gnd[n2] -= solver->P[k];
+    }
+
+    // Whatever is left of a junction's diagonal joins it to ground
+    // (links to tanks, emitters, demands, active valves and the
+    // identity rows of blocks held at their solution)
+    for (i = 1; i <= nj; i++)
+    {
+        if (gnd[i] <= GTOL * solver->Aii[solver->Row[i]]) continue;
+        ne++;
+        if (ne > lp->Nedges || lp->Ea[ne] != i || lp->Eb[ne] != 0) changed = 1;
+        lp->Ea[ne] = i;
+        lp->Eb[ne] = 0;
+        lp->G[ne] = gnd[i];
+        if (lp->G[ne] > TREETOL * lp->G0[ne] || lp->G[ne] * TREETOL < lp->G0[ne]) changed = 1;
+    }
+    if (ne != lp->Nedges) changed = 1;
+    lp->Nedges = ne;
+    return(changed);
+}                        /* End of findedges */
+
+
+int  spantree(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns 0 if every junction is joined to ground,
+**          or else the matrix row of a junction that is not
+** Purpose: finds a spanning tree of the graph of conductances
+**          rooted at ground and lists its co-tree edges
+**
+** NOTE: edges are added to the tree in order of decreasing
+**       conductance (Kruskal's method), so that the links of
+**       least resistance carry the tree flows and those of
+**       highest resistance (e.g. closed links) close the loops.
+**--------------------------------------------------------------
+*/
+{
+    int i, j, m, u, v, e, a, b, head;
+    int nt = 0, nl = 0;
+    int nj = pr->network.Njuncs;
+    int ne;
+    loops_t *lp = &pr->hydraulics.loops;
+
+    // Sort the edges by conductance
+    ne = lp->Nedges;
+    for (e = 1; e <= ne; e++) lp->Esort[e] = e;
+    memcpy(lp->G0, lp->G, (ne+1) * sizeof(double));
+    sortedges(ne, lp->Esort, lp->G);
+
+    // Keep each edge that joins two different trees of the forest
+    // (tree edges are moved to the front of Esort)
+    for (i = 0; i <= nj; i++) lp->Set[i] = i;
+    for (m = 1; m <= ne; m++)
+    {
+        e = lp->Esort[m];
+        a = findset(lp->Set, lp->Ea[e]);
+        b = findset(lp->Set, lp->Eb[e]);
+        if (a == b) lp->Cotree[++nl] = e;
+        else
+        {
+            lp->Set[a] = b;
+            lp->Esort[++nt] = e;
+        }
+    }
+    lp->Nloops = nl;
+
+    // Store the tree edges adjacent to each node
+    memset(lp->Xtree, 0, (nj+2) * sizeof(int));
+    for (m = 1; m <= nt; m++)
+    {
+        e = lp->Esort[m];
+        lp->Xtree[lp->Ea[e]+1]++;
+        lp->Xtree[lp->Eb[e]+1]++;
+    }
+    for (i = 1; i <= nj+1; i++) lp->Xtree[i] += lp->Xtree[i-1];
+    for (m = 1; m <= nt; m++)
+    {
+        e = lp->Esort[m];
+        lp->Tree[lp->Xtree[lp->Ea[e]]++] = e;
+        lp->Tree[lp->Xtree[lp->Eb[e]]++] = e;
+    }
+    for (i = nj+1; i > 0; i--) lp->Xtree[i] = lp->Xtree[i-1];
+    lp->Xtree[0] = 0;
+
+    // Visit the tree breadth-first from ground
+    for (i = 0; i <= nj; i++) lp->Parent[i] = -1;
+    lp->Parent[0] = 0;
+    lp->Pedge[0] = 0;
+    lp->Border[0] = 0;
+    head = 0;
+    m = 1;
+    while (head < m)
+    {
+        u = lp->Border[head++];
+        for (j = lp->Xtree[u]; j < lp->Xtree[u+1]; j++)
+        {
+            e = lp->Tree[j];
+            v = (lp->Ea[e] == u) ? lp->Eb[e] : lp->Ea[e];
+            if (lp->Parent[v] >= 0) continue;
+            lp->Parent[v] = u;
+            lp->Pedge[v] = e;
+            lp->Border[m++] = v;
+        }
+    }
+
+    // A junction not reached has no path of finite resistance
+    // to a node of known head
+    if (m <= nj)
+    {
+        for (i = 1; i <= nj; i++)
+        {
+            if (lp->Parent[i] < 0) return(pr->hydraulics.solver.Row[i]);
+        }
+    }
+    return(0);
+}                        /* End of spantree */
+
+
+int  findset(int *set, int i)
+/*
+**--------------------------------------------------------------
+** Input:   set = union-find parent of each node
+**          i   = a node
+** Output:  returns the root of the tree containing node i
+** Purpose: finds the tree of a spanning forest holding a node
+**          (halving the path to the root as it goes)
+**--------------------------------------------------------------
+*/
+{
+    while (set[i] != i)
+    {
+        set[i] = set[set[i]];
+        i = set[i];
+    }
+    return(i);
+}                        /* End of findset */
+
+
+void  sortedges(int n, int *e, double *g)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of edges
+**          e = edge indexes (e[1] to e[n])
+**          g = conductance of each edge
+** Output:  e = edge indexes in order of decreasing conductance
+** Purpose: heap sorts a list of edges by their conductance
+**--------------------------------------------------------------
+*/
+{
+    int i, j, k, m, t;
+
+    // Build a heap with the least conductance at its top
+    for (k = n/2; k >= 1; k--)
+    {
+        t = e[k];
+        for (i = k; (j = 2*i) <= n; i = j)
+        {
+            if (j < n && g[e[j+1]] < g[e[j]]) j++;
+            if (g[t] <= g[e[j]]) break;
+            e[i] = e[j];
+        }
+        e[i] = t;
+    }
+
+    // Move the top of the heap to the end of the list
+    for (m = n; m > 1; m--)
+    {
+        t = e[m];
+        e[m] = e[1];
+        for (i = 1; (j = 2*i) < m; i = j)
+        {
+            if (j+1 < m && g[e[j+1]] < g[e[j]]) j++;
+            if (g[t] <= g[e[j]]) break;
+            e[i] = e[j];
+        }
+        e[i] = t;
+    }
+}                        /* End of sortedges */
+
+
+int  loopflows(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns 0 if successful, the matrix row of a
+**          junction on a loop whose equation is singular,
+**          or -1 if out of memory
+** Purpose: solves for the flow in each co-tree edge and leaves
+**          the resulting junction heads in Head
+**
+** NOTE: the flow x in a co-tree edge from node a to node b is
+**       carried through the tree as an outflow x at a and an
+**       inflow x at b. Its head loss x/G must equal the head
+**       difference H(a) - H(b) that the tree flows produce, so
+**       that the loop flows solve  M x = H0(a) - H0(b)  where H0
+**       are the heads of the tree alone, M = 1/G on the diagonal
+**       plus the heads V(b) - V(a) of each co-tree edge when a
+**       unit inflow at the end and outflow at the start of each
+**       other co-tree edge is carried through the tree. M is the
+**       symmetric positive definite loop resistance matrix.
+**--------------------------------------------------------------
+*/
+{
+    int i, j, k, e, f;
+    int nj = pr->network.Njuncs;
+    int nl;
+    double diag, l, *mj, *mk, *m;
+    solver_t *solver = &pr->hydraulics.solver;
+    loops_t  *lp = &pr->hydraulics.loops;
+
+    // Heads produced in the tree by the injected flows
+    for (i = 1; i <= nj; i++) lp->Cur[i] = solver->F[solver->Row[i]];
+    treeflows(lp, nj);
+    treeheads(lp, nj);
+    nl = lp->Nloops;
+    if (nl == 0) return(0);
+    for (k = 1; k <= nl; k++)
+    {
+        e = lp->Cotree[k];
+        lp->Xloop[k] = lp->Head[lp->Ea[e]] - lp->Head[lp->Eb[e]];
+    }
+
+    // Make room for the loop matrix (its entries depend on this
+    // trial's conductances so only its storage is kept)
+    if ((size_t)nl * nl > lp->Mcap)
+    {
+        if ((size_t)nl > SIZE_MAX / sizeof(double) / (size_t)nl) return(-1);
+        m = (double *) realloc(lp->M, (size_t)nl * nl * sizeof(double));
+        if (m == NULL) return(-1);
+        lp->M = m;
+        lp->Mcap = (size_t)nl * nl;
+    }
+    m = lp->M - (nl + 1);
+
+    // Form each column of the lower triangle of M (column-major,
+    // indexed from 1) from the heads of a unit loop flow
+    for (j = 1; j <= nl; j++)
+    {
+        f = lp->Cotree[j];
+        memset(lp->Cur, 0, (nj+1) * sizeof(double));
+        lp->Cur[lp->Ea[f]] -= 1.0;
+        lp->Cur[lp->Eb[f]] += 1.0;
+        treeflows(lp, nj);
+        treeheads(lp, nj);
+        mj = m + (size_t)j * nl;
+        for (i = j; i <= nl; i++)
+        {
+            e = lp->Cotree[i];
+            mj[i] = lp->Head[lp->Eb[e]] - lp->Head[lp->Ea[e]];
+        }
+        mj[j] += 1.0 / lp->G[f];
+    }
+
+    // Factorize M by dense Cholesky
+    for (j = 1; j <= nl; j++)
+    {
+        mj = m + (size_t)j * nl;
+        diag = mj[j];
+        if (diag <= 0.0) return(solver->Row[lp->Ea[lp->Cotree[j]]]);
+        diag = sqrt(diag);
+        mj[j] = diag;
+        for (i = j+1; i <= nl; i++) mj[i] /= diag;
+        for (k = j+1; k <= nl; k++)
+        {
+            l = mj[k];
+            if (l == 0.0) continue;
+            mk = m + (size_t)k * nl;
+            for (i = k; i <= nl; i++) mk[i] -= mj[i] * l;
+        }
+    }
+
+    // Forward and back substitution for the loop flows
+    for (j = 1; j <= nl; j++)
+    {
+        mj = m + (size_t)j * nl;
+        lp->Xloop[j] /= mj[j];
+        l = lp->Xloop[j];
+        for (i = j+1; i <= nl; i++) lp->Xloop[i] -= mj[i] * l;
+    }
+    for (j = nl; j >= 1; j--)
+    {
+        mj = m + (size_t)j * nl;
+        l = lp->Xloop[j];
+        for (i = j+1; i <= nl; i++) l -= mj[i] * lp->Xloop[i];
+        lp->Xloop[j] = l / mj[j];
+    }
+
+    // Heads produced by the injected flows plus the loop flows
+    for (i = 1; i <= nj; i++) lp->Cur[i] = solver->F[solver->Row[i]];
+    for (k = 1; k <= nl; k++)
+    {
+        e = lp->Cotree[k];
+        lp->Cur[lp->Ea[e]] -= lp->Xloop[k];
+        lp->Cur[lp->Eb[e]] += lp->Xloop[k];
+    }
+    treeflows(lp, nj);
+    treeheads(lp, nj);
+    return(0);
+}                        /* End of loopflows */
+
+
+void  treeflows(loops_t *lp, int n)
+/*
+**--------------------------------------------------------------
+** Input:   lp = null-space engine data (Cur = inflow at
+**               each junction)
+**          n  = number of junctions
+** Output:  Cur = flow from each junction to its tree parent
+** Purpose: carries the inflows at the junctions down the
+**          spanning tree to ground
+**--------------------------------------------------------------
+*/
+{
+    int m, i;
+
+    for (m = n; m >= 1; m--)
+    {
+        i = lp->Border[m];
+        lp->Cur[lp->Parent[i]] += lp->Cur[i];
+    }
+}                        /* End of treeflows */
+
+
+void  treeheads(loops_t *lp, int n)
+/*
+**--------------------------------------------------------------
+** Input:   lp = null-space engine data (Cur = flow from each
+**               junction to its tree parent)
+**          n  = number of junctions
+** Output:  Head = head of each junction above ground
+** Purpose: adds up the head losses of the tree flows from
+**          ground out to each junction
+**--------------------------------------------------------------
+*/
+{
+    int m, i;
+
+    lp->Head[0] = 0.0;
+    for (m = 1; m <= n; m++)
+    {
+        i = lp->Border[m];
+        lp->Head[i] = lp->Head[lp->Parent[i]] + lp->Cur[i] / lp->G[lp->Pedge[i]];
+    }
+}                        /* End of treeheads */
+
+/************************ END OF HYDLOOPS.C ************************/
@@ -34,6 +34,13 @@ AUTHOR:     L. Rossman
   External functions called by this module are:
      createsparse() -- see SMATRIX.C
      freesparse()   -- see SMATRIX.C
+     createloops()  -- see HYDLOOPS.C
+     freeloops()    -- see HYDLOOPS.C
+     createcache(),
+     freecache(),
+     clearcache(),
+     usecached(),
+     savecached()   -- see HYDCACHE.C
      resistcoeff()  -- see HYDCOEFFS.C
      hydsolve()     -- see HYDSOLVER.C
      checkrules()   -- see RULES.C
@@ -60,6 +67,7 @@ AUTHOR:     L. Rossman
 #include "text.h"
 
 #define   QZERO  1.e-6  /* Equivalent to zero flow */
+#define   QFIT   0.5    /* Share of flow imbalance a prediction may leave */
 
 // Local functions
 int     allocmatrix(EN_Project *pr);
@@ -67,6 +75,10 @@ void    freematrix(EN_Project *pr);
 void    initlinkflow(EN_Project *pr, int, char, double);
 void    setlinkflow(EN_Project *pr, int, double);
 void    demands(EN_Project *pr);
+void    predictflows(EN_Project *pr);
+void    saveflows(EN_Project *pr, int iter);
+int     samedemand(double d, double d0);
+double  flowimbalance(EN_Project *pr);
 int     controls(EN_Project *pr);
 long    timestep(EN_Project *pr);
 void    controltimestep(EN_Project *pr, long *);
@@ -88,6 +100,12 @@ int  openhyd(EN_Project *pr)
     int  errcode = 0;
     ERRCODE(createsparse(pr));     /* See SMATRIX.C  */
     ERRCODE(allocmatrix(pr));      /* Allocate solution matrices */
+    if (pr->hydraulics.Engine == NULLSPACE)
+    {
+        ERRCODE(createloops(pr));  /* See HYDLOOPS.C */
+    }
+    ERRCODE(createcache(pr));      /* See HYDCACHE.C */
+    if (!errcode) setkernels(pr);  /* See HYDCOEFFS.C */
     for (i=1; i <= pr->network.Nlinks; i++) {   /* Initialize flows */
         Slink *link = &pr->network.Link[i];
         initlinkflow(pr, i, link->Stat, link->Kc);
@@ -175,6 +193,20 @@ void inithyd(EN_Project *pr, int initflag)
         fseek(out->HydFile,out->HydOffset,SEEK_SET);
     }
 
+    /* Discard solutions saved by the flow predictor */
+    hyd->predictor.Nsaved = 0;
+    if (hyd->predictor.Nsame)
+    {
+        memset(hyd->predictor.Nsame, 0, (net->Nlinks+1) * sizeof(char));
+    }
+    hyd->predictor.Predicted = FALSE;
+    hyd->predictor.Trials = 0;
+    hyd->predictor.Periods = 0;
+    hyd->predictor.Saved = 0.0;
+
+    /* Discard solutions kept in the solution cache */
+    clearcache(pr);
+
 /*** Updated 3/1/01 ***/
     /* Initialize current time */
     hyd->Haltflag = 0;
@@ -207,8 +239,26 @@ int   runhyd(EN_Project *pr, long *t)
     demands(pr);
     controls(pr);
 
-    /* Solve network hydraulic equations */
-    errcode = hydsolve(pr,&iter,&relerr);
+    /* Start from flows extrapolated from past periods */
+    predictflows(pr);
+
+    /* Take the solution from the cache if it holds one for the */
+    /* same inputs, otherwise solve network hydraulic equations */
+    if (usecached(pr)) {
+        iter = 0;
+        relerr = hyd->RelativeError;
+        errcode = 0;
+        saveflows(pr,iter);
+    }
+    else {
+        errcode = hydsolve(pr,&iter,&relerr);
+        if (!errcode) {
+            /* Save solution for reuse & for predicting next */
+            /* period's flows */
+            savecached(pr,relerr);
+            saveflows(pr,iter);
+        }
+    }
 
     if (!errcode) {
         /* Report new status & save results */
@@ -308,6 +358,8 @@ void  closehyd(EN_Project *pr)
 */
 {
    freesparse(pr);           /* see SMATRIX.C */
+   freeloops(pr);            /* see HYDLOOPS.C */
+   freecache(pr);            /* see HYDCACHE.C */
    freematrix(pr);
 }
 
@@ -324,8 +376,10 @@ int  allocmatrix(EN_Project *pr)
   EN_Network *net = &pr->network;
   hydraulics_t *hyd = &pr->hydraulics;
   solver_t *s = &hyd->solver;
+  linkarrays_t *la = &hyd->links;
+  predictor_t *pd = &hyd->predictor;
   
-   int errcode = 0;
+   int i, errcode = 0;
    s->Aii = (double *) calloc(net->Nnodes+1,sizeof(double));
    s->Aij = (double *) calloc(hyd->Ncoeffs+1,sizeof(double));
    s->F   = (double *) calloc(net->Nnodes+1,sizeof(double));
@@ -344,6 +398,73 @@ int  allocmatrix(EN_Project *pr)
    ERRCODE(MEMCHECK(s->Y));
    ERRCODE(MEMCHECK(hyd->X_tmp));
    ERRCODE(MEMCHECK(hyd->OldStat));
+
+   /* Contiguous link data used to find head loss coeffs. */
+   la->N1    = (int *)    calloc(net->Nlinks+1, sizeof(int));
+   la->N2    = (int *)    calloc(net->Nlinks+1, sizeof(int));
+   la->Pipe  = (int *)    calloc(net->Nlinks+1, sizeof(int));
+   la->Other = (int *)    calloc(net->Nlinks+1, sizeof(int));
+   la->Checked = (int *)  calloc(net->Nlinks+1, sizeof(int));
+   la->Pvalves = (int *)  calloc(net->Nlinks+1, sizeof(int));
+   la->R     = (double *) calloc(net->Nlinks+1, sizeof(double));
+   la->Km    = (double *) calloc(net->Nlinks+1, sizeof(double));
+   la->Qa    = (double *) calloc(net->Nlinks+1, sizeof(double));
+   la->Erel  = (double *) calloc(net->Nlinks+1, sizeof(double));
+   la->Vd    = (double *) calloc(net->Nlinks+1, sizeof(double));
+   ERRCODE(MEMCHECK(la->N1));
+   ERRCODE(MEMCHECK(la->N2));
+   ERRCODE(MEMCHECK(la->Pipe));
+   ERRCODE(MEMCHECK(la->Other));
+   ERRCODE(MEMCHECK(la->Checked));
+   ERRCODE(MEMCHECK(la->Pvalves));
+   ERRCODE(MEMCHECK(la->R));
+   ERRCODE(MEMCHECK(la->Km));
+   ERRCODE(MEMCHECK(la->Qa));
+   ERRCODE(MEMCHECK(la->Erel));
+   ERRCODE(MEMCHECK(la->Vd));
+
+   /* Junctions with emitters (see setkernels() in HYDCOEFFS.C) */
+   hyd->kernels.Emitter = (int *) calloc(net->Njuncs+1, sizeof(int));
+   ERRCODE(MEMCHECK(hyd->kernels.Emitter));
+
+   /* Pipe flows & coeffs. for the SIMD kernels (see HYDSIMD.C) */
+   la->Width = hyd->Simd ? simdwidth() : 1;
+   if (la->Width > 1)
+   {
+      la->Q  = (double *) calloc(net->Nlinks+1, sizeof(double));
+      la->Pp = (double *) calloc(net->Nlinks+1, sizeof(double));
+      la->Yp = (double *) calloc(net->Nlinks+1, sizeof(double));
+      ERRCODE(MEMCHECK(la->Q));
+      ERRCODE(MEMCHECK(la->Pp));
+      ERRCODE(MEMCHECK(la->Yp));
+   }
+
+   /* Past solutions used by the flow predictor */
+   if (hyd->Predictor > 0)
+   {
+      for (i = 0; i < 3; i++)
+      {
+         pd->Q[i] = (double *) calloc(net->Nlinks+1, sizeof(double));
+         pd->E[i] = (double *) calloc(net->Nnodes+1, sizeof(double));
+         ERRCODE(MEMCHECK(pd->Q[i]));
+         ERRCODE(MEMCHECK(pd->E[i]));
+      }
+      pd->Stat  = (StatType *) calloc(net->Nlinks+1, sizeof(StatType));
+      pd->Nsame = (char *)     calloc(net->Nlinks+1, sizeof(char));
+      ERRCODE(MEMCHECK(pd->Stat));
+      ERRCODE(MEMCHECK(pd->Nsame));
+   }
+
+   /* Status reversals of each link (see holdstatus() in HYDSTATUS.C) */
+   if (hyd->FlipLimit > 0)
+   {
+      hyd->Flips    = (int *)      calloc(net->Nlinks+1, sizeof(int));
+      hyd->PrevStat = (StatType *) calloc(net->Nlinks+1, sizeof(StatType));
+      ERRCODE(MEMCHECK(hyd->Flips));
+      hyd->Held     = (char *)     calloc(net->Nlinks+1, sizeof(char));
+      ERRCODE(MEMCHECK(hyd->PrevStat));
+      ERRCODE(MEMCHECK(hyd->Held));
+   }
    return(errcode);
 }                               /* end of allocmatrix */
 
@@ -359,6 +480,9 @@ void  freematrix(EN_Project *pr)
 {
   hydraulics_t *hyd = &pr->hydraulics;
   solver_t *s = &hyd->solver;
+  linkarrays_t *la = &hyd->links;
+  predictor_t *pd = &hyd->predictor;
+  int i;
   
    free(s->Aii);
    free(s->Aij);
@@ -369,6 +493,31 @@ void  freematrix(EN_Project *pr)
    free(s->Y);
    free(hyd->X_tmp);
    free(hyd->OldStat);
+   FREE(la->N1);
+   FREE(la->N2);
+   FREE(la->Pipe);
+   FREE(la->Other);
+   FREE(la->Checked);
+   FREE(la->Pvalves);
+   FREE(la->R);
+   FREE(la->Km);
+   FREE(la->Qa);
+   FREE(la->Erel);
+   FREE(la->Vd);
+   FREE(hyd->kernels.Emitter);
+   FREE(la->Q);
+   FREE(la->Pp);
+   FREE(la->Yp);
+   for (i = 0; i < 3; i++)
+   {
+      FREE(pd->Q[i]);
+      FREE(pd->E[i]);
+   }
+   FREE(pd->Stat);
+   FREE(pd->Nsame);
+   FREE(hyd->Flips);
+   FREE(hyd->PrevStat);
+   FREE(hyd->Held);
 }                               /* end of freematrix */
 
 
@@ -567,6 +716,230 @@ void  setlinksetting(EN_Project *pr, int index, double value, StatType *s, doubl
 } 
 
 
+void  predictflows(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  none
+**  Purpose: replaces the flows that start the solution of the
+**           current period by values extrapolated from the
+**           solutions of the last two or three demand levels
+**
+**  Note:    Flows are extrapolated against the total junction
+**           demand rather than time, so that periods in which
+**           demands stay the same (e.g. within a pattern step)
+**           keep their previous flows. No flows are predicted if
+**           any link's status has changed since the latest
+**           solution, and a link's flow is only predicted if it
+**           has had its current status over the solutions used
+**           and keeps its direction. Junction heads need no
+**           prediction since they are found anew from the flows
+**           on the first trial. Since junctions whose demands
+**           follow different patterns need not change with the
+**           total demand, the latest solution's flows are kept
+**           instead unless the predicted ones take out at least
+**           half of the junctions' flow imbalance.
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, k, m;
+    double d, d0, d1, d2, q, imbal;
+    double w[2][3];                   /* Weights of saved flows */
+
+    EN_Network     *net = &pr->network;
+    hydraulics_t   *hyd = &pr->hydraulics;
+    predictor_t    *pd = &hyd->predictor;
+    kernels_t      *kn = &hyd->kernels;
+
+    pd->Predicted = FALSE;
+    if (hyd->Predictor == 0) return;
+
+    /* Total junction demand of current period */
+    d = 0.0;
+    for (i = 1; i <= net->Njuncs; i++) d += hyd->NodeDemand[i];
+    pd->Dnow = d;
+    if (pd->Nsaved < 2 || samedemand(d, pd->D[0])) return;
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        if (hyd->LinkStatus[k] != pd->Stat[k]) return;
+    }
+    d0 = pd->D[0];
+    d1 = pd->D[1];
+    d2 = pd->D[2];
+
+    /* Weights of the straight line through the last 2 solutions ... */
+    w[0][0] = (d - d1) / (d0 - d1);
+    w[0][1] = (d - d0) / (d1 - d0);
+    w[0][2] = 0.0;
+
+    /* ... and of the parabola through the last 3 */
+    w[1][0] = w[0][0];
+    w[1][1] = w[0][1];
+    w[1][2] = 0.0;
+    if (hyd->Predictor == 2 && pd->Nsaved == 3 &&
+        !samedemand(d2, d0) && !samedemand(d2, d1))
+    {
+        w[1][0] = (d - d1) * (d - d2) / ((d0 - d1) * (d0 - d2));
+        w[1][1] = (d - d0) * (d - d2) / ((d1 - d0) * (d1 - d2));
+        w[1][2] = (d - d0) * (d - d1) / ((d2 - d0) * (d2 - d1));
+    }
+
+    /* Predict the flow of each open link */
+    imbal = flowimbalance(pr);
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        if (pd->Nsame[k] < 2) continue;
+        if (hyd->LinkStatus[k] <= CLOSED) continue;
+        m = (pd->Nsame[k] >= 3 && w[1][2] != 0.0);
+        q = w[m][0] * pd->Q[0][k] + w[m][1] * pd->Q[1][k];
+        if (m) q += w[m][2] * pd->Q[2][k];
+        if (q * pd->Q[0][k] <= 0.0) continue;
+        hyd->LinkFlows[k] = q;
+        pd->Predicted = TRUE;
+    }
+
+    /* Predict the flow of each emitter */
+    m = (w[1][2] != 0.0);
+    for (j = 1; j <= kn->Nemitters; j++)
+    {
+        i = kn->Emitter[j];
+        q = w[m][0] * pd->E[0][i] + w[m][1] * pd->E[1][i];
+        if (m) q += w[m][2] * pd->E[2][i];
+        if (q * pd->E[0][i] <= 0.0) continue;
+        hyd->EmitterFlows[i] = q;
+    }
+
+    /* Fall back to the latest solution if the prediction leaves
+       too much of its flow imbalance */
+    if (pd->Predicted && flowimbalance(pr) > QFIT * imbal)
+    {
+        memcpy(hyd->LinkFlows, pd->Q[0], (net->Nlinks+1) * sizeof(double));
+        memcpy(hyd->EmitterFlows, pd->E[0], (net->Nnodes+1) * sizeof(double));
+        pd->Predicted = FALSE;
+    }
+}
+
+
+void  saveflows(EN_Project *pr, int iter)
+/*
+**--------------------------------------------------------------
+**  Input:   iter = trials taken to solve current period
+**  Output:  none
+**  Purpose: saves the flows of the current period for use by
+**           predictflows() and estimates the trials saved by
+**           predicting them
+**
+**  Note:    A solution at the same demand level as the latest
+**           one saved replaces it. The trials saved are
+**           estimated against the mean trials of the periods
+**           (other than the first) whose flows were not
+**           predicted, leaving out those taken from the
+**           solution cache.
+**--------------------------------------------------------------
+*/
+{
+    int    k, shift;
+    double *x;
+
+    EN_Network     *net = &pr->network;
+    hydraulics_t   *hyd = &pr->hydraulics;
+    predictor_t    *pd = &hyd->predictor;
+
+    if (hyd->Predictor == 0) return;
+
+    /* Estimate trials saved */
+    pd->Saved = 0.0;
+    if (pd->Predicted)
+    {
+        if (pd->Periods > 0) pd->Saved = (double)pd->Trials / pd->Periods - iter;
+    }
+    else if (pd->Nsaved > 0 && !hyd->cache.Reused)
+    {
+        pd->Trials += iter;
+        pd->Periods++;
+    }
+
+    /* Make the oldest solution saved the latest one, unless
+       demands are those of the latest one */
+    shift = (pd->Nsaved == 0 || !samedemand(pd->Dnow, pd->D[0]));
+    if (shift)
+    {
+        x = pd->Q[2];
+        pd->Q[2] = pd->Q[1];
+        pd->Q[1] = pd->Q[0];
+        pd->Q[0] = x;
+        x = pd->E[2];
+        pd->E[2] = pd->E[1];
+        pd->E[1] = pd->E[0];
+        pd->E[0] = x;
+        pd->D[2] = pd->D[1];
+        pd->D[1] = pd->D[0];
+        pd->Nsaved = MIN(pd->Nsaved + 1, 3);
+    }
+    pd->D[0] = pd->Dnow;
+    memcpy(pd->Q[0], hyd->LinkFlows, (net->Nlinks+1) * sizeof(double));
+    memcpy(pd->E[0], hyd->EmitterFlows, (net->Nnodes+1) * sizeof(double));
+
+    /* Count solutions saved in a row in which each link has kept
+       its status */
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        if (hyd->LinkStatus[k] != pd->Stat[k] || pd->Nsame[k] == 0)
+        {
+            pd->Nsame[k] = 1;
+        }
+        else if (shift) pd->Nsame[k] = (char)MIN(pd->Nsame[k] + 1, 3);
+        pd->Stat[k] = hyd->LinkStatus[k];
+    }
+}
+
+
+int  samedemand(double d, double d0)
+/*
+**--------------------------------------------------------------
+**  Input:   d, d0 = total junction demands
+**  Output:  returns TRUE if d and d0 are the same demand level
+**  Purpose: checks if demands are too close to extrapolate
+**           flows between them
+**--------------------------------------------------------------
+*/
+{
+    return (ABS(d - d0) <= 1.e-6 * (ABS(d0) + 1.0));
+}
+
+
+double  flowimbalance(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns sum of flow imbalances at junctions
+**  Purpose: finds how far the current link and emitter flows
+**           are from meeting the current junction demands
+**--------------------------------------------------------------
+*/
+{
+    int    i, k;
+    double sum;
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    double       *x = hyd->X_tmp;
+
+    for (i = 1; i <= net->Njuncs; i++)
+    {
+        x[i] = -hyd->DemandFlows[i] - hyd->EmitterFlows[i];
+    }
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        x[net->Link[k].N1] -= hyd->LinkFlows[k];
+        x[net->Link[k].N2] += hyd->LinkFlows[k];
+    }
+    sum = 0.0;
+    for (i = 1; i <= net->Njuncs; i++) sum += ABS(x[i]);
+    return sum;
+}
+
+
 void  demands(EN_Project *pr)
 /*
 **--------------------------------------------------------------------
@@ -0,0 +1,430 @@
+/*
+*******************************************************************
+
+HYDSIMD.C -- Vectorized pipe head loss coefficients for EPANET.
+
+This module finds the P and Y coefficients of many pipes at once
+with SIMD instructions. Its entry points are:
+   simdwidth()     -- called from allocmatrix() in HYDRAUL.C
+   simdpipecoeffs() -- called from pipecoeffs() in HYDCOEFFS.C
+   simdDWcoeffs()   -- called from DWpipecoeffs() in HYDCOEFFS.C
+
+The kernels work on contiguous arrays of pipe data (see
+loadlinkarrays() in HYDCOEFFS.C) eight pipes at a time, using the
+vector extensions of GCC and Clang. They are compiled once for AVX2
+(two instructions per eight pipes) and once for AVX-512 (one), and
+simdwidth() picks the widest that the CPU running the program
+supports. Where neither is available, or the compiler has no vector
+extensions, simdwidth() returns 1 and the scalar code of HYDCOEFFS.C
+is used instead.
+
+Since the C library's pow() and log() cannot work on vectors, they
+are replaced by vlog() and vexp(), which follow the fdlibm algorithms
+and are accurate to about one unit in the last place for the range
+of arguments met here. Results therefore agree with the scalar code
+to within rounding, though not bit for bit.
+*******************************************************************
+*/
+
+#include <string.h>
+#include "types.h"
+#include "funcs.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9))
+#define SIMDKERNELS
+#endif
+
+// External functions
+//int   simdwidth(void);
+//void  simdpipecoeffs(int width, int n, double hexp, double rq,
+//                     double *flow, double *r, double *km, double *qa,
+//                     double *p, double *y);
+//void  simdDWcoeffs(int width, int n, double *flow, double *r,
+//                   double *km, double *e, double *s, double *p,
+//                   double *y);
+
+#ifdef SIMDKERNELS
+
+#define VW  8            // Pipes in each vector
+
+typedef double    vdbl __attribute__((vector_size(VW * sizeof(double))));
+typedef long long vint __attribute__((vector_size(VW * sizeof(long long))));
+
+#define INLINE static inline __attribute__((always_inline))
+
+// Constants used for computing Darcy-Weisbach friction factor
+// (see HYDCOEFFS.C)
+extern const double A1, A2, A8, A9, AB, AC;
+
+// Constants of the fdlibm log() and exp() algorithms
+static const double LN2HI  = 6.93147180369123816490e-01;
+static const double LN2LO  = 1.90821492927058770002e-10;
+static const double INVLN2 = 1.44269504088896338700e+00;
+static const double SQRT2  = 1.41421356237309514547e+00;
+static const double LG1 = 6.666666666666735130e-01;
+static const double LG2 = 3.999999999940941908e-01;
+static const double LG3 = 2.857142874366239149e-01;
+static const double LG4 = 2.222219843214978396e-01;
+static const double LG5 = 1.818357216161805012e-01;
+static const double LG6 = 1.531383769920937332e-01;
+static const double LG7 = 1.479819860511658591e-01;
+static const double EP1 =  1.66666666666666019037e-01;
+static const double EP2 = -2.77777777770155933842e-03;
+static const double EP3 =  6.61375632143793436117e-05;
+static const double EP4 = -1.65339022054652515390e-06;
+static const double EP5 =  4.13813679705723846039e-08;
+static const double RND = 6755399441055744.0;   // 1.5 * 2^52
+static const double EXPMIN = -708.0;   // Range of vexp() arguments whose
+static const double EXPMAX =  709.0;   // powers of 2 are normal numbers
+
+#define TARGET256 __attribute__((target("avx2")))
+#define TARGET512 __attribute__((target("avx512f")))
+
+// Selects a where mask m is set and b elsewhere
+#define SELECT(m, a, b)  ((vdbl)(((vint)(a) & (m)) | ((vint)(b) & ~(m))))
+
+// NOTE: vectors are passed to the functions below by pointer since
+//       passing them by value to functions that are not compiled
+//       for AVX-512 is not portable between compiler versions.
+
+INLINE void vlog(vdbl *x)
+/*
+** Replaces each element of x by its natural log (x > 0)
+*/
+{
+    vint bits = (vint)(*x);
+    vint e = ((bits >> 52) & 0x7ff) - 1023;
+    vdbl m, k, f, s, z, w, r, hfsq, rnd = {0};
+    vint big;
+
+    // x = m * 2^k with m in [sqrt(2)/2, sqrt(2))
+    m = (vdbl)((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+    big = (vint)(m > SQRT2);
+    m = SELECT(big, m * 0.5, m);
+    e -= big;
+    rnd += RND;
+    k = (vdbl)(e + (vint)rnd) - RND;
+
+    // log(1+f) = f - f^2/2 + s*(f^2/2 + R(s^2)), s = f/(2+f)
+    f = m - 1.0;
+    s = f / (2.0 + f);
+    z = s * s;
+    w = z * z;
+    r = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7))) +
+        w * (LG2 + w * (LG4 + w * LG6));
+    hfsq = 0.5 * f * f;
+    *x = k * LN2HI - ((hfsq - (s * (hfsq + r) + k * LN2LO)) - f);
+}
+
+
+INLINE void vexp(vdbl *x)
+/*
+** Replaces each element of x by e raised to it (x is first clamped
+** to [EXPMIN, EXPMAX], so results below about 1e-308 or above about
+** 1e308 are not exact)
+*/
+{
+    vdbl k, hi, lo, r, t, c, y, rnd = {0}, xmin = {0}, xmax = {0};
+    vint ki;
+
+    // Clamp x so that 2^k is a normal number, as forming it from
+    // (ki + 1023) << 52 requires
+    xmin += EXPMIN;
+    xmax += EXPMAX;
+    *x = SELECT((vint)(*x < xmin), xmin, *x);
+    *x = SELECT((vint)(*x > xmax), xmax, *x);
+
+    // x = k*ln2 + r with |r| <= ln2/2 (k is rounded by adding
+    // 1.5*2^52, which also leaves it in the low bits of the sum)
+    rnd += RND;
+    t = *x * INVLN2 + rnd;
+    ki = (vint)t - (vint)rnd;
+    k = t - RND;
+    hi = *x - k * LN2HI;
+    lo = k * LN2LO;
+    r = hi - lo;
+
+    // exp(r) = 1 + r + r*c/(2-c) where c = r - r^2*P(r^2)
+    t = r * r;
+    c = r - t * (EP1 + t * (EP2 + t * (EP3 + t * (EP4 + t * EP5))));
+    y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+    // Scale by 2^k
+    *x = y * (vdbl)((ki + 1023) << 52);
+}
+
+
+INLINE void hwblock(double n, double rq, const double *fq, const double *pr,
+                    const double *pkm, const double *pqa, double *p, double *y)
+/*
+** Computes the coeffs. of VW pipes for the Hazen-Williams or
+** Chezy-Manning formula (see pipecoeffs() in HYDCOEFFS.C)
+*/
+{
+    vdbl flow, q, r, km, qa, hgrad, hloss, pw, vrq = {0};
+    vint lin, neg;
+
+    memcpy(&flow, fq, sizeof(vdbl));
+    memcpy(&r, pr, sizeof(vdbl));
+    memcpy(&km, pkm, sizeof(vdbl));
+    memcpy(&qa, pqa, sizeof(vdbl));
+    neg = (vint)(flow < 0.0);
+    q = SELECT(neg, -flow, flow);
+
+    // Friction head loss, linear for small flows
+    if (n == 2.0) pw = q;
+    else
+    {
+        pw = q;
+        vlog(&pw);
+        pw *= n - 1.0;
+        vexp(&pw);
+    }
+    hgrad = n * r * pw;
+    hloss = hgrad * q / n;
+    lin = (vint)(q <= qa);
+    hloss = SELECT(lin, rq * q, hloss);
+    vrq += rq;
+    hgrad = SELECT(lin, vrq, hgrad);
+
+    // Minor head loss
+    hloss += km * q * q;
+    hgrad += 2.0 * km * q;
+    hloss = SELECT(neg, -hloss, hloss);
+
+    flow = 1.0 / hgrad;
+    memcpy(p, &flow, sizeof(vdbl));
+    flow = hloss / hgrad;
+    memcpy(y, &flow, sizeof(vdbl));
+}
+
+
+INLINE void dwblock(const double *fq, const double *pr, const double *pkm,
+                    const double *pe, const double *ps, double *p, double *y)
+/*
+** Computes the coeffs. of VW pipes for the Darcy-Weisbach formula
+** (see DWcoeff() and frictionFactor() in HYDCOEFFS.C)
+*/
+{
+    vdbl flow, q, r, ml, e, s, w, rl, y1, y2, y3, f, dfdq;
+    vdbl fa, fb, rr, x1, x2, x3, x4, ft, dft, r1, hloss, hgrad;
+    vint neg, lam, turb;
+
+    memcpy(&flow, fq, sizeof(vdbl));
+    memcpy(&r, pr, sizeof(vdbl));
+    memcpy(&ml, pkm, sizeof(vdbl));
+    memcpy(&e, pe, sizeof(vdbl));
+    memcpy(&s, ps, sizeof(vdbl));
+    neg = (vint)(flow < 0.0);
+    q = SELECT(neg, -flow, flow);
+    w = q / s;
+
+    // Swamee & Jain friction factor for Re >= 4000
+    y1 = w;
+    vlog(&y1);
+    y1 *= -0.9;
+    vexp(&y1);
+    y1 *= A8;
+    y2 = e / 3.7 + y1;
+    y3 = y2;
+    vlog(&y3);
+    y3 *= A9;
+    f = 1.0 / (y3 * y3);
+    dfdq = 1.8 * f * y1 * A9 / y2 / y3 / q;
+
+    // Dunlop's interpolating polynomials for 2000 < Re < 4000
+    y2 = e / 3.7 + AB;
+    y3 = y2;
+    vlog(&y3);
+    y3 *= A9;
+    fa = 1.0 / (y3 * y3);
+    fb = (2.0 + AC / (y2 * y3)) * fa;
+    rr = w / A2;
+    x1 = 7.0 * fa - fb;
+    x2 = 0.128 - 17.0 * fa + 2.5 * fb;
+    x3 = -0.128 + 13.0 * fa - (fb + fb);
+    x4 = 0.032 - 3.0 * fa + 0.5 * fb;
+    ft = x1 + rr * (x2 + rr * (x3 + rr * x4));
+    dft = (x2 + rr * (2.0 * x3 + rr * 3.0 * x4)) / s / A2;
+    turb = (vint)(w >= A1);
+    f = SELECT(turb, f, ft);
+    dfdq = SELECT(turb, dfdq, dft);
+
+    // Head loss and its gradient
+    r1 = f * r + ml;
+    hloss = r1 * q * flow;
+    hgrad = (2.0 * r1 * q) + (dfdq * r * q * q);
+
+    // Hagen-Poiseuille formula for laminar flow (Re <= 2000)
+    rl = 16.0 * PI * s * r;
+    lam = (vint)(q <= A2 * s);
+    hloss = SELECT(lam, flow * (rl + ml * q), hloss);
+    hgrad = SELECT(lam, rl + 2.0 * ml * q, hgrad);
+
+    flow = 1.0 / hgrad;
+    memcpy(p, &flow, sizeof(vdbl));
+    flow = hloss / hgrad;
+    memcpy(y, &flow, sizeof(vdbl));
+}
+
+
+INLINE void hwcoeffs(int n, double hexp, double rq, double *flow,
+                     double *r, double *km, double *qa, double *p, double *y)
+/*
+** Computes the H-W or C-M coeffs. of n pipes, padding the last
+** block of pipes with harmless values
+*/
+{
+    int i, m;
+    double t[7][VW];
+
+    for (i = 0; i + VW <= n; i += VW)
+    {
+        hwblock(hexp, rq, flow+i, r+i, km+i, qa+i, p+i, y+i);
+    }
+    m = n - i;
+    if (m == 0) return;
+    for (m = 0; m < VW; m++)
+    {
+        t[0][m] = (i+m < n) ? flow[i+m] : 1.0;
+        t[1][m] = (i+m < n) ? r[i+m] : 1.0;
+        t[2][m] = (i+m < n) ? km[i+m] : 0.0;
+        t[3][m] = (i+m < n) ? qa[i+m] : 0.0;
+    }
+    hwblock(hexp, rq, t[0], t[1], t[2], t[3], t[4], t[5]);
+    for (m = 0; i+m < n; m++)
+    {
+        p[i+m] = t[4][m];
+        y[i+m] = t[5][m];
+    }
+}
+
+
+INLINE void dwcoeffs(int n, double *flow, double *r, double *km,
+                     double *e, double *s, double *p, double *y)
+/*
+** Computes the D-W coeffs. of n pipes, padding the last block of
+** pipes with harmless values
+*/
+{
+    int i, m;
+    double t[7][VW];
+
+    for (i = 0; i + VW <= n; i += VW)
+    {
+        dwblock(flow+i, r+i, km+i, e+i, s+i, p+i, y+i);
+    }
+    m = n - i;
+    if (m == 0) return;
+    for (m = 0; m < VW; m++)
+    {
+        t[0][m] = (i+m < n) ? flow[i+m] : 1.0;
+        t[1][m] = (i+m < n) ? r[i+m] : 1.0;
+        t[2][m] = (i+m < n) ? km[i+m] : 0.0;
+        t[3][m] = (i+m < n) ? e[i+m] : 0.0;
+        t[4][m] = (i+m < n) ? s[i+m] : 1.0;
+    }
+    dwblock(t[0], t[1], t[2], t[3], t[4], t[5], t[6]);
+    for (m = 0; i+m < n; m++)
+    {
+        p[i+m] = t[5][m];
+        y[i+m] = t[6][m];
+    }
+}
+
+
+TARGET256 static void hwcoeffs256(int n, double hexp, double rq,
+    double *flow, double *r, double *km, double *qa, double *p, double *y)
+{
+    hwcoeffs(n, hexp, rq, flow, r, km, qa, p, y);
+}
+
+TARGET512 static void hwcoeffs512(int n, double hexp, double rq,
+    double *flow, double *r, double *km, double *qa, double *p, double *y)
+{
+    hwcoeffs(n, hexp, rq, flow, r, km, qa, p, y);
+}
+
+TARGET256 static void dwcoeffs256(int n, double *flow, double *r,
+    double *km, double *e, double *s, double *p, double *y)
+{
+    dwcoeffs(n, flow, r, km, e, s, p, y);
+}
+
+TARGET512 static void dwcoeffs512(int n, double *flow, double *r,
+    double *km, double *e, double *s, double *p, double *y)
+{
+    dwcoeffs(n, flow, r, km, e, s, p, y);
+}
+
+#endif
+
+
+int  simdwidth(void)
+/*
+**--------------------------------------------------------------
+**   Input:   none
+**   Output:  returns number of doubles held by the widest SIMD
+**            registers that the kernels can use on this CPU
+**            (8 = AVX-512, 4 = AVX2, 1 = none)
+**   Purpose: selects the pipe head loss kernels at run time
+**--------------------------------------------------------------
+*/
+{
+#ifdef SIMDKERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return 8;
+    if (__builtin_cpu_supports("avx2")) return 4;
+#endif
+    return 1;
+}
+
+
+void  simdpipecoeffs(int width, int n, double hexp, double rq,
+                     double *flow, double *r, double *km, double *qa,
+                     double *p, double *y)
+/*
+**--------------------------------------------------------------
+**   Input:   width = SIMD width found by simdwidth()
+**            n     = number of pipes
+**            hexp  = head loss exponent
+**            rq    = head loss gradient at low flow
+**            flow, r, km, qa = flow, resistance, minor loss coeff.
+**                    and low flow limit of each pipe
+**   Output:  p, y = P and Y coeffs. of each pipe
+**   Purpose: computes the coeffs. of open pipes for the
+**            Hazen-Williams or Chezy-Manning formula
+**--------------------------------------------------------------
+*/
+{
+#ifdef SIMDKERNELS
+    if (width >= 8) hwcoeffs512(n, hexp, rq, flow, r, km, qa, p, y);
+    else hwcoeffs256(n, hexp, rq, flow, r, km, qa, p, y);
+#endif
+}
+
+
+void  simdDWcoeffs(int width, int n, double *flow, double *r, double *km,
+                   double *e, double *s, double *p, double *y)
+/*
+**--------------------------------------------------------------
+**   Input:   width = SIMD width found by simdwidth()
+**            n     = number of pipes
+**            flow, r, km = flow, resistance and minor loss coeff.
+**                    of each pipe
+**            e, s  = relative roughness and viscosity * diameter
+**                    of each pipe
+**   Output:  p, y = P and Y coeffs. of each pipe
+**   Purpose: computes the coeffs. of open pipes for the
+**            Darcy-Weisbach formula
+**--------------------------------------------------------------
+*/
+{
+#ifdef SIMDKERNELS
+    if (width >= 8) dwcoeffs512(n, flow, r, km, e, s, p, y);
+    else dwcoeffs256(n, flow, r, km, e, s, p, y);
+#endif
+}
+
+/************************ END OF HYDSIMD.C ************************/
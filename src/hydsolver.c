@@ -23,6 +23,9 @@ The solver implements Todini's Global Gradient Algorithm.
 #include "funcs.h"
 #include "text.h"
 
+#define   CHORDRATE  0.5   // Least error reduction made by a chord step
+#define   MINSTEP    0.1   // Smallest fraction of a full flow step taken
+
 // Hydraulic balance error for network being analyzed
 typedef struct {
     double maxheaderror;
@@ -36,10 +39,14 @@ typedef struct {
 // External functions
 //int   hydsolve(EN_Project *pr, int *iter, double *relerr);
 //void  headlosscoeffs(EN_Project *pr);
+//void  loadlinkarrays(EN_Project *pr);
 //void  matrixcoeffs(EN_Project *pr);
+//void  trialcoeffs(EN_Project *pr);
 
 extern int  valvestatus(EN_Project *pr);    //(see HYDSTATUS.C)
 extern int  linkstatus(EN_Project *pr);     //(see HYDSTATUS.C)
+extern int  holdstatus(EN_Project *pr, int k, StatType s);  //(see HYDSTATUS.C)
+extern int  releasestatus(EN_Project *pr);  //(see HYDSTATUS.C)
 
 // Local functions
 static int      badvalve(EN_Project *pr, int);
@@ -53,6 +60,9 @@ static void     newemitterflows(EN_Project *pr, Hydbalance *hbal, double *qsum,
 static void     newdemandflows(EN_Project *pr, Hydbalance *hbal, double *qsum,
                 double *dqsum);
 
+static void     adjuststep(EN_Project *pr, double newerr, double olderr,
+                double preverr);
+static void     freezeblocks(EN_Project *pr, int change);
 static void     checkhydbalance(EN_Project *pr, Hydbalance *hbal);
 static int      hasconverged(EN_Project *pr, double *relerr, Hydbalance *hbal);
 static void     reporthydbal(EN_Project *pr, Hydbalance *hbal);
@@ -82,16 +92,40 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
 **           not achieved in MaxIter trials and ExtraIter > 0 then
 **           another ExtraIter trials are made with no status changes
 **           made to any links and a warning message is generated.
+**           If chord steps are allowed (ChordTol > 0) the matrix is
+**           factorized again whenever a chord step fails to reduce
+**           the convergence error by at least CHORDRATE or a link
+**           changes status, and a solution reached by a chord step
+**           is only accepted after a further trial with a fresh
+**           factorization.
+**           If BlockSolve is set the convergence error is that of
+**           the worst independent block of junctions, and each
+**           block whose own error meets the accuracy is held at
+**           its solution while the others keep iterating (see
+**           freezeblocks()).
+**           If the NULLSPACE engine is chosen the same linearized
+**           equations are solved for the flows around the network's
+**           loops instead of by factorizing the nodal matrix.
+**           If StepControl is set only part of the flow changes is
+**           applied while the convergence error fails to fall (see
+**           adjuststep()), and the error is that of the full change.
+**           If FlipLimit > 0 a link that reverses its status that
+**           many times is held at its status until the rest of the
+**           network converges, when it is released for the final
+**           status check (see holdstatus() in HYDSTATUS.C).
 **
-**   This procedure calls linsolve() which appears in SMATRIX.C.
+**   This procedure calls linsolve() which appears in SMATRIX.C
+**   or loopsolve() which appears in HYDLOOPS.C.
 **-------------------------------------------------------------------
 */
 {
-    int    i;                     // Node index
+    int    i;                     // Node or link index
     int    errcode = 0;           // Node causing solution error
     int    nextcheck;             // Next status check trial
     int    maxtrials;             // Max. trials for convergence
     double newerr;                // New convergence error
+    double olderr = 1.0e10;       // Previous convergence error
+    double preverr = 1.0e10;      // Convergence error before that
     int    valveChange;           // Valve status change flag
     int    statChange;            // Non-valve status change flag
     Hydbalance hydbal;            // Hydraulic balance errors
@@ -102,8 +136,28 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
     report_options_t *rep = &pr->report;
 
     // Initialize status checking & relaxation factor
+    // and copy the link data used on each trial
+    loadlinkarrays(pr);
     nextcheck = hyd->CheckFreq;
     hyd->RelaxFactor = 1.0;
+    hyd->StepSize = 1.0;
+    hyd->StepCuts = 0;
+    hyd->HeldLinks = 0;
+    if (hyd->FlipLimit > 0)
+    {
+        for (i = 1; i <= net->Nlinks; i++)
+        {
+            hyd->Flips[i] = 0;
+            hyd->PrevStat[i] = hyd->LinkStatus[i];
+            hyd->Held[i] = FALSE;
+        }
+    }
+    sol->Cgiter = 0;
+    sol->Nfactor = 0;
+    sol->Nupdate = 0;
+    sol->Nrefine = 0;
+    sol->Mpfail = FALSE;
+    sol->Chordstep = FALSE;
 
     // Repeat iterations until convergence or trial limit is exceeded.
     // (ExtraIter used to increase trials in case of status cycling.)
@@ -125,9 +179,10 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
         ** head loss gradients, & F = flow correction terms.
         ** Solution for H is returned in F from call to linsolve().
         */
-        headlosscoeffs(pr);
-        matrixcoeffs(pr);
-        errcode = linsolve(pr, net->Njuncs);
+        hyd->Iterations = *iter;      // Trials so far (see holdstatus())
+        trialcoeffs(pr);
+        if (hyd->Engine == NULLSPACE) errcode = loopsolve(pr);
+        else errcode = linsolve(pr, net->Njuncs);
 
         // Quit if memory allocation error
         if (errcode < 0) break;
@@ -147,8 +202,17 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
             hyd->NodeHead[i] = sol->F[sol->Row[i]];   // Update heads
         }
         newerr = newflows(pr, &hydbal);               // Update flows
+        if (hyd->StepControl) newerr /= hyd->StepSize;  // Full step error
         *relerr = newerr;
 
+        // Factorize the matrix on the next trial if chord steps stall
+        if (sol->Chordstep && newerr > CHORDRATE * olderr) sol->Refactor = TRUE;
+
+        // Cut back the next flow step while the error fails to fall
+        if (hyd->StepControl) adjuststep(pr, newerr, olderr, preverr);
+        preverr = olderr;
+        olderr = newerr;
+
         // Write convergence error to status report if called for
         if (rep->Statflag == FULL)
         {
@@ -156,13 +220,14 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
         }
 
         // Apply solution damping & check for change in valve status
-        hyd->RelaxFactor = 1.0;
+        hyd->RelaxFactor = hyd->StepSize;
         valveChange = FALSE;
+        statChange = FALSE;
         if (hyd->DampLimit > 0.0)
         {
             if (*relerr <= hyd->DampLimit)
             {
-                hyd->RelaxFactor = 0.6;
+                hyd->RelaxFactor = 0.6 * hyd->StepSize;
                 valveChange = valvestatus(pr);
             }
         }
@@ -177,8 +242,20 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
             // We have convergence - quit if we are into extra iterations
             if (*iter > hyd->MaxIter) break;
 
+            // Take another trial with a fresh factorization if this
+            // one was a chord step, so that the solution accepted is
+            // that of a full Newton step
+            if (sol->Chordstep)
+            {
+                sol->Refactor = TRUE;
+                (*iter)++;
+                continue;
+            }
+
             // Quit if no status changes occur
+            // (links held at their status are checked again too)
             statChange = FALSE;
+            if (releasestatus(pr) && valvestatus(pr)) valveChange = TRUE;
             if (valveChange)    statChange = TRUE;
             if (linkstatus(pr)) statChange = TRUE;
             if (pswitch(pr))    statChange = TRUE;
@@ -192,12 +269,25 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
         // check  on pumps, CV's, and pipes connected to tank
         else if (*iter <= hyd->MaxCheck && *iter == nextcheck)
         {
-            linkstatus(pr);
+            statChange = linkstatus(pr);
             nextcheck += hyd->CheckFreq;
         }
+
+        // Factorize the matrix afresh once a link changes status
+        if (valveChange || statChange) sol->Refactor = TRUE;
+
+        // Hold the blocks that have converged at their solution
+        if (hyd->BlockSolve) freezeblocks(pr, valveChange || statChange);
         (*iter)++;
     }
 
+    // Release any blocks held at their solution
+    if (sol->Nfrozen > 0)
+    {
+        memset(sol->Frozen, 0, (sol->Nblocks + 1) * sizeof(char));
+        sol->Nfrozen = 0;
+    }
+
     // Iterations ended - report any errors.
     if (errcode < 0) errcode = 101;              // Memory allocation error
     else if (errcode > 0)
@@ -222,6 +312,76 @@ int  hydsolve(EN_Project *pr, int *iter, double *relerr)
 }
 
 
+int  demandheads(EN_Project *pr, int count, double *D, double *H)
+/*
+**-------------------------------------------------------------------
+**  Input:   count = number of demand scenarios
+**           D     = junction demands (cfs) of each scenario, with
+**                   D[s*Nnodes + i-1] the demand at node i in
+**                   scenario s (entries for tanks are ignored)
+**  Output:  H     = node heads (ft) of each scenario, stored as D
+**           returns error code
+**  Purpose: finds the heads produced by several sets of junction
+**           demands with a single linearization of the network
+**           equations about the current hydraulic solution
+**
+**  Notes:   The matrix of the linearized equations depends only
+**           on the current flows, so each scenario only changes
+**           the r.h.s. F, by the difference between its demands
+**           and those now met (DemandFlows). The heads found are
+**           those that the next trial of hydsolve() would give for
+**           each set of demands, i.e. they are exact to first order
+**           in the demand changes. All scenarios share one matrix
+**           factorization (see linsolvemulti() in SMATRIX.C).
+**-------------------------------------------------------------------
+*/
+{
+    int    i, s, row;
+    int    errcode = 0;
+    int    n = pr->network.Njuncs;
+    int    nnodes = pr->network.Nnodes;
+    double *B;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+
+    B = (double *) calloc((size_t)(n+1)*count, sizeof(double));
+    if (B == NULL) return 101;
+
+    // Form the r.h.s. of each scenario about the current solution
+    loadlinkarrays(pr);
+    trialcoeffs(pr);
+    for (i = 1; i <= n; i++)
+    {
+        row = sol->Row[i];
+        for (s = 0; s < count; s++)
+        {
+            B[row*count+s] = sol->F[row] -
+                             (D[s*nnodes+i-1] - hyd->DemandFlows[i]);
+        }
+    }
+
+    // Solve for all scenarios at once
+    errcode = linsolvemulti(pr, n, count, B);
+    if (errcode < 0) errcode = 101;
+    else if (errcode > 0)
+    {
+        writehyderr(pr, sol->Order[errcode]);
+        errcode = 110;
+    }
+    else for (s = 0; s < count; s++)
+    {
+        for (i = 1; i <= nnodes; i++)
+        {
+            if (i <= n) H[s*nnodes+i-1] = B[sol->Row[i]*count+s];
+            else        H[s*nnodes+i-1] = hyd->NodeHead[i];
+        }
+    }
+    free(B);
+    return errcode;
+}
+
+
 int  badvalve(EN_Project *pr, int n)
 /*
 **-----------------------------------------------------------------
@@ -354,6 +514,7 @@ int  pswitch(EN_Project *pr)
             if (change)
             {
                 hyd->LinkStatus[k] = net->Control[i].Status;
+                if (hyd->LinkStatus[k] != (StatType)s && holdstatus(pr, k, (StatType)s)) continue;
                 if (link->Type > PIPE)
                 {
                     hyd->LinkSetting[k] = net->Control[i].Setting;
@@ -380,11 +541,14 @@ double newflows(EN_Project *pr, Hydbalance *hbal)
 **----------------------------------------------------------------
 */
 {
+    int     b;
     double  dqsum,                 // Network flow change
-            qsum;                  // Network total flow
+            qsum,                  // Network total flow
+            err, maxerr;
 
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
 
     // Initialize sum of flows & corrections
     qsum = 0.0;
@@ -392,13 +556,33 @@ double newflows(EN_Project *pr, Hydbalance *hbal)
     hbal->maxflowchange = 0.0;
     hbal->maxflowlink = 1;
     hbal->maxflownode = -1;
+    if (hyd->BlockSolve)
+    {
+        memset(sol->Bqsum, 0, (sol->Nblocks + 1) * sizeof(double));
+        memset(sol->Bdqsum, 0, (sol->Nblocks + 1) * sizeof(double));
+    }
 
     // Update flows in all real and virtual links
     newlinkflows(pr, hbal, &qsum, &dqsum);
     newemitterflows(pr, hbal, &qsum, &dqsum);
     newdemandflows(pr, hbal, &qsum, &dqsum);
 
-    // Return ratio of total flow corrections to total flow
+    // Return largest ratio of flow corrections to flow of any
+    // block still being iterated ...
+    if (hyd->BlockSolve)
+    {
+        maxerr = 0.0;
+        for (b = 0; b <= sol->Nblocks; b++)
+        {
+            if (sol->Frozen[b]) continue;
+            err = sol->Bdqsum[b];
+            if (sol->Bqsum[b] > hyd->Hacc) err /= sol->Bqsum[b];
+            if (err > maxerr) maxerr = err;
+        }
+        return maxerr;
+    }
+
+    // ... or ratio of total flow corrections to total flow
     if (qsum > hyd->Hacc) return (dqsum / qsum);
     else return dqsum;
 }
@@ -417,7 +601,7 @@ void  newlinkflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsum
 {
     double  dh,                    /* Link head loss       */
             dq;                    /* Link flow change     */
-    int     k, n, n1, n2;
+    int     b, k, n, n1, n2;
 
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
@@ -438,6 +622,18 @@ void  newlinkflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsum
         n1 = link->N1;
         n2 = link->N2;
 
+        // Links of a block held at its solution keep their flows
+        b = sol->LinkBlock[k];
+        if (sol->Nfrozen > 0 && sol->Frozen[b])
+        {
+            if (hyd->LinkStatus[k] > CLOSED)
+            {
+                if (n1 > net->Njuncs) hyd->NodeDemand[n1] -= hyd->LinkFlows[k];
+                if (n2 > net->Njuncs) hyd->NodeDemand[n2] += hyd->LinkFlows[k];
+            }
+            continue;
+        }
+
         // Apply flow update formula:
         //   dq = Y - P * (new head loss)
         //    P = 1 / (previous head loss gradient)
@@ -464,6 +660,11 @@ void  newlinkflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsum
         hyd->LinkFlows[k] -= dq;
         *qsum += ABS(hyd->LinkFlows[k]);
         *dqsum += ABS(dq);
+        if (hyd->BlockSolve)
+        {
+            sol->Bqsum[b] += ABS(hyd->LinkFlows[k]);
+            sol->Bdqsum[b] += ABS(dq);
+        }
 
         // Update identity of element with max. flow change
         if (ABS(dq) > hbal->maxflowchange)
@@ -495,16 +696,18 @@ void newemitterflows(EN_Project *pr, Hydbalance *hbal, double *qsum,
 **----------------------------------------------------------------
 */
 {
-    int     i;
+    int     i, j;
     double  hloss, hgrad, dh, dq;
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+    kernels_t    *kn = &hyd->kernels;
 
-    // Examine each network junction
-    for (i = 1; i <= net->Njuncs; i++)
+    // Examine each junction with an emitter (see setkernels())
+    for (j = 1; j <= kn->Nemitters; j++)
     {
-        // Skip junction if it does not have an emitter
-        if (net->Node[i].Ke == 0.0) continue;
+        i = kn->Emitter[j];
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->NodeBlock[i]]) continue;
 
         // Find emitter head loss and gradient 
         emitheadloss(pr, i, &hloss, &hgrad);
@@ -517,6 +720,11 @@ void newemitterflows(EN_Project *pr, Hydbalance *hbal, double *qsum,
         // Update system flow summation
         *qsum += ABS(hyd->EmitterFlows[i]);
         *dqsum += ABS(dq);
+        if (hyd->BlockSolve)
+        {
+            sol->Bqsum[sol->NodeBlock[i]] += ABS(hyd->EmitterFlows[i]);
+            sol->Bdqsum[sol->NodeBlock[i]] += ABS(dq);
+        }
 
         // Update identity of element with max. flow change
         if (ABS(dq) > hbal->maxflowchange)
@@ -547,6 +755,7 @@ void newdemandflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsu
     int     k;
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
 
     // Get demand function parameters
     if (hyd->DemandModel == DDA) return;
@@ -557,6 +766,7 @@ void newdemandflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsu
     {
         // Skip junctions with no positive demand
         if (hyd->NodeDemand[k] <= 0.0) continue;
+        if (sol->Nfrozen > 0 && sol->Frozen[sol->NodeBlock[k]]) continue;
 
         // Find change in demand flow (see hydcoeffs.c)
         dq = demandflowchange(pr, k, dp, n);
@@ -565,6 +775,11 @@ void newdemandflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsu
         // Update system flow summation
         *qsum += ABS(hyd->DemandFlows[k]);
         *dqsum += ABS(dq);
+        if (hyd->BlockSolve)
+        {
+            sol->Bqsum[sol->NodeBlock[k]] += ABS(hyd->DemandFlows[k]);
+            sol->Bdqsum[sol->NodeBlock[k]] += ABS(dq);
+        }
 
         // Update identity of element with max. flow change
         if (ABS(dq) > hbal->maxflowchange)
@@ -577,6 +792,83 @@ void newdemandflows(EN_Project *pr, Hydbalance *hbal, double *qsum, double *dqsu
 }
 
 
+void  adjuststep(EN_Project *pr, double newerr, double olderr,
+                 double preverr)
+/*
+**----------------------------------------------------------------
+**  Input:   newerr  = convergence error of current trial
+**           olderr  = convergence error of previous trial
+**           preverr = convergence error of trial before that
+**  Output:  none
+**  Purpose: sets the fraction of the full flow change that the
+**           next trial of hydsolve() applies.
+**
+**  Note: The convergence error is that of the full flow change.
+**        When it is no smaller than both of the two before it
+**        the flows are swinging back and forth (as when the status
+**        of some links keeps switching) so the step is halved,
+**        down to MINSTEP of a full one. A single rise, as when a
+**        link changes status, is not enough. Full steps are taken
+**        again once the error falls from one trial to the next.
+**----------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+
+    if (newerr >= MAX(olderr, preverr))
+    {
+        if (hyd->StepSize > MINSTEP) hyd->StepCuts++;
+        hyd->StepSize = MAX(0.5 * hyd->StepSize, MINSTEP);
+    }
+    else if (newerr < olderr) hyd->StepSize = 1.0;
+}
+
+
+void  freezeblocks(EN_Project *pr, int change)
+/*
+**--------------------------------------------------------------
+**   Input:   change = TRUE if a link's status changed in the trial
+**   Output:  none
+**   Purpose: holds each independent block of junctions whose
+**            flow changes meet the solution accuracy at its
+**            current heads and flows
+**
+**   Note: The equations of different blocks share no unknowns,
+**         so the blocks still being iterated are unaffected.
+**         A status change may alter any block, so all blocks are
+**         then released, as they are when a head error or flow
+**         change limit is set (as these are checked over all
+**         links). Links joining two fixed grade nodes (block 0)
+**         are always iterated.
+**--------------------------------------------------------------
+*/
+{
+    int    b;
+    double err;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *sol = &hyd->solver;
+
+    if (change || hyd->HeadErrorLimit > 0.0 || hyd->FlowChangeLimit > 0.0)
+    {
+        memset(sol->Frozen, 0, (sol->Nblocks + 1) * sizeof(char));
+        sol->Nfrozen = 0;
+        return;
+    }
+    for (b = 1; b <= sol->Nblocks; b++)
+    {
+        if (sol->Frozen[b]) continue;
+        err = sol->Bdqsum[b];
+        if (sol->Bqsum[b] > hyd->Hacc) err /= sol->Bqsum[b];
+        if (err <= hyd->Hacc)
+        {
+            sol->Frozen[b] = TRUE;
+            sol->Nfrozen++;
+        }
+    }
+}
+
+
 void  checkhydbalance(EN_Project *pr, Hydbalance *hbal)
 /*
 **--------------------------------------------------------------
@@ -9,10 +9,17 @@ HYDSTATUS.C --  Hydraulic status updating for the EPANET Program
 #include <stdio.h>
 #include "types.h"
 #include "funcs.h"
+#include "text.h"
+
+#define FLIPSTART 5  // Trials made before status reversals are counted
+
+extern char *LinkTxt[];
 
 // External functions
 int  valvestatus(EN_Project *pr);
 int  linkstatus(EN_Project *pr);
+int  holdstatus(EN_Project *pr, int k, StatType s);
+int  releasestatus(EN_Project *pr);
 
 // Local functions
 static StatType cvstatus(EN_Project *pr, StatType, double, double);
@@ -44,12 +51,13 @@ int  valvestatus(EN_Project *pr)
     EN_Network       *net = &pr->network;
     hydraulics_t     *hyd = &pr->hydraulics;
     report_options_t *rep = &pr->report;
+    linkarrays_t     *la  = &hyd->links;
 
-    // Examine each valve
-    for (i = 1; i <= net->Nvalves; i++)
+    // Examine each PRV & PSV
+    for (i = 1; i <= la->Npvalves; i++)
     {
         // Get valve's link and its index
-        k = net->Valve[i].Link;
+        k = la->Pvalves[i];
         link = &net->Link[k];
 
         // Ignore valve if its status is fixed to OPEN/CLOSED
@@ -78,7 +86,7 @@ int  valvestatus(EN_Project *pr)
         }
 
         // Check for a status change
-        if (status != hyd->LinkStatus[k])
+        if (status != hyd->LinkStatus[k] && !holdstatus(pr, k, status))
         {
             if (rep->Statflag == FULL)
             {
@@ -102,6 +110,7 @@ int  linkstatus(EN_Project *pr)
 */
 {
     int change = FALSE,             // Status change flag
+        i,                          // Index in list of links checked
         k,                          // Link index
         n1,                         // Start node index
         n2;                         // End node index
@@ -111,11 +120,13 @@ int  linkstatus(EN_Project *pr)
     EN_Network       *net = &pr->network;
     hydraulics_t     *hyd = &pr->hydraulics;
     report_options_t *rep = &pr->report;
+    linkarrays_t     *la  = &hyd->links;
     Slink *link;
 
-    // Examine each link
-    for (k = 1; k <= net->Nlinks; k++)
+    // Examine each link whose status can change
+    for (i = 1; i <= la->Nchecked; i++)
     {
+        k = la->Checked[i];
         link = &net->Link[k];
         n1 = link->N1;
         n2 = link->N2;
@@ -154,7 +165,7 @@ int  linkstatus(EN_Project *pr)
         }
 
         // Note any change in link status; do not revise link flow
-        if (status != hyd->LinkStatus[k])
+        if (status != hyd->LinkStatus[k] && !holdstatus(pr, k, status))
         {
             change = TRUE;
             if (rep->Statflag == FULL)
@@ -167,6 +178,94 @@ int  linkstatus(EN_Project *pr)
 }
 
 
+int  holdstatus(EN_Project *pr, int k, StatType s)
+/*
+**--------------------------------------------------------------
+**  Input:   k = link index
+**           s = status that link k has just changed from
+**  Output:  returns 1 if the link is held at status s, 0 if not
+**  Purpose: counts the status reversals of a link during a
+**           hydraulic solution and holds the link at its status
+**           each time it has made another FlipLimit of them.
+**
+**  Note: A reversal is a change back to the status the link
+**        last changed from, as when a CV or PRV keeps opening
+**        and closing on alternate trials. Only the links that
+**        do this are held, so the rest of the network is still
+**        free to converge. They are released once it has (see
+**        releasestatus()) so that the status of every link is
+**        checked against a converged solution. Changes made in
+**        the first FLIPSTART trials, while flows are still far
+**        from their solution, are not counted.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t     *hyd = &pr->hydraulics;
+    report_options_t *rep = &pr->report;
+    Slink *link = &pr->network.Link[k];
+
+    if (hyd->FlipLimit <= 0) return FALSE;
+
+    // Only note the status changed from during the first trials
+    if (hyd->Iterations <= FLIPSTART)
+    {
+        hyd->PrevStat[k] = s;
+        return FALSE;
+    }
+
+    // Keep a held link at its status
+    if (hyd->Held[k])
+    {
+        hyd->LinkStatus[k] = s;
+        return TRUE;
+    }
+
+    // Count a change back to the status the link last changed from
+    if (hyd->LinkStatus[k] == hyd->PrevStat[k])
+    {
+        hyd->Flips[k]++;
+        if (hyd->Flips[k] % hyd->FlipLimit == 0)
+        {
+            hyd->Held[k] = TRUE;
+            hyd->HeldLinks++;
+            if (rep->Statflag == FULL)
+            {
+                sprintf(pr->Msg, FMT57a, LinkTxt[link->Type], link->ID,
+                        hyd->Flips[k]);
+                writeline(pr, pr->Msg);
+            }
+        }
+    }
+    hyd->PrevStat[k] = s;
+    return FALSE;
+}
+
+
+int  releasestatus(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+**  Input:   none
+**  Output:  returns 1 if any link was released, 0 otherwise
+**  Purpose: frees the links held at their status by holdstatus()
+**           to change status again.
+**--------------------------------------------------------------
+*/
+{
+    int k, released = FALSE;
+    hydraulics_t *hyd = &pr->hydraulics;
+
+    if (hyd->FlipLimit <= 0) return FALSE;
+    for (k = 1; k <= pr->network.Nlinks; k++)
+    {
+        if (!hyd->Held[k]) continue;
+        hyd->Held[k] = FALSE;
+        hyd->PrevStat[k] = hyd->LinkStatus[k];
+        released = TRUE;
+    }
+    return released;
+}
+
+
 StatType  cvstatus(EN_Project *pr, StatType s, double dh, double q)
 /*
 **--------------------------------------------------
@@ -127,6 +127,23 @@ void setdefaults(EN_Project *pr)
   hyd->FlowChangeLimit = 0.0; // Default flow change limit
   hyd->HeadErrorLimit = 0.0;  // Default head error limit
   hyd->DemandModel = DDA;     // Demand driven analysis
+  hyd->LinSolver = CHOLESKY;  // Column Cholesky linear solver
+  hyd->Threads = 1;           // Serial matrix factorization
+  hyd->Ordering = MMD;        // Multiple minimum degree re-ordering
+  hyd->ChordTol = 0.0;        // Factorize matrix on every iteration
+  hyd->MixedPrec = FALSE;     // Double precision matrix factor
+  hyd->Skeletonize = FALSE;   // Series junctions kept in matrix
+  hyd->BlockSolve = FALSE;    // All blocks iterated to convergence
+  hyd->Subdomains = 4;        // Subdomains of the Schur solver
+  hyd->Engine = GGA;          // Gradient algorithm on nodal heads
+  hyd->Simd = TRUE;           // Vectorized pipe coeffs. if CPU allows
+  hyd->Predictor = 0;         // Periods start from previous flows
+  hyd->StepControl = FALSE;   // Full flow steps taken on every trial
+  hyd->FlipLimit = 0;         // Links may change status without limit
+  hyd->PcgLimit = 0;          // PCG iterations limited to 2n per trial
+  hyd->StatusLists = TRUE;    // Status checked only where it can change
+  hyd->CacheSize = 0;         // No solutions kept for reuse
+  hyd->CacheTol = 0.01;       // Tank head change (ft) in a reused solution
   hyd->Pmin = 0.0;            // Minimum demand pressure (ft)
   hyd->Preq = 0.0;            // Required demand pressure (ft)
   hyd->Pexp = 0.5;            // Pressure function exponent
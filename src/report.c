@@ -55,6 +55,7 @@ extern char *StatTxt[];
 extern char *TstatTxt[];
 extern char *RptFormTxt[];
 extern char *DemandModelTxt[];
+extern char *OrderingTxt[];
 
 typedef REAL4 *Pfloat;
 void writenodetable(EN_Project *pr, Pfloat *);
@@ -325,6 +326,10 @@ void writehydstat(EN_Project *pr, int iter, double relerr)
       sprintf(s1, FMT59, atime, iter, relerr);
     writeline(pr, s1);
   }
+  else if (hyd->cache.Reused) {
+    sprintf(s1, FMT58a, atime);
+    writeline(pr, s1);
+  }
 
   /*
      Display status changes for tanks.
@@ -882,6 +887,27 @@ void writerelerr(EN_Project *pr, int iter, double relerr)
   }
 } /* End of writerelerr */
 
+void writeordering(EN_Project *pr, int ordering, int ncoeffs, double flops)
+/*
+**-----------------------------------------------------------------
+**   Input:   ordering = type of matrix re-ordering
+**            ncoeffs  = number of non-zero matrix coeffs.
+**            flops    = predicted flops to factorize the matrix
+**   Output:  none
+**   Purpose: writes out the cost of a solution matrix re-ordering
+**-----------------------------------------------------------------
+*/
+{
+  if (ordering == MMD) {
+    writeline(pr, " ");
+    writeline(pr, FMT69);
+    writeline(pr, " ");
+  }
+  sprintf(pr->Msg, FMT70, OrderingTxt[ordering], ncoeffs, flops,
+          ordering == pr->hydraulics.Ordering ? " (selected)" : "");
+  writeline(pr, pr->Msg);
+} /* End of writeordering */
+
 void writestatchange(EN_Project *pr, int k, char s1, char s2)
 /*
 **--------------------------------------------------------------
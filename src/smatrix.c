@@ -14,13 +14,15 @@ module are:
    createsparse() -- called from openhyd() in HYDRAUL.C           
    freesparse()   -- called from closehyd() in HYDRAUL.C           
    linsolve()     -- called from netsolve() in HYDRAUL.C          
+   sparsesize()   -- called from EN_getstatistic() in EPANET.C
                                                                    
 createsparse() does the following:                               
    1. for each node, builds an adjacency list that identifies    
       all links connected to the node (see buildlists())         
    2. re-orders the network's nodes to minimize the number       
       of non-zero entries in the hydraulic solution matrix       
-      (see reorder())
+      (see reordernodes(); multiple minimum degree, nested
+      dissection or approximate minimum degree can be chosen)
    3. symbolically factorizes the solution matrix
       (see factorize())
    4. converts the adjacency lists into a compact scheme         
@@ -30,6 +32,71 @@ createsparse() does the following:
 freesparse() frees the memory used for the sparse matrix.        
 
 linsolve() solves the linearized system of hydraulic equations.  
+Its work vectors are allocated once by createsparse() (see
+allocworkspace()) so that no memory is allocated while solving.
+When the SUPERNODAL solver option is chosen createsparse() also
+groups columns with identical sparsity into supernodes (see
+supernodes()) and linsolve() factorizes these as dense blocks
+(see snfactor()).
+When the PCG solver option is chosen the matrix is not factorized
+symbolically, so no fill-in is stored, and linsolve() instead
+uses conjugate gradients preconditioned by an incomplete Cholesky
+factor with the same non-zeros as the matrix (see pcgsolve()).
+When more than one thread is requested for the column solver,
+createsparse() builds the matrix's elimination tree (see
+elimtree()) and linsolve() factorizes its independent subtrees
+concurrently (see etfactor()). Each column is computed with the
+same sequence of operations as the serial code, so results do
+not depend on the number of threads.
+When a chord tolerance (ChordTol) is set, linsolve() keeps the last
+factor of a direct solver and applies it to the residual of later
+matrices instead of factorizing them again (see chordstep()). A
+coeff. that has changed by more than UPDTOL*ChordTol since the
+factor was formed, such as one of a link whose status was changed,
+makes it stale. A kept column factor is brought up to date for
+these coeffs. with rank-1 updates, for as long as this costs less
+than factorizing the matrix (see updatefactor()). The supernodal
+factor cannot be updated, so it is only reused while no coeff. has
+changed by this much. Chord steps are experimental and off by
+default: on the networks tested they save fewer factorizations than
+the extra trials they take cost.
+When the mixed precision option is chosen for the column solver
+(without chord steps), linsolve() first factorizes the matrix in
+single precision and refines the solution against the double
+precision matrix (see mpsolve()), falling back to a double
+precision factor if refinement fails.
+
+The junctions on the tree branches of the network (its forest) are
+given the last rows of the solution matrix (see forestcore()) and
+only the rows of its looped core are factorized.
+linsolve() eliminates the forest's rows leaf first, which takes
+linear time and makes no fill-in (see forestfactor()), solves the
+reduced equations of the core and then finds the forest's heads by
+back substitution (see forestsubstitute()).
+When the Skeletonize option is set, junctions in series between two
+others (such as those joining chains of pipes) are removed from the
+core in the same way. The coeffs. of the links on each side of one
+combine into that of an equivalent link between its neighbours.
+Since this elimination is exact the same trials are taken, each on a
+smaller core, which pays off most for networks drawn with long chains
+of pipes (and most of all with the PCG solver).
+
+Junctions joined to each other only through tanks or reservoirs are
+hydraulically independent, since fixed grade nodes are not part of
+the solution matrix. createsparse() finds each independent block of
+junctions and gives its core rows consecutive positions (see
+findblocks()). When the BlockSolve option is set, hydsolve() holds a
+block at its solution once it has converged, making its rows those
+of the identity matrix, and linsolve() then only factorizes the
+columns of the other blocks, each on its own thread when several
+threads were requested (see blockfactor()).
+
+When the SCHUR solver option is chosen the core is split into a
+number of subdomains joined only through a set of separator rows,
+which are given the core's last rows (see schurdomains()).
+linsolve() factorizes the subdomains concurrently, each adding its
+update to the Schur complement of the separator, which is then
+factorized as a dense matrix (see schurfactor() and schursolve()).
 
 ********************************************************************
 */
@@ -43,6 +110,9 @@ linsolve() solves the linearized system of hydraulic equations.
 #endif
 #include <math.h>
 #include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <time.h>
 
@@ -50,11 +120,33 @@ linsolve() solves the linearized system of hydraulic equations.
 #include "types.h"
 #include "funcs.h"
 
+#define   PCGTOL   0.001  /* PCG residual tolerance as a fraction of Hacc */
+#define   ICSHIFT  1.e-3  /* First diagonal shift for incomplete Cholesky */
+#define   ICTRIES  10     /* Max. number of shifts tried                  */
+#define   UPDTOL   0.01   /* Coeff. change updated in a kept factor as a
+                             fraction of the chord tolerance             */
+#define   DOWNTOL  1.e-6  /* Least fraction of a diagonal coeff. of the
+                             factor squared left by a downdate           */
+#define   MPTOL    1.e-9 /* Refinement tolerance relative to the heads  */
+#define   MPITERS  10     /* Max. number of refinement steps             */
+#define   SCHURPAR 64     /* Min. Schur complement columns updated in
+                             parallel                                    */
+
 // The multiple minimum degree re-ordering routine (see genmmd.c)
 extern int genmmd(int *neqns, int *xadj, int *adjncy, int *invp, int *perm,
                   int *delta, int *dhead, int *qsize, int *llist, int *marker,
                   int *maxint, int *nofsub);
 
+// The nested dissection re-ordering routine (see gennd.c)
+extern int gennd(int neqns, int *xadj, int *adjncy, int *invp, int *perm);
+
+// The approximate minimum degree re-ordering routine (see genamd.c)
+extern int genamd(int neqns, int *xadj, int *adjncy, int *invp, int *perm);
+
+// The subdomain partitioning routine (see gennd.c)
+extern int gendomains(int neqns, int *xadj, int *adjncy, int *ndomains,
+                      int *part);
+
 
 // Local functions
 static int     allocsparse(EN_Project *pr);
@@ -63,7 +155,15 @@ static int     paralink(EN_Project *pr, int, int, int);
 static void    xparalinks(EN_Project *pr);
 static void    freelists(EN_Project *pr);
 static void    countdegree(EN_Project *pr);
+static int     forestcore(EN_Project *pr);
+static int     findblocks(EN_Project *pr);
+static int     schurdomains(EN_Project *pr);
+static int     schurinterface(EN_Project *pr);
 static int     reordernodes(EN_Project *pr);
+static int     ordernodes(int, int, int *, int *, int *, int *);
+static int     reportorderings(EN_Project *pr, int, int *, int *);
+static int     ordercost(int, int *, int *, int *, int *, int *, double *);
+static void    factorflops(EN_Project *pr, int);
 static int     factorize(EN_Project *pr);
 static int     growlist(EN_Project *pr, int);
 static int     newlink(EN_Project *pr, Padjlist);
@@ -71,6 +171,41 @@ static int     linked(EN_Network *net, int, int);
 static int     addlink(EN_Network *net, int, int, int);
 static int     storesparse(EN_Project *pr, int);
 static int     sortsparse(EN_Project *pr, int);
+static int     allocworkspace(EN_Project *pr, int);
+static int     supernodes(EN_Project *pr, int);
+static int     snfactor(EN_Project *pr);
+static void    snupdate(solver_t *, int, int, int, int);
+static void    snsolve(solver_t *, double *);
+static void    blockaxpy(double *, double *, int, int, int, int, int);
+static int     elimtree(EN_Project *pr, int);
+static int     etfactor(EN_Project *pr, int);
+static void    ettask(solver_t *, int, int, int *);
+static int     factorcolumn(solver_t *, int, double *);
+static int     pcgsolve(EN_Project *pr, int);
+static int     solvecore(EN_Project *pr, int);
+static int     forestfactor(solver_t *, int);
+static void    forestreduce(solver_t *, int, int, double *);
+static void    forestsubstitute(solver_t *, int, int, double *);
+static int     factorcolumns(solver_t *, int, int, double *);
+static int     blockfactor(solver_t *);
+static int     schurfactor(solver_t *);
+static void    schurupdate(solver_t *, int);
+static void    schursolve(solver_t *, double *);
+static void    substitute(solver_t *, int, int, double *, double *,
+               double *);
+static void    multisubstitute(solver_t *, int, int, double *, double *,
+               double *);
+static int     chordstep(EN_Project *pr, int);
+static int     updatefactor(EN_Project *pr, int);
+static int     samefactor(EN_Project *pr, int);
+static double  pathcost(solver_t *, int);
+static int     cholupdate(solver_t *, int, int, double, double *);
+static int     mpsolve(EN_Project *pr, int);
+static int     spfactor(solver_t *, int);
+static void    spsubstitute(solver_t *, int, double *);
+static int     icfactor(solver_t *, int);
+static void    icsolve(solver_t *, int, double *, double *);
+static void    matvec(solver_t *, int, double *, double *);
 static void    transpose(int, int *, int *, int *, int *,
                          int *, int *, int *);
 
@@ -101,6 +236,7 @@ int  createsparse(EN_Project *pr)
 */
 {
     int errcode = 0;
+    int n;
   
     EN_Network   *net = &pr->network;
     hydraulics_t *hyd = &pr->hydraulics;
@@ -128,13 +264,24 @@ int  createsparse(EN_Project *pr)
     }                      // (= # of adjacent links)
 
     // Re-order nodes to minimize number of non-zero coeffs. 
-    // in factorized solution matrix. 
+    // in factorized solution matrix (with tree branches last)
+    // and group the rows of each independent block together.
     hyd->Ncoeffs = net->Nlinks;
     ERRCODE(reordernodes(pr));
+    ERRCODE(findblocks(pr));
+
+    // Split the core into subdomains for the Schur complement solver
+    if (hyd->LinSolver == SCHUR) {
+        ERRCODE(schurdomains(pr));
+    }
+    n = solver->Ncore;
 
     // Factorize solution matrix by updating adjacency lists
     // with non-zero connections due to fill-ins.
-    ERRCODE(factorize(pr));
+    // (The iterative solver only needs the matrix's own non-zeros.)
+    if (hyd->LinSolver != PCG) {
+        ERRCODE(factorize(pr));
+    }
 
     // Allocate memory for sparse storage of positions of non-zero
     // coeffs. and store these positions in vector NZSUB.
@@ -145,7 +292,32 @@ int  createsparse(EN_Project *pr)
     if (!errcode) {
         freelists(pr);
     }
-    ERRCODE(sortsparse(pr, net->Njuncs));
+    ERRCODE(sortsparse(pr, n));
+    if (!errcode) factorflops(pr, n);
+
+    // Allocate the work vectors used by linsolve() now that
+    // the size of the factorized matrix is known.
+    solver->Nthreads = 1;
+    if (hyd->LinSolver == CHOLESKY || hyd->LinSolver == SCHUR)
+    {
+        solver->Nthreads = hyd->Threads;
+    }
+    ERRCODE(allocworkspace(pr, n));
+
+    // Locate the separator rows joined to each subdomain
+    if (solver->Ndomains > 0) {
+        ERRCODE(schurinterface(pr));
+    }
+
+    // Partition the factor's columns into supernodes
+    if (hyd->LinSolver == SUPERNODAL) {
+        ERRCODE(supernodes(pr, n));
+    }
+
+    // Build the elimination tree for a parallel factorization
+    if (solver->Nthreads > 1 && hyd->LinSolver == CHOLESKY) {
+        ERRCODE(elimtree(pr, n));
+    }
 
     // Re-build adjacency lists without removing parallel
     // links for use in future connectivity checking.
@@ -207,9 +379,152 @@ void  freesparse(EN_Project *pr)
     FREE(solver->XLNZ);
     FREE(solver->NZSUB);
     FREE(solver->LNZ);
+    FREE(solver->Temp);
+    FREE(solver->Link);
+    FREE(solver->First);
+    FREE(solver->Lsn);
+    FREE(solver->Work);
+    FREE(solver->Xsuper);
+    FREE(solver->Snode);
+    FREE(solver->Xblock);
+    FREE(solver->Slink);
+    FREE(solver->Sfirst);
+    FREE(solver->Map);
+    FREE(solver->Parent);
+    FREE(solver->Nchild);
+    FREE(solver->Pending);
+    FREE(solver->Bad);
+    FREE(solver->Xrow);
+    FREE(solver->RowK);
+    FREE(solver->RowPos);
+    FREE(solver->Xtask);
+    FREE(solver->Tcols);
+    FREE(solver->Lic);
+    FREE(solver->Dic);
+    FREE(solver->Cgwork);
+    FREE(solver->Adiag0);
+    FREE(solver->Lii);
+    FREE(solver->Lij);
+    FREE(solver->Aij0);
+    FREE(solver->Mpwork);
+    FREE(solver->Fii);
+    FREE(solver->Fij);
+    FREE(solver->Ftemp);
+    FREE(solver->Resid);
+    FREE(solver->Xfill);
+    FREE(solver->NodeBlock);
+    FREE(solver->LinkBlock);
+    FREE(solver->Xbrow);
+    FREE(solver->Frozen);
+    FREE(solver->Bqsum);
+    FREE(solver->Bdqsum);
+    FREE(solver->Xdom);
+    FREE(solver->Xif);
+    FREE(solver->Ifrows);
+    FREE(solver->Ifloc);
+    FREE(solver->Xupd);
+    FREE(solver->Upd);
+    FREE(solver->Ywork);
+    FREE(solver->Sdense);
+    solver->Chord = FALSE;
+    solver->Ncore = 0;
+    solver->Nblocks = 0;
+    solver->Nfrozen = 0;
+    solver->Ndomains = 0;
+    solver->Nsep = 0;
+    solver->Nsuper = 0;
+    solver->Nwork = 0;
+    solver->Nthreads = 1;
+    solver->Ntasks = 0;
 }                        /* End of freesparse */
 
 
+double  sparsesize(EN_Project *pr)
+/*
+**----------------------------------------------------------------
+** Input:   none
+** Output:  returns number of bytes used by the linear solver
+** Purpose: computes the memory held by the sparse matrix index
+**          arrays, the matrix coeffs. and linsolve's work vectors
+**----------------------------------------------------------------
+*/
+{
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    double nint, ndbl, nflt = 0.0;
+    int    n = solver->Ncore;
+    int    nd;
+
+    if (!hyd->OpenHflag) return 0.0;
+
+    // Ordering, link index and symbolic factorization arrays
+    nint = 2.0*(net->Nnodes+1) + (net->Nlinks+1) + (net->Njuncs+2) +
+           (hyd->Ncoeffs+2);
+
+    // Positions of the coeffs. joining series junctions' neighbours
+    if (solver->Xfill != NULL) nint += net->Njuncs+2;
+
+    // Coeff. arrays Aii, Aij, F, P & Y
+    ndbl = 2.0*(net->Nnodes+1) + (hyd->Ncoeffs+1) + 2.0*(net->Nlinks+1);
+
+    // Independent blocks of nodes and links, their first rows
+    // and flow sums (their fixed flags are added below)
+    nint += (net->Nnodes+1) + (net->Nlinks+1) + (solver->Nblocks+2);
+    ndbl += 2.0*(solver->Nblocks+1);
+
+    // Factorization work vectors
+    nint += 2.0*(n+1);
+    ndbl += (double)solver->Nthreads*(n+1);
+
+    // Supernodal partition, dense blocks and work arrays
+    if (solver->Nsuper > 0)
+    {
+        nint += 4.0*(solver->Nsuper+2) + 2.0*(n+1);
+        ndbl += (double)solver->Xblock[solver->Nsuper+1] + solver->Nwork;
+    }
+
+    // Elimination tree, column update lists and task lists
+    if (solver->Parent != NULL)
+    {
+        nint += 6.0*(n+2) + 2.0*(hyd->Ncoeffs+2) + (solver->Ntasks+2);
+    }
+
+    // Incomplete Cholesky factor and conjugate gradient vectors
+    if (solver->Lic != NULL)
+    {
+        ndbl += (hyd->Ncoeffs+2) + 6.0*(n+1);
+    }
+
+    // Kept factor and work vectors of chord steps
+    if (solver->Adiag0 != NULL)
+    {
+        ndbl += 3.0*(n+1) + (hyd->Ncoeffs+1);
+        if (solver->Lij != NULL) ndbl += (n+1) + (hyd->Ncoeffs+1);
+    }
+
+    // Single precision factor and refinement vectors
+    if (solver->Fij != NULL)
+    {
+        nflt = 2.0*(n+1) + (hyd->Ncoeffs+1);
+        ndbl += 2.0*(n+1);
+    }
+
+    // Subdomains, the separator rows joined to each one, their
+    // updates and sums, and the dense Schur complement
+    if (solver->Ndomains > 0)
+    {
+        nd = solver->Ndomains;
+        nint += 3.0*(nd+2) + (solver->Xif[nd+1]+1) +
+                (solver->XLNZ[solver->Xdom[nd+1]]+1);
+        ndbl += (solver->Xupd[nd+1]+1) + (solver->Xif[nd+1]+1) +
+                (double)solver->Nsep*solver->Nsep + 1;
+    }
+    return nint*sizeof(int) + ndbl*sizeof(double) + nflt*sizeof(float) +
+           (solver->Nblocks+1)*sizeof(char);
+}                        /* End of sparsesize */
+
+
 int  buildlists(EN_Project *pr, int paraflag)
 /*
 **--------------------------------------------------------------
@@ -385,6 +700,473 @@ void  countdegree(EN_Project *pr)
 }
 
 
+int  forestcore(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: separates the junctions on the network's tree
+**          branches (its forest) from those of its looped core
+**
+** NOTE:   A junction adjacent to at most one other junction is
+**         a leaf of the forest. Removing it may leave a new leaf
+**         behind (its parent), and so on until each junction
+**         left (the core) is adjacent to at least two others.
+**         When the Skeletonize option is set, junctions adjacent
+**         to exactly two others (in series between them) are also
+**         removed, joining their two neighbours instead. If these
+**         are already joined the junction's links are lumped
+**         with that connection, otherwise a new non-zero coeff.
+**         is made for it (the equivalent link of the series).
+**         The core's junctions keep the order found by
+**         reordernodes() in rows 1 to Ncore, which makes no more
+**         fill-ins than that order did. The removed junctions
+**         are given rows Ncore+1 to Njuncs in the order they were
+**         removed, so each row's neighbours are core rows or
+**         later removed rows, and are made inactive (zero Degree)
+**         so that factorize() makes no fill-ins with them.
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, k, m, nc, nt, maxdeg;
+    int    nbr[2];
+    int    errcode = 0;
+    int    *deg = NULL;      // Junctions adjacent to each junction
+    int    *queue = NULL;    // Removed junctions in order of removal
+    int    *fill = NULL;     // Coeff. joining each series junction's
+                             // neighbours
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    int    njuncs = net->Njuncs;
+    Padjlist alink;
+
+    maxdeg = hyd->Skeletonize ? 2 : 1;
+    deg   = (int *) calloc(njuncs+1, sizeof(int));
+    queue = (int *) calloc(njuncs+1, sizeof(int));
+    fill  = (int *) calloc(njuncs+1, sizeof(int));
+    ERRCODE(MEMCHECK(deg));
+    ERRCODE(MEMCHECK(queue));
+    ERRCODE(MEMCHECK(fill));
+    if (hyd->Skeletonize)
+    {
+        solver->Xfill = (int *) calloc(njuncs+2, sizeof(int));
+        ERRCODE(MEMCHECK(solver->Xfill));
+    }
+    if (!errcode)
+    {
+        // Queue the leaves (and series junctions) of the network
+        nt = 0;
+        for (i = 1; i <= njuncs; i++)
+        {
+            for (alink = net->Adjlist[i]; alink != NULL; alink = alink->next)
+            {
+                if (alink->node <= njuncs) deg[i]++;
+            }
+            if (deg[i] <= maxdeg) queue[++nt] = i;
+        }
+
+        // Remove each queued junction in turn, queueing any
+        // neighbour once it can be removed too
+        for (k = 1; k <= nt; k++)
+        {
+            i = queue[k];
+            m = 0;
+            for (alink = net->Adjlist[i]; alink != NULL; alink = alink->next)
+            {
+                j = alink->node;
+                if (j <= njuncs && deg[j] >= 0) nbr[m++] = j;
+            }
+            deg[i] = -1;
+            solver->Degree[i] = 0;
+
+            // Join the neighbours of a series junction
+            if (m == 2)
+            {
+                for (alink = net->Adjlist[nbr[0]]; alink != NULL;
+                     alink = alink->next)
+                {
+                    if (alink->node == nbr[1]) break;
+                }
+                if (alink != NULL) fill[k] = alink->link;
+                else
+                {
+                    hyd->Ncoeffs++;
+                    if (!addlink(net, nbr[0], nbr[1], hyd->Ncoeffs) ||
+                        !addlink(net, nbr[1], nbr[0], hyd->Ncoeffs))
+                    {
+                        errcode = 101;
+                        break;
+                    }
+                    solver->Degree[nbr[0]]++;
+                    solver->Degree[nbr[1]]++;
+                    fill[k] = hyd->Ncoeffs;
+                    continue;
+                }
+            }
+            for (j = 0; j < m; j++)
+            {
+                deg[nbr[j]]--;
+                if (deg[nbr[j]] == maxdeg) queue[++nt] = nbr[j];
+            }
+        }
+    }
+    if (!errcode)
+    {
+        // Number the core's junctions in their re-ordered
+        // sequence, then the removed ones
+        nc = 0;
+        for (k = 1; k <= njuncs; k++)
+        {
+            i = solver->Order[k];
+            if (deg[i] < 0) continue;
+            nc++;
+            solver->Row[i] = nc;
+            solver->Order[nc] = i;
+        }
+        for (k = 1; k <= nt; k++)
+        {
+            solver->Row[queue[k]] = nc + k;
+            solver->Order[nc + k] = queue[k];
+            if (solver->Xfill) solver->Xfill[nc + k] = fill[k];
+        }
+        solver->Ncore = nc;
+    }
+    FREE(deg);
+    FREE(queue);
+    FREE(fill);
+    return errcode;
+}                        /* End of forestcore */
+
+
+int  findblocks(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: finds the hydraulically independent blocks of the
+**          network's junctions and gives the core rows of each
+**          block consecutive positions
+**
+** NOTE:   A block holds the junctions connected to each other
+**         by links between junctions. The blocks are numbered
+**         in the order of their first rows, and a link belongs
+**         to the block of its junctions (or to none, block 0,
+**         if it joins two fixed grade nodes). As no coeff. joins
+**         the rows of two blocks, moving each block's core rows
+**         together in their relative order makes the same
+**         fill-ins. The forest's rows keep their positions.
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, k, b, m, nb;
+    int    errcode = 0;
+    int    *stack = NULL;    // Junctions left to visit, then new order
+    int    *next = NULL;     // Next free core row of each block
+
+    EN_Network   *net = &pr->network;
+    solver_t     *solver = &pr->hydraulics.solver;
+    int    njuncs = net->Njuncs;
+    int    nc = solver->Ncore;
+    int    *block;
+    Padjlist alink;
+
+    solver->NodeBlock = (int *) calloc(net->Nnodes+1, sizeof(int));
+    solver->LinkBlock = (int *) calloc(net->Nlinks+1, sizeof(int));
+    stack = (int *) calloc(njuncs+1, sizeof(int));
+    ERRCODE(MEMCHECK(solver->NodeBlock));
+    ERRCODE(MEMCHECK(solver->LinkBlock));
+    ERRCODE(MEMCHECK(stack));
+    if (errcode)
+    {
+        FREE(stack);
+        return errcode;
+    }
+
+    // Label the junctions reached from each unlabelled one,
+    // taken in row order
+    block = solver->NodeBlock;
+    nb = 0;
+    for (k = 1; k <= njuncs; k++)
+    {
+        i = solver->Order[k];
+        if (block[i] > 0) continue;
+        nb++;
+        block[i] = nb;
+        stack[1] = i;
+        m = 1;
+        while (m > 0)
+        {
+            i = stack[m--];
+            for (alink = net->Adjlist[i]; alink != NULL; alink = alink->next)
+            {
+                j = alink->node;
+                if (j <= njuncs && block[j] == 0)
+                {
+                    block[j] = nb;
+                    stack[++m] = j;
+                }
+            }
+        }
+    }
+    for (k = 1; k <= net->Nlinks; k++)
+    {
+        i = net->Link[k].N1;
+        if (i > njuncs) i = net->Link[k].N2;
+        solver->LinkBlock[k] = block[i];
+    }
+    solver->Nblocks = nb;
+
+    // Allocate each block's first row, fixed flag and flow sums
+    solver->Xbrow  = (int *) calloc(nb+2, sizeof(int));
+    solver->Frozen = (char *) calloc(nb+1, sizeof(char));
+    solver->Bqsum  = (double *) calloc(nb+1, sizeof(double));
+    solver->Bdqsum = (double *) calloc(nb+1, sizeof(double));
+    next = (int *) calloc(nb+2, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Xbrow));
+    ERRCODE(MEMCHECK(solver->Frozen));
+    ERRCODE(MEMCHECK(solver->Bqsum));
+    ERRCODE(MEMCHECK(solver->Bdqsum));
+    ERRCODE(MEMCHECK(next));
+    if (!errcode)
+    {
+        // Count the core rows of each block
+        for (k = 1; k <= nc; k++) solver->Xbrow[block[solver->Order[k]]+1]++;
+        solver->Xbrow[1] = 1;
+        for (b = 1; b <= nb; b++)
+        {
+            solver->Xbrow[b+1] += solver->Xbrow[b];
+            next[b] = solver->Xbrow[b];
+        }
+
+        // Re-number the core rows block by block
+        for (k = 1; k <= nc; k++)
+        {
+            i = solver->Order[k];
+            stack[next[block[i]]++] = i;
+        }
+        for (k = 1; k <= nc; k++)
+        {
+            i = stack[k];
+            solver->Order[k] = i;
+            solver->Row[i] = k;
+        }
+    }
+    FREE(stack);
+    FREE(next);
+    return errcode;
+}                        /* End of findblocks */
+
+
+int  schurdomains(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: splits the core rows of the solution matrix into
+**          subdomains for the Schur complement solver, giving
+**          each one consecutive rows and the separator between
+**          them the last rows of the core
+**
+** NOTE:   Rows within a subdomain keep their relative order, so
+**         its own columns make no more fill-ins than before. As
+**         the subdomains are joined only through the separator,
+**         the blocks found by findblocks() are not kept together
+**         and those held at their solution are factorized with
+**         the rest (see solvecore()).
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, k, m, d, nd;
+    int    errcode = 0;
+    int    *xadj = NULL;     // Core graph in terms of row indexes
+    int    *adjncy = NULL;
+    int    *part = NULL;     // Subdomain of each core row (0 = separator)
+    int    *order = NULL;    // New order of the core's nodes
+
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    int    nc = solver->Ncore;
+    Padjlist alink;
+
+    xadj   = (int *) calloc(nc+2, sizeof(int));
+    adjncy = (int *) calloc(2*hyd->Ncoeffs+1, sizeof(int));
+    part   = (int *) calloc(nc+1, sizeof(int));
+    order  = (int *) calloc(nc+1, sizeof(int));
+    solver->Xdom = (int *) calloc(hyd->Subdomains+3, sizeof(int));
+    ERRCODE(MEMCHECK(xadj));
+    ERRCODE(MEMCHECK(adjncy));
+    ERRCODE(MEMCHECK(part));
+    ERRCODE(MEMCHECK(order));
+    ERRCODE(MEMCHECK(solver->Xdom));
+    if (!errcode)
+    {
+        // Build the adjacency lists of the core's rows
+        xadj[1] = 1;
+        m = 1;
+        for (k = 1; k <= nc; k++)
+        {
+            i = solver->Order[k];
+            for (alink = net->Adjlist[i]; alink != NULL; alink = alink->next)
+            {
+                j = alink->node;
+                if (j == 0 || j > net->Njuncs) continue;
+                if (solver->Row[j] > nc) continue;
+                adjncy[m++] = solver->Row[j];
+            }
+            xadj[k+1] = m;
+        }
+
+        // Split the core into subdomains
+        nd = hyd->Subdomains;
+        errcode = gendomains(nc, xadj, adjncy, &nd, part);
+    }
+    if (!errcode)
+    {
+        // Count the rows of each subdomain and of the separator
+        // (taken as subdomain nd+1)
+        for (k = 1; k <= nc; k++)
+        {
+            if (part[k] == 0) part[k] = nd + 1;
+            solver->Xdom[part[k]+1]++;
+        }
+        solver->Xdom[1] = 1;
+        for (d = 1; d <= nd; d++)
+        {
+            solver->Xdom[d+1] += solver->Xdom[d];
+            xadj[d] = solver->Xdom[d];
+        }
+        xadj[nd+1] = solver->Xdom[nd+1];
+        solver->Xdom[nd+2] = nc + 1;
+
+        // Re-number the core rows subdomain by subdomain
+        for (k = 1; k <= nc; k++) order[xadj[part[k]]++] = solver->Order[k];
+        for (k = 1; k <= nc; k++)
+        {
+            i = order[k];
+            solver->Order[k] = i;
+            solver->Row[i] = k;
+        }
+        solver->Ndomains = nd;
+        solver->Nsep = nc + 1 - solver->Xdom[nd+1];
+    }
+    FREE(xadj);
+    FREE(adjncy);
+    FREE(part);
+    FREE(order);
+    return errcode;
+}                        /* End of schurdomains */
+
+
+int  schurinterface(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: lists the separator rows joined to each subdomain by
+**          its factor's columns and allocates the arrays used
+**          to form and factorize the Schur complement
+**
+** NOTE:   Each subdomain's update to the Schur complement and
+**         its sums in the separator rows are kept apart, in terms
+**         of its own list of separator rows (Ifrows), so that
+**         the subdomains can be factorized concurrently.
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, d, r, m;
+    int    errcode = 0;
+    int    *mark = NULL;     // Last subdomain joined to each separator row
+    int    *loc = NULL;      // Position of each separator row in Ifrows
+
+    solver_t *solver = &pr->hydraulics.solver;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    nd = solver->Ndomains;
+    int    ns = solver->Nsep;
+    int    s0 = solver->Xdom[nd+1];
+
+    solver->Xif   = (int *) calloc(nd+2, sizeof(int));
+    solver->Xupd  = (int *) calloc(nd+2, sizeof(int));
+    solver->Ifloc = (int *) calloc(XLNZ[s0]+1, sizeof(int));
+    mark = (int *) calloc(ns+1, sizeof(int));
+    loc  = (int *) calloc(ns+1, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Xif));
+    ERRCODE(MEMCHECK(solver->Xupd));
+    ERRCODE(MEMCHECK(solver->Ifloc));
+    ERRCODE(MEMCHECK(mark));
+    ERRCODE(MEMCHECK(loc));
+    if (errcode) goto ENDINTERFACE;
+
+    // Count the separator rows joined to each subdomain
+    for (d = 1; d <= nd; d++)
+    {
+        m = 0;
+        for (j = solver->Xdom[d]; j < solver->Xdom[d+1]; j++)
+        {
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                r = NZSUB[i] - s0;
+                if (r >= 0 && mark[r] != d)
+                {
+                    mark[r] = d;
+                    m++;
+                }
+            }
+        }
+        solver->Xif[d+1] = solver->Xif[d] + m;
+        solver->Xupd[d+1] = solver->Xupd[d] + m*m;
+    }
+
+    solver->Ifrows = (int *) calloc(solver->Xif[nd+1]+1, sizeof(int));
+    solver->Ywork  = (double *) calloc(solver->Xif[nd+1]+1, sizeof(double));
+    solver->Upd    = (double *) calloc(solver->Xupd[nd+1]+1, sizeof(double));
+    solver->Sdense = (double *) calloc((size_t)ns*ns+1, sizeof(double));
+    ERRCODE(MEMCHECK(solver->Ifrows));
+    ERRCODE(MEMCHECK(solver->Ywork));
+    ERRCODE(MEMCHECK(solver->Upd));
+    ERRCODE(MEMCHECK(solver->Sdense));
+    if (errcode) goto ENDINTERFACE;
+
+    // List each subdomain's separator rows in ascending order and
+    // locate its columns' coeffs. in these rows within the list
+    memset(mark, 0, (ns+1)*sizeof(int));
+    for (d = 1; d <= nd; d++)
+    {
+        for (j = solver->Xdom[d]; j < solver->Xdom[d+1]; j++)
+        {
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                r = NZSUB[i] - s0;
+                if (r >= 0) mark[r] = d;
+            }
+        }
+        m = 0;
+        for (r = 0; r < ns; r++)
+        {
+            if (mark[r] != d) continue;
+            solver->Ifrows[solver->Xif[d] + m] = s0 + r;
+            loc[r] = m++;
+        }
+        for (j = solver->Xdom[d]; j < solver->Xdom[d+1]; j++)
+        {
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                r = NZSUB[i] - s0;
+                if (r >= 0) solver->Ifloc[i] = loc[r];
+            }
+        }
+    }
+
+ENDINTERFACE:
+    FREE(mark);
+    FREE(loc);
+    return errcode;
+}                        /* End of schurinterface */
+
+
 int   reordernodes(EN_Project *pr)
 /*
 **--------------------------------------------------------------
@@ -392,29 +1174,24 @@ int   reordernodes(EN_Project *pr)
 ** Output:  returns 1 if successful, 0 if not                   
 ** Purpose: re-orders nodes to minimize # of non-zeros that     
 **          will appear in factorized solution matrix           
+**
+** NOTE:   The junctions of the network's forest are then moved
+**         to the end of the ordering (see forestcore()).
 **--------------------------------------------------------------
 */
 {
     int k, knode, m, njuncs, nlinks;
-    int delta = -1;
-    int nofsub = 0;
-    int maxint = INT_MAX;   //defined in limits.h
     int errcode;
 
-    EN_Network *net = &pr->network;
-    solver_t   *solver = &pr->hydraulics.solver;
+    EN_Network   *net = &pr->network;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
     Padjlist   alink;
 
     // Local versions of node adjacency lists
     int *adjncy = NULL;
     int *xadj   = NULL;
 
-    // Work arrays
-    int *dhead = NULL;
-    int *qsize = NULL;
-    int *llist = NULL;
-    int *marker = NULL;
-  
     // Default ordering
     for (k=1; k <= net->Nnodes; k++)
     {
@@ -427,11 +1204,7 @@ int   reordernodes(EN_Project *pr)
     // Allocate memory
     adjncy = (int *) calloc(2*nlinks+1, sizeof(int));
     xadj   = (int *) calloc(njuncs+2, sizeof(int));
-    dhead  = (int *) calloc(njuncs+1, sizeof(int));
-    qsize  = (int *) calloc(njuncs + 1, sizeof(int));
-    llist  = (int *) calloc(njuncs + 1, sizeof(int));
-    marker = (int *) calloc(njuncs + 1, sizeof(int));
-    if (adjncy && xadj && dhead && qsize && llist && marker)
+    if (adjncy && xadj)
     {
         // Create local versions of node adjacency lists
         xadj[1] = 1;
@@ -450,45 +1223,249 @@ int   reordernodes(EN_Project *pr)
             xadj[k+1] = m;
         }
 
-        // Generate a multiple minimum degree node re-ordering
-        genmmd(&njuncs, xadj, adjncy, solver->Row, solver->Order, &delta,
-               dhead, qsize, llist, marker, &maxint, &nofsub);
+        // Report the cost of each available ordering
         errcode = 0;
+        if (pr->report.Statflag == FULL)
+        {
+            errcode = reportorderings(pr, njuncs, xadj, adjncy);
+        }
+
+        // Generate the selected node re-ordering
+        if (!errcode)
+        {
+            errcode = ordernodes(hyd->Ordering, njuncs, xadj, adjncy,
+                                 solver->Row, solver->Order);
+        }
+
+        // Separate the forest from the core
+        if (!errcode) errcode = forestcore(pr);
     }
     else errcode = 101;  //insufficient memory
 
     // Free memory
     FREE(adjncy);
     FREE(xadj);
-    FREE(dhead);
-    FREE(qsize);
-    FREE(llist);
-    FREE(marker);
     return errcode;
 }                        /* End of reordernodes */
 
 
-int factorize(EN_Project *pr)
+int  ordernodes(int ordering, int n, int *xadj, int *adjncy,
+                int *invp, int *perm)
 /*
 **--------------------------------------------------------------
-** Input:   none
-** Output:  returns error code
-** Purpose: symbolically factorizes the solution matrix in
-**          terms of its adjacency lists
+** Input:   ordering = type of re-ordering (see OrderingType)
+**          n = number of junctions
+**          xadj, adjncy = junction adjacency lists
+** Output:  invp = position of each junction in new ordering
+**          perm = junction at each position of new ordering
+**          returns error code
+** Purpose: re-orders junctions with the chosen algorithm
+**
+** NOTE:   The multiple minimum degree routine destroys adjncy.
 **--------------------------------------------------------------
 */
 {
-    int k, knode;
+    int delta = -1;
+    int nofsub = 0;
+    int maxint = INT_MAX;   //defined in limits.h
     int errcode = 0;
-    EN_Network *net = &pr->network;
-    solver_t   *solver = &pr->hydraulics.solver;
 
-    // Augment each junction's adjacency list to account for
-    // new connections created when solution matrix is solved.
-    // NOTE: Only junctions (indexes <= Njuncs) appear in solution matrix.
-    for (k = 1; k <= net->Njuncs; k++)              // Examine each junction
+    // Work arrays
+    int *dhead = NULL;
+    int *qsize = NULL;
+    int *llist = NULL;
+    int *marker = NULL;
+
+    switch (ordering)
     {
-        knode = solver->Order[k];                   // Re-ordered index
+    case ND:
+        errcode = gennd(n, xadj, adjncy, invp, perm);
+        break;
+    case AMD:
+        errcode = genamd(n, xadj, adjncy, invp, perm);
+        break;
+    default:
+        dhead  = (int *) calloc(n+1, sizeof(int));
+        qsize  = (int *) calloc(n+1, sizeof(int));
+        llist  = (int *) calloc(n+1, sizeof(int));
+        marker = (int *) calloc(n+1, sizeof(int));
+        if (dhead && qsize && llist && marker)
+        {
+            // Generate a multiple minimum degree node re-ordering
+            genmmd(&n, xadj, adjncy, invp, perm, &delta,
+                   dhead, qsize, llist, marker, &maxint, &nofsub);
+        }
+        else errcode = 101;
+        FREE(dhead);
+        FREE(qsize);
+        FREE(llist);
+        FREE(marker);
+    }
+    return errcode;
+}                        /* End of ordernodes */
+
+
+int  reportorderings(EN_Project *pr, int n, int *xadj, int *adjncy)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of junctions
+**          xadj, adjncy = junction adjacency lists
+** Output:  returns error code
+** Purpose: writes the number of non-zero coeffs. and predicted
+**          factorization flops of each available re-ordering
+**          to the status report
+**--------------------------------------------------------------
+*/
+{
+    int    k, ordering, nnz;
+    int    nedges = (xadj[n+1] - 1) / 2;
+    int    errcode = 0;
+    int   *adjcopy = NULL;
+    int   *invp = NULL;
+    int   *perm = NULL;
+    double flops;
+
+    adjcopy = (int *) calloc(xadj[n+1], sizeof(int));
+    invp = (int *) calloc(n+1, sizeof(int));
+    perm = (int *) calloc(n+1, sizeof(int));
+    ERRCODE(MEMCHECK(adjcopy));
+    ERRCODE(MEMCHECK(invp));
+    ERRCODE(MEMCHECK(perm));
+    for (ordering = MMD; ordering <= AMD && !errcode; ordering++)
+    {
+        memcpy(adjcopy, adjncy, xadj[n+1]*sizeof(int));
+        for (k = 1; k <= n; k++) invp[k] = perm[k] = k;
+        errcode = ordernodes(ordering, n, xadj, adjcopy, invp, perm);
+        if (errcode) break;
+        errcode = ordercost(n, xadj, adjncy, invp, perm, &nnz, &flops);
+        if (errcode) break;
+
+        // Non-zeros are counted as in createsparse(): one per link
+        // plus one for each fill-in
+        writeordering(pr, ordering, pr->network.Nlinks + nnz - nedges,
+                      flops);
+    }
+    FREE(adjcopy);
+    FREE(invp);
+    FREE(perm);
+    return errcode;
+}                        /* End of reportorderings */
+
+
+int  ordercost(int n, int *xadj, int *adjncy, int *invp, int *perm,
+               int *nnz, double *flops)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of junctions
+**          xadj, adjncy = junction adjacency lists
+**          invp, perm = re-ordering of the junctions
+** Output:  nnz = number of off-diagonal non-zeros in factor
+**          flops = predicted floating point operations to
+**                  factorize the matrix
+**          returns error code
+** Purpose: predicts the size of the factorized solution matrix
+**          without forming it
+**
+** NOTE:   The elimination tree is found first (with path
+**         compression) and then the non-zeros of each row of
+**         the factor are found by walking up the tree from
+**         each of the row's original non-zeros.
+**--------------------------------------------------------------
+*/
+{
+    int  i, j, k, m, p, next;
+    int  errcode = 0;
+    int *parent = NULL;
+    int *ancestor = NULL;
+    int *count = NULL;
+
+    parent   = (int *) calloc(n+1, sizeof(int));
+    ancestor = (int *) calloc(n+1, sizeof(int));
+    count    = (int *) calloc(n+1, sizeof(int));
+    ERRCODE(MEMCHECK(parent));
+    ERRCODE(MEMCHECK(ancestor));
+    ERRCODE(MEMCHECK(count));
+    if (errcode) goto ENDORDERCOST;
+
+    // Build the elimination tree in terms of re-ordered positions
+    for (k = 1; k <= n; k++)
+    {
+        i = perm[k];
+        for (m = xadj[i]; m < xadj[i+1]; m++)
+        {
+            p = invp[adjncy[m]];
+            while (p != 0 && p < k)
+            {
+                next = ancestor[p];
+                ancestor[p] = k;
+                if (next == 0) parent[p] = k;
+                p = next;
+            }
+        }
+    }
+
+    // Count the non-zeros in each column (ancestor marks rows)
+    memset(ancestor, 0, (n+1)*sizeof(int));
+    for (k = 1; k <= n; k++)
+    {
+        i = perm[k];
+        ancestor[k] = k;
+        for (m = xadj[i]; m < xadj[i+1]; m++)
+        {
+            for (j = invp[adjncy[m]]; j < k && ancestor[j] != k; j = parent[j])
+            {
+                count[j]++;
+                ancestor[j] = k;
+            }
+        }
+    }
+
+    // Each column with c non-zeros costs c(c+1) flops to update
+    // later columns, c divisions and one square root
+    *nnz = 0;
+    *flops = 0.0;
+    for (k = 1; k <= n; k++)
+    {
+        *nnz += count[k];
+        *flops += ((double)count[k] + 1.0) * ((double)count[k] + 1.0);
+    }
+
+ENDORDERCOST:
+    FREE(parent);
+    FREE(ancestor);
+    FREE(count);
+    return errcode;
+}                        /* End of ordercost */
+
+
+int factorize(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns error code
+** Purpose: symbolically factorizes the solution matrix in
+**          terms of its adjacency lists
+**
+** NOTE:   The separator rows of the Schur complement solver are
+**         not eliminated, as their factor is held as a dense
+**         matrix (see schurfactor()).
+**--------------------------------------------------------------
+*/
+{
+    int k, knode, n;
+    int errcode = 0;
+    solver_t   *solver = &pr->hydraulics.solver;
+
+    n = solver->Ncore;
+    if (solver->Ndomains > 0) n = solver->Xdom[solver->Ndomains+1] - 1;
+
+    // Augment each junction's adjacency list to account for
+    // new connections created when solution matrix is solved.
+    // NOTE: Only junctions (indexes <= Njuncs) appear in solution matrix
+    //       and those of the forest are eliminated without fill-in.
+    for (k = 1; k <= n; k++)                        // Examine each junction
+    {
+        knode = solver->Order[k];                   // Re-ordered index
         if (!growlist(pr, knode))                   // Augment adjacency list
         {
             errcode = 101;
@@ -625,11 +1602,17 @@ int  storesparse(EN_Project *pr, int n)
 ** Output:  returns error code                                  
 ** Purpose: stores row indexes of non-zeros of each column of   
 **          lower triangular portion of factorized matrix       
+**
+** NOTE:   Each column of a removed row (past row Ncore) stores
+**         the rows still adjacent to it when it was removed: its
+**         parent in the forest, or the two neighbours of a series
+**         junction. These are core rows or later removed rows
+**         (see forestcore()).
 **--------------------------------------------------------------
 */
 {
     Padjlist alink;
-    int   i, ii, j, k, l, m;
+    int   i, ii, j, k, l, m, nc;
     int   errcode = 0;
   
     EN_Network   *net = &pr->network;
@@ -647,6 +1630,7 @@ int  storesparse(EN_Project *pr, int n)
  
     // Generate row index pointers for each column of matrix
     k = 0;
+    nc = solver->Ncore;
     solver->XLNZ[1] = 1;
     for (i=1; i<=n; i++)            // column
     {
@@ -656,7 +1640,9 @@ int  storesparse(EN_Project *pr, int n)
         {
             j = solver->Row[alink->node];    // row
             l = alink->link;
-            if (j > i && j <= n)
+            if (j > n) continue;
+            if ((i <= nc && j > i && j <= nc) ||
+                (i > nc && (j <= nc || j > i)))
             {
                 m++;
                 k++;
@@ -673,9 +1659,19 @@ int  storesparse(EN_Project *pr, int n)
 int  sortsparse(EN_Project *pr, int n)
 /*
 **--------------------------------------------------------------
-** Input:   n = number of rows in solution matrix               
+** Input:   n = number of rows in core of solution matrix
 ** Output:  returns eror code                                   
-** Purpose: puts row indexes in ascending order in NZSUB        
+** Purpose: puts row indexes in ascending order in NZSUB and
+**          re-indexes the coeffs. of Aij to match NZSUB
+**
+** NOTE:   Once the row indexes are sorted, the position in Aij
+**         that each link assembles into (Ndx) is replaced with
+**         its entry's position in NZSUB, and the LNZ array that
+**         mapped NZSUB entries to Aij positions is freed. Each
+**         column of the factor is then stored contiguously in
+**         Aij, saving an indirect access per coeff. in linsolve().
+**         Links to tanks and reservoirs have no entry in NZSUB
+**         and assemble into the unused Aij[0].
 **--------------------------------------------------------------
 */
 {
@@ -712,7 +1708,25 @@ int  sortsparse(EN_Project *pr, int n)
         // Transpose matrix twice to order column indexes
         transpose(n, XLNZ, NZSUB, LNZ, xlnzt, nzsubt, lnzt, nzt);
         transpose(n, xlnzt, nzsubt, lnzt, XLNZ, NZSUB, LNZ, nzt);
+
+        // Point each link's Ndx entry to its coeff.'s position
+        // in NZSUB (lnzt becomes the position of each coeff.),
+        // including the links of the forest's columns
+        memset(lnzt, 0, (hyd->Ncoeffs+2)*sizeof(int));
+        for (k = 1; k < XLNZ[pr->network.Njuncs+1]; k++) lnzt[LNZ[k]] = k;
+        for (i = 1; i <= pr->network.Nlinks; i++)
+        {
+            solver->Ndx[i] = lnzt[solver->Ndx[i]];
+        }
+        if (solver->Xfill != NULL)
+        {
+            for (i = n+1; i <= pr->network.Njuncs; i++)
+            {
+                solver->Xfill[i] = lnzt[solver->Xfill[i]];
+            }
+        }
     }
+    FREE(solver->LNZ);
   
     // Reclaim memory
     FREE(xlnzt);
@@ -723,6 +1737,197 @@ int  sortsparse(EN_Project *pr, int n)
 }                        /* End of sortsparse */
 
 
+void  factorflops(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of rows in solution matrix
+** Output:  none
+** Purpose: finds the flops needed to factorize the solution
+**          matrix (counted as in ordercost())
+**
+** NOTE:   The separator rows of the Schur complement solver are
+**         counted as the columns of a dense matrix.
+**--------------------------------------------------------------
+*/
+{
+    int    j, s0 = n + 1;
+    double c;
+    solver_t *solver = &pr->hydraulics.solver;
+
+    if (solver->Ndomains > 0) s0 = solver->Xdom[solver->Ndomains+1];
+    solver->Flops = 0.0;
+    for (j = 1; j < s0; j++)
+    {
+        c = solver->XLNZ[j+1] - solver->XLNZ[j] + 1.0;
+        solver->Flops += c * c;
+    }
+    for (j = s0; j <= n; j++)
+    {
+        c = n - j + 1.0;
+        solver->Flops += c * c;
+    }
+}                        /* End of factorflops */
+
+
+int  allocworkspace(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of rows in solution matrix
+** Output:  returns error code
+** Purpose: allocates the work vectors used by linsolve()
+**
+** NOTE:   linsolve() leaves Temp and Link zeroed on exit so
+**         they need only be cleared here, once. A parallel
+**         factorization gives each thread its own section of Temp.
+**--------------------------------------------------------------
+*/
+{
+    int errcode = 0;
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t *solver = &pr->hydraulics.solver;
+
+    solver->Temp  = (double *) calloc((size_t)solver->Nthreads*(n+1),
+                                      sizeof(double));
+    solver->Link  = (int *) calloc(n+1, sizeof(int));
+    solver->First = (int *) calloc(n+1, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Temp));
+    ERRCODE(MEMCHECK(solver->Link));
+    ERRCODE(MEMCHECK(solver->First));
+
+    // Incomplete factor and vectors x, r, z, p & q of the PCG solver
+    if (hyd->LinSolver == PCG)
+    {
+        solver->Lic    = (double *) calloc(hyd->Ncoeffs+2, sizeof(double));
+        solver->Dic    = (double *) calloc(n+1, sizeof(double));
+        solver->Cgwork = (double *) calloc(5*(n+1), sizeof(double));
+        ERRCODE(MEMCHECK(solver->Lic));
+        ERRCODE(MEMCHECK(solver->Dic));
+        ERRCODE(MEMCHECK(solver->Cgwork));
+    }
+
+    // Last factorized matrix, copy of the factor (the supernodal
+    // factor is kept in place) and vectors x & r of chord steps
+    // (not made by the Schur complement solver)
+    else if (hyd->ChordTol > 0.0 && hyd->LinSolver != SCHUR)
+    {
+        solver->Adiag0 = (double *) calloc(n+1, sizeof(double));
+        solver->Aij0   = (double *) calloc(hyd->Ncoeffs+1, sizeof(double));
+        solver->Resid  = (double *) calloc(2*(n+1), sizeof(double));
+        ERRCODE(MEMCHECK(solver->Adiag0));
+        ERRCODE(MEMCHECK(solver->Aij0));
+        ERRCODE(MEMCHECK(solver->Resid));
+        if (hyd->LinSolver == CHOLESKY)
+        {
+            solver->Lii = (double *) calloc(n+1, sizeof(double));
+            solver->Lij = (double *) calloc(hyd->Ncoeffs+1, sizeof(double));
+            ERRCODE(MEMCHECK(solver->Lii));
+            ERRCODE(MEMCHECK(solver->Lij));
+        }
+    }
+
+    // Single precision factor, its work vector and vectors x & r
+    // of iterative refinement
+    else if (hyd->MixedPrec && hyd->LinSolver == CHOLESKY)
+    {
+        solver->Fii    = (float *) calloc(n+1, sizeof(float));
+        solver->Fij    = (float *) calloc(hyd->Ncoeffs+1, sizeof(float));
+        solver->Ftemp  = (float *) calloc(n+1, sizeof(float));
+        solver->Mpwork = (double *) calloc(2*(n+1), sizeof(double));
+        ERRCODE(MEMCHECK(solver->Fii));
+        ERRCODE(MEMCHECK(solver->Fij));
+        ERRCODE(MEMCHECK(solver->Ftemp));
+        ERRCODE(MEMCHECK(solver->Mpwork));
+    }
+    return(errcode);
+}                        /* End of allocworkspace */
+
+
+int  supernodes(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of rows in solution matrix
+** Output:  returns error code
+** Purpose: groups consecutive columns of the factorized matrix
+**          into supernodes and allocates their dense storage
+**
+** NOTE:   Column j+1 joins the supernode of column j when the
+**         first off-diagonal row of column j is j+1 and the
+**         remaining rows of column j are exactly those of
+**         column j+1. A supernode with first column f and last
+**         column l is stored as a dense column-major block whose
+**         rows are f and the rows listed in NZSUB for column f
+**         (which must have been sorted by sortsparse()).
+**--------------------------------------------------------------
+*/
+{
+    int   j, s, f, nrows, ncols, maxcols, need;
+    int   errcode = 0;
+    solver_t *solver = &pr->hydraulics.solver;
+    int  *XLNZ  = solver->XLNZ;
+    int  *NZSUB = solver->NZSUB;
+
+    solver->Xsuper = (int *) calloc(n+2, sizeof(int));
+    solver->Snode  = (int *) calloc(n+1, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Xsuper));
+    ERRCODE(MEMCHECK(solver->Snode));
+    if (errcode) return(errcode);
+
+    // Find the first column of each supernode
+    s = 0;
+    for (j = 1; j <= n; j++)
+    {
+        if (j == 1 ||
+            XLNZ[j-1] == XLNZ[j] ||
+            NZSUB[XLNZ[j-1]] != j ||
+            XLNZ[j] - XLNZ[j-1] != XLNZ[j+1] - XLNZ[j] + 1)
+        {
+            s++;
+            solver->Xsuper[s] = j;
+        }
+        solver->Snode[j] = s;
+    }
+    solver->Nsuper = s;
+    solver->Xsuper[s+1] = n + 1;
+
+    // Find the size of each supernode's dense block
+    // and of the largest block update
+    solver->Xblock = (int *) calloc(s+2, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Xblock));
+    if (errcode) return(errcode);
+    maxcols = 1;
+    for (s = 1; s <= solver->Nsuper; s++)
+    {
+        ncols = solver->Xsuper[s+1] - solver->Xsuper[s];
+        maxcols = MAX(maxcols, ncols);
+    }
+    solver->Nwork = 1;
+    solver->Xblock[1] = 0;
+    for (s = 1; s <= solver->Nsuper; s++)
+    {
+        f = solver->Xsuper[s];
+        ncols = solver->Xsuper[s+1] - f;
+        nrows = XLNZ[f+1] - XLNZ[f] + 1;
+        solver->Xblock[s+1] = solver->Xblock[s] + nrows*ncols;
+        need = nrows * MIN(nrows, maxcols);
+        solver->Nwork = MAX(solver->Nwork, need);
+    }
+
+    // Allocate the dense blocks and the work arrays used by snfactor()
+    solver->Lsn    = (double *) calloc(solver->Xblock[solver->Nsuper+1]+1,
+                                       sizeof(double));
+    solver->Work   = (double *) calloc(solver->Nwork, sizeof(double));
+    solver->Slink  = (int *) calloc(solver->Nsuper+2, sizeof(int));
+    solver->Sfirst = (int *) calloc(solver->Nsuper+2, sizeof(int));
+    solver->Map    = (int *) calloc(n+1, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Lsn));
+    ERRCODE(MEMCHECK(solver->Work));
+    ERRCODE(MEMCHECK(solver->Slink));
+    ERRCODE(MEMCHECK(solver->Sfirst));
+    ERRCODE(MEMCHECK(solver->Map));
+    return(errcode);
+}                        /* End of supernodes */
+
+
 void  transpose(int n, int *il, int *jl, int *xl, int *ilt, int *jlt,
                 int *xlt, int *nzt)
 /*
@@ -755,21 +1960,167 @@ void  transpose(int n, int *il, int *jl, int *xl, int *ilt, int *jlt,
 int  linsolve(EN_Project *pr, int n)
 /*
 **--------------------------------------------------------------
-** Input:   s    = solver struct
-            n    = number of equations                                                
-** Output:  s->F    = solution values                              
-**          returns 0 if solution found, or index of            
-**          equation causing system to be ill-conditioned       
-** Purpose: solves sparse symmetric system of linear            
-**          equations using Cholesky factorization              
-**                                                              
+** Input:   n    = number of equations
+** Output:  s->F = solution values
+**          returns 0 if solution found, or index of
+**          equation causing system to be ill-conditioned
+** Purpose: solves sparse symmetric system of linear
+**          equations, eliminating the rows of the forest
+**          before the core's equations are solved
+**--------------------------------------------------------------
+*/
+{
+    solver_t *solver = &pr->hydraulics.solver;
+    int      errcode;
+
+    errcode = forestfactor(solver, n);
+    if (errcode) return(errcode);
+    forestreduce(solver, n, 1, solver->F);
+    if (solver->Ncore > 0)
+    {
+        errcode = solvecore(pr, solver->Ncore);
+        if (errcode) return(errcode);
+    }
+    forestsubstitute(solver, n, 1, solver->F);
+    return(0);
+}                        /* End of linsolve */
+
+
+int  forestfactor(solver_t *solver, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  Aii, Aij = coeffs. of the removed rows and of the
+**                     reduced matrix of the core
+**          returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: eliminates the rows of the forest (and any series
+**          junctions) from the solution matrix, in the order
+**          they were removed by forestcore()
+**
+** NOTE:   Column r of a removed row holds the coeffs. a joining
+**         it to its parent row q, or to the two rows p and q it
+**         lies in series between (see storesparse()). Eliminating
+**         row r subtracts a*a/Aii[r] from Aii[q] and, for a series
+**         row, a(p)*a(q)/Aii[r] from the coeff. joining p and q
+**         (at Aij[Xfill[r]]). So the rows are eliminated in linear
+**         time and their own coeffs. are left unchanged for use
+**         by forestreduce() and forestsubstitute().
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, r;
+
+    for (r = solver->Ncore + 1; r <= n; r++)
+    {
+        if (Aii[r] <= 0.0) return(r);
+        for (i = XLNZ[r]; i < XLNZ[r+1]; i++)
+        {
+            Aii[NZSUB[i]] -= Aij[i]*Aij[i]/Aii[r];
+        }
+        if (XLNZ[r+1] - XLNZ[r] == 2)
+        {
+            i = XLNZ[r];
+            Aij[solver->Xfill[r]] -= Aij[i]*Aij[i+1]/Aii[r];
+        }
+    }
+    return(0);
+}                        /* End of forestfactor */
+
+
+void  forestreduce(solver_t *solver, int n, int k, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          k = number of right hand sides
+**          B = right hand sides (see linsolvemulti())
+** Output:  B = right hand sides of the reduced core equations
+** Purpose: applies the elimination of the removed rows made by
+**          forestfactor() to the right hand sides
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, r, s;
+    double l, *br, *bq;
+
+    for (r = solver->Ncore + 1; r <= n; r++)
+    {
+        br = B + r*k;
+        for (i = XLNZ[r]; i < XLNZ[r+1]; i++)
+        {
+            bq = B + NZSUB[i]*k;
+            l = Aij[i] / Aii[r];
+            for (s = 0; s < k; s++) bq[s] -= l*br[s];
+        }
+    }
+}                        /* End of forestreduce */
+
+
+void  forestsubstitute(solver_t *solver, int n, int k, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          k = number of right hand sides
+**          B = core solution values and reduced right hand
+**              sides of the removed rows
+** Output:  B = solution values
+** Purpose: finds the solution values of the removed rows, in
+**          the reverse of their order of removal, once the core
+**          has been solved
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, r, s;
+    double a, d, *br, *bq;
+
+    for (r = n; r > solver->Ncore; r--)
+    {
+        br = B + r*k;
+        for (i = XLNZ[r]; i < XLNZ[r+1]; i++)
+        {
+            bq = B + NZSUB[i]*k;
+            a = Aij[i];
+            for (s = 0; s < k; s++) br[s] -= a*bq[s];
+        }
+        d = 1.0 / Aii[r];
+        for (s = 0; s < k; s++) br[s] *= d;
+    }
+}                        /* End of forestsubstitute */
+
+
+int  solvecore(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n    = number of rows in core of solution matrix
+** Output:  s->F = solution values
+**          returns 0 if solution found, or index of
+**          equation causing system to be ill-conditioned
+** Purpose: solves the reduced equations of the core using
+**          Cholesky factorization (or the selected solver)
+**
 ** NOTE:   This procedure assumes that the solution matrix has  
 **         been symbolically factorized with the positions of   
 **         the lower triangular, off-diagonal, non-zero coeffs. 
 **         stored in the following integer arrays:              
 **            XLNZ  (start position of each column in NZSUB)    
 **            NZSUB (row index of each non-zero in each column) 
-**            LNZ   (position of each NZSUB entry in Aij array) 
+**         The coeffs. are stored in Aij in the same order as NZSUB
+**         (see sortsparse()), so column j of L is held contiguously
+**         in Aij[XLNZ[j]] to Aij[XLNZ[j+1]-1].
+**         The work vectors Temp, Link and First are supplied by
+**         createsparse(); Temp and Link are returned zeroed.
 **                                                              
 **  This procedure has been adapted from subroutines GSFCT and  
 **  GSSLV in the book "Computer Solution of Large Sparse        
@@ -782,37 +2133,135 @@ int  linsolve(EN_Project *pr, int n)
     double *Aii = solver->Aii;
     double *Aij = solver->Aij;
     double *B   = solver->F;
-    int *LNZ    = solver->LNZ;
-    int *XLNZ   = solver->XLNZ;
-    int *NZSUB  = solver->NZSUB;
-  
-   int    *link, *first;
-   int    i, istop, istrt, isub, j, k, kfirst, newk;
+   int    b;
    int    errcode = 0;
-   double bj, diagj, ljk;
-   double *temp;
-
-   temp = (double *) calloc(n+1, sizeof(double));
-   link = (int *) calloc(n+1,sizeof(int));
-   first = (int *) calloc(n+1,sizeof(int));
-   ERRCODE(MEMCHECK(temp));
-   ERRCODE(MEMCHECK(link));
-   ERRCODE(MEMCHECK(first));
-   if (errcode)
+
+   /* Reuse the last factor (a chord step) if A has changed little */
+   if (solver->Adiag0 != NULL)
+   {
+      solver->Chordstep = FALSE;
+      if (chordstep(pr, n)) return(0);
+      memcpy(solver->Adiag0, Aii, (n+1)*sizeof(double));
+      if (solver->Aij0 != NULL)
+      {
+         memcpy(solver->Aij0, Aij,
+                (pr->hydraulics.Ncoeffs+1)*sizeof(double));
+      }
+      solver->Chord = FALSE;
+      solver->Refactor = FALSE;
+   }
+   solver->Nfactor++;
+
+   /* Use the supernodal factorization if it was selected */
+   if (solver->Nsuper > 0)
+   {
+      errcode = snfactor(pr);
+      if (errcode == 0)
+      {
+         solver->Chord = TRUE;
+         snsolve(solver, B);
+      }
+      return(errcode);
+   }
+
+   /* Use the iterative solver if it was selected */
+   if (solver->Lic != NULL) return pcgsolve(pr, n);
+
+   /* Try a single precision factor if mixed precision was selected */
+   /* (the double precision factor is used for the rest of the      */
+   /* hydraulic solution once refinement fails)                     */
+   if (solver->Fij != NULL && !solver->Mpfail)
+   {
+      if (mpsolve(pr, n) == 0) return(0);
+      solver->Mpfail = TRUE;
+      solver->Nfactor++;
+   }
+
+   /* Use the Schur complement solver if it was selected */
+   if (solver->Ndomains > 0)
+   {
+      errcode = schurfactor(solver);
+      if (errcode == 0) schursolve(solver, B);
+      return(errcode);
+   }
+
+   /* Only factorize the blocks not held at their solution */
+   if (solver->Nfrozen > 0)
+   {
+      errcode = blockfactor(solver);
+      if (errcode) return(errcode);
+      goto SUBSTITUTE;
+   }
+
+   /* Use the parallel factorization if it was set up */
+   if (solver->Parent != NULL)
+   {
+      errcode = etfactor(pr, n);
+      if (errcode) return(errcode);
+      goto SUBSTITUTE;
+   }
+
+   /* Factorize the matrix one column at a time */
+   errcode = factorcolumns(solver, 1, n, solver->Temp);
+   if (errcode) return(errcode);
+
+SUBSTITUTE:
+   /* Keep a copy of the factor for later chord steps */
+   solver->Chord = TRUE;
+   if (solver->Lij != NULL)
+   {
+      memcpy(solver->Lii, Aii, (n+1)*sizeof(double));
+      memcpy(solver->Lij, Aij, (pr->hydraulics.Ncoeffs+1)*sizeof(double));
+   }
+   if (solver->Nfrozen == 0) substitute(solver, 1, n, Aii, Aij, B);
+   else for (b = 1; b <= solver->Nblocks; b++)
    {
-      errcode = -errcode;
-      goto ENDLINSOLVE;
+      if (solver->Frozen[b]) continue;
+      substitute(solver, solver->Xbrow[b], solver->Xbrow[b+1]-1,
+                 Aii, Aij, B);
    }
-   memset(temp,0,(n+1)*sizeof(double));
-   memset(link,0,(n+1)*sizeof(int));
+   return(errcode);
+}                        /* End of solvecore */
+
+
+int  factorcolumns(solver_t *solver, int j1, int j2, double *temp)
+/*
+**--------------------------------------------------------------
+** Input:   j1, j2 = first and last columns to factorize
+**          temp   = work vector
+** Output:  Aii, Aij = Cholesky factor L of the matrix
+**          returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: factorizes the solution matrix in place one column
+**          at a time (see linsolve())
+**
+** NOTE:   Columns j1 to j2 must not be joined to any earlier
+**         columns, i.e. they are all of the matrix, independent
+**         blocks of it (see findblocks()) or a subdomain of the
+**         Schur complement solver. Columns past j2 (a subdomain's
+**         separator rows) are not factorized, but their entries
+**         of temp are used, so concurrent subdomains need their
+**         own parts of it (see schurfactor()).
+**--------------------------------------------------------------
+*/
+{
+   double *Aii = solver->Aii;
+   double *Aij = solver->Aij;
+   int    *XLNZ = solver->XLNZ;
+   int    *NZSUB = solver->NZSUB;
+   int    *link = solver->Link;
+   int    *first = solver->First;
+   int    i, istop, istrt, isub, j, k, kfirst, newk;
+   double bj, diagj, ljk;
 
    /* Begin numerical factorization of matrix A into L */
-   /*   Compute column L(*,j) for j = 1,...n */
-   for (j=1; j<=n; j++)
+   /*   Compute column L(*,j) for j = j1,...j2 */
+   for (j=j1; j<=j2; j++)
    {
       /* For each column L(*,k) that affects L(*,j): */
       diagj = 0.0;
       newk = link[j];
+      link[j] = 0;
       k = newk;
       while (k != 0)
       {
@@ -821,7 +2270,7 @@ int  linsolve(EN_Project *pr, int n)
          /* L(*,k) starting at first[k] of L(*,k).   */
          newk = link[k];
          kfirst = first[k];
-         ljk = Aij[LNZ[kfirst]];
+         ljk = Aij[kfirst];
          diagj += ljk*ljk;
          istrt = kfirst + 1;
          istop = XLNZ[k+1] - 1;
@@ -832,16 +2281,21 @@ int  linsolve(EN_Project *pr, int n)
 	     /* and 'link' for future modification steps.   */
             first[k] = istrt;
             isub = NZSUB[istrt];
-            link[k] = link[isub];
-            link[isub] = k;
+            if (isub <= j2)
+            {
+               link[k] = link[isub];
+               link[isub] = k;
+            }
+            else link[k] = 0;
 
 	    /* The actual mod is saved in vector 'temp'. */
             for (i=istrt; i<=istop; i++)
             {
                isub = NZSUB[i];
-               temp[isub] += Aij[LNZ[i]]*ljk;
+               temp[isub] += Aij[i]*ljk;
             }
          }
+         else link[k] = 0;     /* Column k is finished */
          k = newk;
       }
 
@@ -850,8 +2304,10 @@ int  linsolve(EN_Project *pr, int n)
       diagj = Aii[j] - diagj;
       if (diagj <= 0.0)        /* Check for ill-conditioning */
       {
-         errcode = j;
-         goto ENDLINSOLVE;
+         /* Restore the work vectors to their zeroed state */
+         memset(temp+j1,0,(j2-j1+1)*sizeof(double));
+         memset(link+j1,0,(j2-j1+1)*sizeof(int));
+         return(j);
       }
       diagj = sqrt(diagj);
       Aii[j] = diagj;
@@ -861,58 +2317,1777 @@ int  linsolve(EN_Project *pr, int n)
       {
          first[j] = istrt;
          isub = NZSUB[istrt];
-         link[j] = link[isub];
-         link[isub] = j;
+         if (isub <= j2)
+         {
+            link[j] = link[isub];
+            link[isub] = j;
+         }
          for (i=istrt; i<=istop; i++)
          {
             isub = NZSUB[i];
-            bj = (Aij[LNZ[i]] - temp[isub])/diagj;
-            Aij[LNZ[i]] = bj;
+            bj = (Aij[i] - temp[isub])/diagj;
+            Aij[i] = bj;
             temp[isub] = 0.0;
          }
       }
    }      /* next j */
 
-   /* Foward substitution */
-   for (j=1; j<=n; j++)
-   {
-      bj = B[j]/Aii[j];
-      B[j] = bj;
-      istrt = XLNZ[j];
-      istop = XLNZ[j+1] - 1;
-      if (istop >= istrt)
-      {
-         for (i=istrt; i<=istop; i++)
-         {
-            isub = NZSUB[i];
-            B[isub] -= Aij[LNZ[i]]*bj;
-         }
-      }
-   }
+   return(0);
+}                        /* End of factorcolumns */
 
-   /* Backward substitution */
-   for (j=n; j>=1; j--)
-   {
-      bj = B[j];
-      istrt = XLNZ[j];
-      istop = XLNZ[j+1] - 1;
-      if (istop >= istrt)
-      {
-         for (i=istrt; i<=istop; i++)
-         {
-            isub = NZSUB[i];
-            bj -= Aij[LNZ[i]]*B[isub];
-         }
-      }
-      B[j] = bj/Aii[j];
-   }
 
-ENDLINSOLVE:
-   free(temp);
-   free(link);
-   free(first);
-   return(errcode);
-}                        /* End of linsolve */
+int  blockfactor(solver_t *solver)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  Aii, Aij = Cholesky factor L of the matrix
+**          returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: factorizes the core columns of each independent
+**          block not held at its solution, the blocks being
+**          shared among the factorization threads
+**
+** NOTE:   The rows of a block held at its solution are those of
+**         the identity matrix (see nodecoeffs() in HYDCOEFFS.C),
+**         which is its own factor.
+**         The threads share Temp, Link and First without locking.
+**         This is safe only because factorcolumns() touches just
+**         the entries of these vectors indexed by the rows of the
+**         columns it factorizes, and no non-zero of the matrix
+**         joins two blocks (see findblocks()), so the blocks use
+**         disjoint parts of them. Any change that lets a block's
+**         columns reach another block's rows needs per-thread
+**         work vectors, like the parts of Temp that etfactor()
+**         and schurfactor() give each thread.
+**--------------------------------------------------------------
+*/
+{
+    int b, err;
+    int errcode = 0;
+
+#if defined(_OPENMP) && _OPENMP >= 201107
+    #pragma omp parallel for private(err) schedule(dynamic) \
+            num_threads(solver->Nthreads) if (solver->Nthreads > 1)
+#endif
+    for (b = 1; b <= solver->Nblocks; b++)
+    {
+        if (solver->Frozen[b]) continue;
+        err = factorcolumns(solver, solver->Xbrow[b], solver->Xbrow[b+1]-1,
+                            solver->Temp);
+        if (err > 0)
+        {
+#if defined(_OPENMP) && _OPENMP >= 201107
+            #pragma omp critical
+#endif
+            if (errcode == 0 || err < errcode) errcode = err;
+        }
+    }
+    return(errcode);
+}                        /* End of blockfactor */
+
+
+int  schurfactor(solver_t *solver)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  Aii, Aij = Cholesky factor of the subdomains' columns
+**          Sdense   = Cholesky factor of the Schur complement
+**          returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: factorizes the subdomains concurrently, forms the
+**          Schur complement of the separator rows from their
+**          updates and factorizes it as a dense matrix
+**
+** NOTE:   The Schur complement is held by columns in Sdense,
+**         only its lower triangle being used. The updates are
+**         subtracted from it in subdomain order and each of its
+**         coeffs. is found with the same operations by any
+**         number of threads, so results do not depend on it.
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *S = solver->Sdense;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    nd = solver->Ndomains;
+    int    ns = solver->Nsep;
+    int    s0 = solver->Xdom[nd+1];
+    int    a, b, d, i, j, k, m, err;
+    int    errcode = 0;
+    int    *rows;
+    double diag, l, *sj, *sk, *u;
+    double *temp;
+
+    // Factorize each subdomain and find its update to the Schur
+    // complement, each thread using its own part of Temp
+#if defined(_OPENMP) && _OPENMP >= 201107
+    #pragma omp parallel for private(err, temp) schedule(dynamic) \
+            num_threads(solver->Nthreads) if (solver->Nthreads > 1)
+#endif
+    for (d = 1; d <= nd; d++)
+    {
+        temp = solver->Temp;
+#if defined(_OPENMP) && _OPENMP >= 201107
+        temp += (size_t)omp_get_thread_num() * (solver->Ncore+1);
+#endif
+        err = factorcolumns(solver, solver->Xdom[d], solver->Xdom[d+1]-1,
+                            temp);
+        if (err == 0) schurupdate(solver, d);
+        else
+        {
+            memset(temp+s0, 0, ns*sizeof(double));
+#if defined(_OPENMP) && _OPENMP >= 201107
+            #pragma omp critical
+#endif
+            if (errcode == 0 || err < errcode) errcode = err;
+        }
+    }
+    if (errcode) return(errcode);
+
+    // Form the Schur complement from the separator's own coeffs.
+    // less the update of each subdomain
+    memset(S, 0, (size_t)ns*ns*sizeof(double));
+    for (j = 0; j < ns; j++)
+    {
+        sj = S + (size_t)j*ns;
+        sj[j] = Aii[s0+j];
+        for (i = XLNZ[s0+j]; i < XLNZ[s0+j+1]; i++) sj[NZSUB[i]-s0] = Aij[i];
+    }
+    for (d = 1; d <= nd; d++)
+    {
+        rows = solver->Ifrows + solver->Xif[d];
+        m = solver->Xif[d+1] - solver->Xif[d];
+        u = solver->Upd + solver->Xupd[d];
+        for (b = 0; b < m; b++)
+        {
+            sj = S + (size_t)(rows[b]-s0)*ns - s0;
+            for (a = b; a < m; a++) sj[rows[a]] -= u[b*m+a];
+        }
+    }
+
+    // Factorize the Schur complement column by column, updating
+    // the columns that follow each one concurrently
+    for (j = 0; j < ns; j++)
+    {
+        sj = S + (size_t)j*ns;
+        diag = sj[j];
+        if (diag <= 0.0) return(s0+j);
+        diag = sqrt(diag);
+        sj[j] = diag;
+        for (i = j+1; i < ns; i++) sj[i] /= diag;
+#if defined(_OPENMP) && _OPENMP >= 201107
+        #pragma omp parallel for private(i, l, sk) schedule(static) \
+                num_threads(solver->Nthreads) \
+                if (solver->Nthreads > 1 && ns-j > SCHURPAR)
+#endif
+        for (k = j+1; k < ns; k++)
+        {
+            l = sj[k];
+            if (l == 0.0) continue;
+            sk = S + (size_t)k*ns;
+            for (i = k; i < ns; i++) sk[i] -= sj[i]*l;
+        }
+    }
+    return(0);
+}                        /* End of schurfactor */
+
+
+void  schurupdate(solver_t *solver, int d)
+/*
+**--------------------------------------------------------------
+** Input:   d = index of a factorized subdomain
+** Output:  none
+** Purpose: finds the update a subdomain makes to the Schur
+**          complement of the separator rows
+**
+** NOTE:   The update is the sum over the subdomain's columns of
+**         the outer product of their coeffs. in separator rows,
+**         which are the last ones of each column. It is held by
+**         columns in terms of the subdomain's separator rows.
+**--------------------------------------------------------------
+*/
+{
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *Ifloc = solver->Ifloc;
+    int    s0 = solver->Xdom[solver->Ndomains+1];
+    int    m = solver->Xif[d+1] - solver->Xif[d];
+    double *u = solver->Upd + solver->Xupd[d];
+    int    i, i1, i2, j, p;
+    double l, *up;
+
+    memset(u, 0, (size_t)m*m*sizeof(double));
+    for (j = solver->Xdom[d]; j < solver->Xdom[d+1]; j++)
+    {
+        i2 = XLNZ[j+1];
+        for (i1 = i2; i1 > XLNZ[j] && NZSUB[i1-1] >= s0; i1--);
+        for (p = i1; p < i2; p++)
+        {
+            l = Aij[p];
+            up = u + (size_t)Ifloc[p]*m;
+            for (i = p; i < i2; i++) up[Ifloc[i]] += Aij[i]*l;
+        }
+    }
+}                        /* End of schurupdate */
+
+
+void  schursolve(solver_t *solver, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   B = right hand side
+** Output:  B = solution values
+** Purpose: solves the core's equations with the factor found
+**          by schurfactor()
+**
+** NOTE:   Forward substitution through a subdomain's columns
+**         gathers its sums in the separator rows in Ywork. These
+**         are applied in subdomain order before the separator
+**         rows are solved, after which the backward substitution
+**         of each subdomain only reads their values.
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *S = solver->Sdense;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *Ifloc = solver->Ifloc;
+    int    nd = solver->Ndomains;
+    int    ns = solver->Nsep;
+    int    s0 = solver->Xdom[nd+1];
+    int    a, d, i, isub, j, m;
+    double bj, *sj, *x, *y;
+
+    // Forward substitution through each subdomain
+#if defined(_OPENMP) && _OPENMP >= 201107
+    #pragma omp parallel for private(a, i, isub, j, m, bj, y) \
+            schedule(dynamic) num_threads(solver->Nthreads) \
+            if (solver->Nthreads > 1)
+#endif
+    for (d = 1; d <= nd; d++)
+    {
+        y = solver->Ywork + solver->Xif[d];
+        m = solver->Xif[d+1] - solver->Xif[d];
+        for (a = 0; a < m; a++) y[a] = 0.0;
+        for (j = solver->Xdom[d]; j < solver->Xdom[d+1]; j++)
+        {
+            bj = B[j]/Aii[j];
+            B[j] = bj;
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                isub = NZSUB[i];
+                if (isub < s0) B[isub] -= Aij[i]*bj;
+                else y[Ifloc[i]] += Aij[i]*bj;
+            }
+        }
+    }
+    for (d = 1; d <= nd; d++)
+    {
+        y = solver->Ywork + solver->Xif[d];
+        m = solver->Xif[d+1] - solver->Xif[d];
+        for (a = 0; a < m; a++) B[solver->Ifrows[solver->Xif[d]+a]] -= y[a];
+    }
+
+    // Forward and backward substitution through the separator
+    x = B + s0;
+    for (j = 0; j < ns; j++)
+    {
+        sj = S + (size_t)j*ns;
+        bj = x[j]/sj[j];
+        x[j] = bj;
+        for (i = j+1; i < ns; i++) x[i] -= sj[i]*bj;
+    }
+    for (j = ns-1; j >= 0; j--)
+    {
+        sj = S + (size_t)j*ns;
+        bj = x[j];
+        for (i = j+1; i < ns; i++) bj -= sj[i]*x[i];
+        x[j] = bj/sj[j];
+    }
+
+    // Backward substitution through each subdomain
+#if defined(_OPENMP) && _OPENMP >= 201107
+    #pragma omp parallel for private(i, j, bj) schedule(dynamic) \
+            num_threads(solver->Nthreads) if (solver->Nthreads > 1)
+#endif
+    for (d = 1; d <= nd; d++)
+    {
+        for (j = solver->Xdom[d+1]-1; j >= solver->Xdom[d]; j--)
+        {
+            bj = B[j];
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++) bj -= Aij[i]*B[NZSUB[i]];
+            B[j] = bj/Aii[j];
+        }
+    }
+}                        /* End of schursolve */
+
+
+void  substitute(solver_t *solver, int j1, int j2, double *lii,
+                 double *lij, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   j1  = first row to solve for
+**          j2  = last row to solve for (see factorcolumns())
+**          lii = diagonal of Cholesky factor
+**          lij = off-diagonal coeffs. of Cholesky factor
+**          B   = right hand side
+** Output:  B   = solution values
+** Purpose: solves L*L'*x = B by forward and backward substitution
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, istop, istrt, isub, j;
+    double bj;
+
+   /* Foward substitution */
+   for (j=j1; j<=j2; j++)
+   {
+      bj = B[j]/lii[j];
+      B[j] = bj;
+      istrt = XLNZ[j];
+      istop = XLNZ[j+1] - 1;
+      if (istop >= istrt)
+      {
+         for (i=istrt; i<=istop; i++)
+         {
+            isub = NZSUB[i];
+            B[isub] -= lij[i]*bj;
+         }
+      }
+   }
+
+   /* Backward substitution */
+   for (j=j2; j>=j1; j--)
+   {
+      bj = B[j];
+      istrt = XLNZ[j];
+      istop = XLNZ[j+1] - 1;
+      if (istop >= istrt)
+      {
+         for (i=istrt; i<=istop; i++)
+         {
+            isub = NZSUB[i];
+            bj -= lij[i]*B[isub];
+         }
+      }
+      B[j] = bj/lii[j];
+   }
+}                        /* End of substitute */
+
+
+int  linsolvemulti(EN_Project *pr, int n, int k, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          k = number of right hand sides
+**          B = right hand sides, with B[j*k+s] holding row j of
+**              right hand side s (s = 0, ..., k-1)
+** Output:  B = solution values, stored in the same way
+**          returns 0 if solution found, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: solves the linearized hydraulic equations for several
+**          right hand sides with a single factorization
+**
+** NOTE:   With the PCG solver each right hand side is solved in
+**         turn using F as work space, and with the supernodal and
+**         Schur complement solvers the factor is applied to each
+**         one in turn.
+**         Otherwise the k right hand sides are substituted
+**         together, row by row, so that the operations on them
+**         can be vectorized.
+**--------------------------------------------------------------
+*/
+{
+    solver_t *solver = &pr->hydraulics.solver;
+    double   *F = solver->F;
+    int      errcode = 0;
+    int      j, s, nc = solver->Ncore;
+
+    // Eliminate the forest's rows
+    errcode = forestfactor(solver, n);
+    if (errcode) return(errcode);
+    forestreduce(solver, n, k, B);
+
+    // The supernodal factor formed here replaces any kept factor
+    if (solver->Nsuper > 0) solver->Chord = FALSE;
+
+    // Factorize the core once, then solve it for each right hand
+    // side in turn ...
+    if (nc > 0)
+    {
+        if (solver->Nsuper > 0) errcode = snfactor(pr);
+        else if (solver->Ndomains > 0) errcode = schurfactor(solver);
+        else if (solver->Lic != NULL) errcode = 0;
+        else if (solver->Parent != NULL) errcode = etfactor(pr, nc);
+        else errcode = factorcolumns(solver, 1, nc, solver->Temp);
+        if (errcode) return(errcode);
+
+        if (solver->Nsuper > 0 || solver->Ndomains > 0 ||
+            solver->Lic != NULL)
+        {
+            for (s = 0; s < k; s++)
+            {
+                for (j = 1; j <= nc; j++) F[j] = B[j*k+s];
+                if (solver->Nsuper > 0) snsolve(solver, F);
+                else if (solver->Ndomains > 0) schursolve(solver, F);
+                else errcode = pcgsolve(pr, nc);
+                if (errcode) return(errcode);
+                for (j = 1; j <= nc; j++) B[j*k+s] = F[j];
+            }
+        }
+
+        // ... or for all right hand sides at once
+        else multisubstitute(solver, nc, k, solver->Aii, solver->Aij, B);
+    }
+
+    // Find the solution values of the forest's rows
+    forestsubstitute(solver, n, k, B);
+    return(errcode);
+}                        /* End of linsolvemulti */
+
+
+void  multisubstitute(solver_t *solver, int n, int k, double *lii,
+                      double *lij, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   n   = number of equations
+**          k   = number of right hand sides
+**          lii = diagonal of Cholesky factor
+**          lij = off-diagonal coeffs. of Cholesky factor
+**          B   = right hand sides (see linsolvemulti())
+** Output:  B   = solution values
+** Purpose: solves L*L'*X = B for k right hand sides by forward
+**          and backward substitution
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, j, s;
+    double d, l, *bj, *bi;
+
+    // Forward substitution
+    for (j = 1; j <= n; j++)
+    {
+        bj = B + j*k;
+        d = 1.0 / lii[j];
+        for (s = 0; s < k; s++) bj[s] *= d;
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+        {
+            bi = B + NZSUB[i]*k;
+            l = lij[i];
+            for (s = 0; s < k; s++) bi[s] -= l*bj[s];
+        }
+    }
+
+    // Backward substitution
+    for (j = n; j >= 1; j--)
+    {
+        bj = B + j*k;
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+        {
+            bi = B + NZSUB[i]*k;
+            l = lij[i];
+            for (s = 0; s < k; s++) bj[s] -= l*bi[s];
+        }
+        d = 1.0 / lii[j];
+        for (s = 0; s < k; s++) bj[s] *= d;
+    }
+}                        /* End of multisubstitute */
+
+
+int  chordstep(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  solver->F = solution values
+**          returns 1 if a chord step was made, 0 if the matrix
+**          should be factorized instead
+** Purpose: solves the linearized hydraulic equations with the
+**          factor of an earlier matrix if that matrix is close
+**          enough to the current one
+**
+** NOTE:   The old factor is applied to the residual of the
+**         current equations at the current heads and the result
+**         added to those heads (H = H0 + L0^-1*(F - A*H0)), so a
+**         converged solution satisfies the current equations
+**         exactly. It is reused until hydsolve() finds that
+**         convergence has stalled, and while it is within
+**         UPDTOL*ChordTol of every coeff. of A. A kept column
+**         factor is first updated for the coeffs. that have
+**         changed by more than this, if that costs less than a
+**         new factorization (see updatefactor()). The supernodal
+**         factor cannot be updated, so it is only reused if none
+**         have (see samefactor()). Both solvers therefore take
+**         their chord steps with a factor of nearly the current
+**         matrix, and converge to the solution that Newton steps
+**         find.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    double *B = solver->F;
+    double *x = solver->Resid;
+    double *r = x + (n+1);
+    int    j;
+
+    if (!solver->Chord || solver->Refactor) return(0);
+    if (solver->Lij != NULL)
+    {
+        if (!updatefactor(pr, n)) return(0);
+    }
+    else if (!samefactor(pr, n)) return(0);
+
+    // Find the residual of the current equations at the current heads
+    for (j = 1; j <= n; j++) x[j] = hyd->NodeHead[solver->Order[j]];
+    matvec(solver, n, x, r);
+    for (j = 1; j <= n; j++) r[j] = B[j] - r[j];
+
+    // Correct the heads with the old factor
+    if (solver->Nsuper > 0) snsolve(solver, r);
+    else substitute(solver, 1, n, solver->Lii, solver->Lij, r);
+    for (j = 1; j <= n; j++) B[j] = x[j] + r[j];
+    solver->Chordstep = TRUE;
+    return(1);
+}                        /* End of chordstep */
+
+
+int  updatefactor(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  returns 1 if the kept factor is close enough to the
+**          current matrix, 0 if the matrix should be factorized
+** Purpose: updates the kept Cholesky factor for the coeffs. of A
+**          that have changed by more than UPDTOL*ChordTol since it
+**          was formed, if this costs less than a new factorization
+**
+** NOTE:   The off-diagonal coeff. of A joining rows i and j is
+**         minus the sum of the P coeffs. of the links between
+**         them, so a change d in it is the rank-1 change
+**         d*(e_i - e_j)*(e_i - e_j)' of A. What is left of the
+**         change in each diagonal coeff. (from links to tanks,
+**         emitters, demands and active valves) is the rank-1
+**         change d*e_i*e_i'. Each update only visits the columns
+**         of L on the paths from i and j to the root of the
+**         matrix's elimination tree, so closing or opening a few
+**         links (e.g. with EN_setlinkvalue() between calls to
+**         EN_runH()) costs far less than refactorizing. A change
+**         the size of CBIG (an active valve's diagonal coeff. or
+**         an active FCV's link coeff.) is not updated, since
+**         taking it out again would leave little more than
+**         rounding error in the columns it passes through.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *Adiag0 = solver->Adiag0;
+    double *Aij0 = solver->Aij0;
+    double *dsum = solver->Resid;      // Link changes made to each row
+    double *w = dsum + (n+1);          // Update vector
+    double tol = UPDTOL * hyd->ChordTol;
+    double cost = 0.0, delta;
+    int    i, j, k;
+
+    // Find the cost of updating the factor for each changed coeff.
+    memset(dsum, 0, (n+1)*sizeof(double));
+    for (j = 1; j <= n; j++)
+    {
+        for (k = XLNZ[j]; k < XLNZ[j+1]; k++)
+        {
+            i = NZSUB[k];
+            delta = Aij0[k] - Aij[k];
+            if (fabs(delta) <= tol * MIN(Adiag0[i], Adiag0[j])) continue;
+            if (fabs(delta) >= 0.5 * CBIG) return(0);
+            dsum[i] += delta;
+            dsum[j] += delta;
+            cost += pathcost(solver, i) + pathcost(solver, j);
+            if (cost > solver->Flops) return(0);
+        }
+    }
+    for (i = 1; i <= n; i++)
+    {
+        delta = Aii[i] - Adiag0[i] - dsum[i];
+        if (fabs(delta) <= tol * Adiag0[i]) continue;
+        if (fabs(delta) >= 0.5 * CBIG) return(0);
+        cost += pathcost(solver, i);
+        if (cost > solver->Flops) return(0);
+    }
+    if (cost == 0.0) return(1);
+    memset(w, 0, (n+1)*sizeof(double));
+
+    // Update the factor for the changed off-diagonal coeffs.
+    for (j = 1; j <= n; j++)
+    {
+        for (k = XLNZ[j]; k < XLNZ[j+1]; k++)
+        {
+            i = NZSUB[k];
+            delta = Aij0[k] - Aij[k];
+            if (fabs(delta) <= tol * MIN(Adiag0[i], Adiag0[j])) continue;
+            if (!cholupdate(solver, i, j, delta, w)) goto FAILED;
+            Aij0[k] = Aij[k];
+            solver->Nupdate++;
+        }
+    }
+
+    // Update the factor for the rest of the diagonal changes
+    for (i = 1; i <= n; i++)
+    {
+        Adiag0[i] += dsum[i];
+        delta = Aii[i] - Adiag0[i];
+        if (fabs(delta) <= tol * (Adiag0[i] - dsum[i])) continue;
+        if (!cholupdate(solver, i, 0, delta, w)) goto FAILED;
+        Adiag0[i] = Aii[i];
+        solver->Nupdate++;
+    }
+    return(1);
+
+    // A downdate lost positive definiteness so the factor is lost
+FAILED:
+    solver->Chord = FALSE;
+    return(0);
+}                        /* End of updatefactor */
+
+
+int  samefactor(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  returns 1 if the kept factor is close enough to the
+**          current matrix, 0 if the matrix should be factorized
+** Purpose: checks that no coeff. of A has changed by more than
+**          UPDTOL*ChordTol since the kept factor was formed
+**
+** NOTE:   These are the coeffs. that updatefactor() would
+**         update in a kept column factor, with the same test.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *Adiag0 = solver->Adiag0;
+    double *Aij0 = solver->Aij0;
+    double tol = UPDTOL * hyd->ChordTol;
+    int    i, j, k;
+
+    for (j = 1; j <= n; j++)
+    {
+        if (fabs(Aii[j] - Adiag0[j]) > tol * Adiag0[j]) return(0);
+        for (k = XLNZ[j]; k < XLNZ[j+1]; k++)
+        {
+            i = NZSUB[k];
+            if (fabs(Aij0[k] - Aij[k]) > tol * MIN(Adiag0[i], Adiag0[j]))
+            {
+                return(0);
+            }
+        }
+    }
+    return(1);
+}                        /* End of samefactor */
+
+
+double  pathcost(solver_t *solver, int k)
+/*
+**--------------------------------------------------------------
+** Input:   k = column of Cholesky factor
+** Output:  returns multiply-adds made by a rank-1 update
+** Purpose: counts the work of updating the columns of the
+**          factor on the elimination tree path from column k
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    double cost = 0.0;
+
+    while (k > 0)
+    {
+        cost += 2.0 * (XLNZ[k+1] - XLNZ[k] + 1);
+        k = (XLNZ[k+1] > XLNZ[k]) ? NZSUB[XLNZ[k]] : 0;
+    }
+    return cost;
+}                        /* End of pathcost */
+
+
+int  cholupdate(solver_t *solver, int i, int j, double sigma, double *w)
+/*
+**--------------------------------------------------------------
+** Input:   i, j  = rows of update vector v = e_i - e_j
+**                  (or v = e_i if j = 0)
+**          sigma = multiplier of update
+**          w     = work vector of zeros
+** Output:  returns 1 if successful, 0 if a downdate (sigma < 0)
+**          left the matrix without a Cholesky factor or left
+**          a diagonal coeff. of the factor too small (below
+**          sqrt(DOWNTOL) of its old value) to be accurate
+** Purpose: replaces the kept Cholesky factor of matrix A with
+**          that of A + sigma*v*v'
+**
+** NOTE:   Columns are updated in ascending order, following the
+**         elimination tree paths from i and j to the root; the
+**         non-zeros of L^-1*v lie only on these paths. Each
+**         column visited is left zeroed in w.
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    double *Lii = solver->Lii;
+    double *Lij = solver->Lij;
+    double s = (sigma > 0.0) ? 1.0 : -1.0;
+    double c, d, r, sn, wk, *l;
+    int    a, b, k, m, row;
+
+    w[i] = sqrt(fabs(sigma));
+    if (j > 0) w[j] = -w[i];
+    a = i;
+    b = j;
+    while (a > 0 || b > 0)
+    {
+        // Next column on either path
+        if (b == 0 || (a > 0 && a < b)) k = a;
+        else k = b;
+        wk = w[k];
+        w[k] = 0.0;
+
+        // Rotate column k of L with the update vector
+        if (wk != 0.0)
+        {
+            d = Lii[k];
+            r = d*d + s*wk*wk;
+            if (r <= DOWNTOL*d*d) return(0);
+            r = sqrt(r);
+            c = r / d;
+            sn = wk / d;
+            Lii[k] = r;
+            for (m = XLNZ[k]; m < XLNZ[k+1]; m++)
+            {
+                row = NZSUB[m];
+                l = &Lij[m];
+                *l = (*l + s*sn*w[row]) / c;
+                w[row] = c*w[row] - sn*(*l);
+            }
+        }
+
+        // Move up the tree (the parent of k is its first row)
+        m = (XLNZ[k+1] > XLNZ[k]) ? NZSUB[XLNZ[k]] : 0;
+        if (a == k) a = m;
+        if (b == k) b = m;
+    }
+    return(1);
+}                        /* End of cholupdate */
+
+
+int  mpsolve(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  solver->F = solution values
+**          returns 0 if successful, 1 if the double precision
+**          factorization should be used instead
+** Purpose: solves the linearized hydraulic equations with a
+**          single precision Cholesky factor and iterative
+**          refinement
+**
+** NOTE:   Each refinement step solves for the residual of the
+**         double precision equations, r = F - A*x, with the
+**         single precision factor and adds the result to x.
+**         Refinement stops once the correction is below MPTOL
+**         times the largest head. It fails if the factor cannot
+**         be formed, if a correction is not at least half the
+**         size of the one before it (i.e. A is too poorly
+**         conditioned for single precision), or after MPITERS
+**         steps.
+**--------------------------------------------------------------
+*/
+{
+    solver_t *solver = &pr->hydraulics.solver;
+    double *B = solver->F;
+    double *x = solver->Mpwork;
+    double *r = x + (n+1);
+    double dmax, xmax, dold = 0.0;
+    int    i, iter;
+
+    if (spfactor(solver, n) != 0) return(1);
+    memset(x, 0, (n+1)*sizeof(double));
+    memcpy(r, B, (n+1)*sizeof(double));
+    for (iter = 1; iter <= MPITERS; iter++)
+    {
+        solver->Nrefine++;
+        spsubstitute(solver, n, r);
+        dmax = 0.0;
+        xmax = 0.0;
+        for (i = 1; i <= n; i++)
+        {
+            x[i] += r[i];
+            dmax = MAX(dmax, fabs(r[i]));
+            xmax = MAX(xmax, fabs(x[i]));
+        }
+        if (dmax <= MPTOL * xmax)
+        {
+            memcpy(B, x, (n+1)*sizeof(double));
+            return(0);
+        }
+        if (iter > 1 && dmax > 0.5 * dold) break;
+        dold = dmax;
+
+        // Find the residual of the double precision equations
+        matvec(solver, n, x, r);
+        for (i = 1; i <= n; i++) r[i] = B[i] - r[i];
+    }
+    return(1);
+}                        /* End of mpsolve */
+
+
+int  spfactor(solver_t *solver, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: computes a single precision Cholesky factor of the
+**          solution matrix in Fii and Fij
+**
+** NOTE:   The factorization is that of linsolve(), carried out
+**         on float copies of Aii and Aij so that the factor
+**         moves half as much memory.
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    float  *Fii = solver->Fii;
+    float  *Fij = solver->Fij;
+    float  *temp = solver->Ftemp;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *link = solver->Link;
+    int    *first = solver->First;
+    int    i, isub, j, k, kfirst, newk;
+    float  diagj, ljk;
+
+    for (j = 1; j <= n; j++) Fii[j] = (float)Aii[j];
+    for (i = 1; i < XLNZ[n+1]; i++) Fij[i] = (float)Aij[i];
+
+    for (j = 1; j <= n; j++)
+    {
+        // Accumulate the updates from the columns k that affect j
+        diagj = 0.0f;
+        newk = link[j];
+        link[j] = 0;
+        k = newk;
+        while (k != 0)
+        {
+            newk = link[k];
+            kfirst = first[k];
+            ljk = Fij[kfirst];
+            diagj += ljk*ljk;
+            if (kfirst + 1 < XLNZ[k+1])
+            {
+                first[k] = kfirst + 1;
+                isub = NZSUB[kfirst + 1];
+                link[k] = link[isub];
+                link[isub] = k;
+                for (i = kfirst + 1; i < XLNZ[k+1]; i++)
+                {
+                    temp[NZSUB[i]] += Fij[i]*ljk;
+                }
+            }
+            else link[k] = 0;
+            k = newk;
+        }
+
+        // Apply them to column j
+        diagj = Fii[j] - diagj;
+        if (diagj <= 0.0f)
+        {
+            memset(temp, 0, (n+1)*sizeof(float));
+            memset(link, 0, (n+1)*sizeof(int));
+            return(j);
+        }
+        diagj = sqrtf(diagj);
+        Fii[j] = diagj;
+        if (XLNZ[j] < XLNZ[j+1])
+        {
+            first[j] = XLNZ[j];
+            isub = NZSUB[XLNZ[j]];
+            link[j] = link[isub];
+            link[isub] = j;
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                isub = NZSUB[i];
+                Fij[i] = (Fij[i] - temp[isub]) / diagj;
+                temp[isub] = 0.0f;
+            }
+        }
+    }
+    return(0);
+}                        /* End of spfactor */
+
+
+void  spsubstitute(solver_t *solver, int n, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          B = right hand side
+** Output:  B = solution values
+** Purpose: solves L*L'*x = B with the single precision factor
+**          (accumulating in double precision)
+**--------------------------------------------------------------
+*/
+{
+    float  *Fii = solver->Fii;
+    float  *Fij = solver->Fij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, j;
+    double bj;
+
+    for (j = 1; j <= n; j++)
+    {
+        bj = B[j] / Fii[j];
+        B[j] = bj;
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++) B[NZSUB[i]] -= Fij[i]*bj;
+    }
+    for (j = n; j >= 1; j--)
+    {
+        bj = B[j];
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++) bj -= Fij[i]*B[NZSUB[i]];
+        B[j] = bj / Fii[j];
+    }
+}                        /* End of spsubstitute */
+
+
+int  snfactor(EN_Project *pr)
+/*
+**--------------------------------------------------------------
+** Input:   none
+** Output:  returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: computes the Cholesky factor of the solution matrix
+**          one supernode at a time
+**
+** NOTE:   This is the left-looking scheme of linsolve() applied
+**         to supernodes rather than to single columns. Each
+**         supernode collects dense block updates from those
+**         supernodes that have rows among its columns (kept in
+**         linked lists through Slink/Sfirst) and then factorizes
+**         its own dense block.
+**--------------------------------------------------------------
+*/
+{
+    solver_t *solver = &pr->hydraulics.solver;
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *Lsn = solver->Lsn;
+    double *blk, *col;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *Xsuper = solver->Xsuper;
+    int    *Slink = solver->Slink;
+    int    *Sfirst = solver->Sfirst;
+    int    *Map = solver->Map;
+    int    c, d, f, i, j, k, l, p, r, s, t, nrows, ncols, next, p2;
+    double diagj;
+
+    memset(Slink, 0, (solver->Nsuper+2)*sizeof(int));
+    for (s = 1; s <= solver->Nsuper; s++)
+    {
+        f = Xsuper[s];
+        l = Xsuper[s+1] - 1;
+        ncols = l - f + 1;
+        nrows = XLNZ[f+1] - XLNZ[f] + 1;
+        blk = Lsn + solver->Xblock[s];
+
+        // Load the supernode's columns of A into its block
+        // (by the supernode property, column f+c of the factor
+        // occupies rows c, c+1, ..., nrows-1 of the block)
+        Map[f] = 0;
+        for (i = XLNZ[f]; i < XLNZ[f+1]; i++) Map[NZSUB[i]] = i - XLNZ[f] + 1;
+        for (c = 0; c < ncols; c++)
+        {
+            j = f + c;
+            col = blk + c*nrows;
+            col[c] = Aii[j];
+            r = c + 1;
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++) col[r++] = Aij[i];
+        }
+
+        // Apply the updates from each supernode d in s's list
+        d = Slink[s];
+        Slink[s] = 0;
+        while (d != 0)
+        {
+            next = Slink[d];
+            p = Sfirst[d];
+
+            // Rows p to p2-1 of d lie within the columns of s
+            t = XLNZ[Xsuper[d]] - 1;
+            p2 = p + 1;
+            while (p2 < XLNZ[Xsuper[d]+1] - t && NZSUB[t+p2] <= l) p2++;
+            snupdate(solver, d, s, p, p2);
+
+            // Move d to the list of the next supernode it updates
+            if (p2 < XLNZ[Xsuper[d]+1] - t)
+            {
+                Sfirst[d] = p2;
+                k = solver->Snode[NZSUB[t+p2]];
+                Slink[d] = Slink[k];
+                Slink[k] = d;
+            }
+            d = next;
+        }
+
+        // Factorize the supernode's dense block
+        for (c = 0; c < ncols; c++)
+        {
+            col = blk + c*nrows;
+            blockaxpy(col, blk, nrows, c, c, c, nrows);
+            diagj = col[c];
+            if (diagj <= 0.0) return(f + c);   /* Ill-conditioning */
+            diagj = sqrt(diagj);
+            col[c] = diagj;
+            for (r = c + 1; r < nrows; r++) col[r] /= diagj;
+        }
+
+        // Add s to the list of the first supernode it updates
+        if (nrows > ncols)
+        {
+            Sfirst[s] = ncols;
+            k = solver->Snode[NZSUB[XLNZ[f] + ncols - 1]];
+            Slink[s] = Slink[k];
+            Slink[k] = s;
+        }
+    }
+    return(0);
+}                        /* End of snfactor */
+
+
+void  snupdate(solver_t *solver, int d, int s, int p1, int p2)
+/*
+**--------------------------------------------------------------
+** Input:   d  = index of updating supernode
+**          s  = index of supernode being updated
+**          p1 = first row of d's block lying within s's columns
+**          p2 = first row of d's block lying below s's columns
+** Output:  none
+** Purpose: subtracts the product of rows p1 onward of d's block
+**          with the transpose of rows p1 to p2-1 from the block
+**          of supernode s
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *Map = solver->Map;
+    double *W = solver->Work;
+    double *dblk = solver->Lsn + solver->Xblock[d];
+    double *sblk = solver->Lsn + solver->Xblock[s];
+    double *w, *col;
+    int    fd = solver->Xsuper[d];
+    int    fs = solver->Xsuper[s];
+    int    dcols = solver->Xsuper[d+1] - fd;
+    int    drows = XLNZ[fd+1] - XLNZ[fd] + 1;
+    int    srows = XLNZ[fs+1] - XLNZ[fs] + 1;
+    int    m = drows - p1;
+    int    t = XLNZ[fd] - 1;
+    int    c, p, q;
+
+    // Form the dense update W = -L(p1:, :) * L(p1:p2-1, :)'
+    for (q = p1; q < p2; q++)
+    {
+        w = W + (q-p1)*m - p1;
+        memset(w + q, 0, (drows-q)*sizeof(double));
+        blockaxpy(w, dblk, drows, dcols, q, q, drows);
+    }
+
+    // Scatter W into the columns of s
+    for (q = p1; q < p2; q++)
+    {
+        c = NZSUB[t+q] - fs;
+        col = sblk + c*srows;
+        w = W + (q-p1)*m - p1;
+        for (p = q; p < drows; p++) col[Map[NZSUB[t+p]]] += w[p];
+    }
+}                        /* End of snupdate */
+
+
+void  blockaxpy(double *w, double *blk, int ldb, int ncols, int row,
+                int p1, int p2)
+/*
+**--------------------------------------------------------------
+** Input:   w     = column vector being updated
+**          blk   = dense column-major block
+**          ldb   = number of rows in blk
+**          ncols = number of columns of blk to apply
+**          row   = row of blk holding the multipliers
+**          p1,p2 = range of rows p1 to p2-1 to update
+** Output:  w     = updated column vector
+** Purpose: subtracts blk(p, k)*blk(row, k), summed over the
+**          first ncols columns k of blk, from w(p)
+**
+** NOTE:   Columns are processed four at a time so that w is
+**         swept once for every four columns of blk.
+**--------------------------------------------------------------
+*/
+{
+    double *a0, *a1, *a2, *a3;
+    double x0, x1, x2, x3;
+    int    k, p;
+
+    for (k = 0; k + 3 < ncols; k += 4)
+    {
+        a0 = blk + k*ldb;
+        a1 = a0 + ldb;
+        a2 = a1 + ldb;
+        a3 = a2 + ldb;
+        x0 = a0[row];
+        x1 = a1[row];
+        x2 = a2[row];
+        x3 = a3[row];
+        for (p = p1; p < p2; p++)
+        {
+            w[p] -= a0[p]*x0 + a1[p]*x1 + a2[p]*x2 + a3[p]*x3;
+        }
+    }
+    for (; k < ncols; k++)
+    {
+        a0 = blk + k*ldb;
+        x0 = a0[row];
+        for (p = p1; p < p2; p++) w[p] -= a0[p]*x0;
+    }
+}                        /* End of blockaxpy */
+
+
+void  snsolve(solver_t *solver, double *B)
+/*
+**--------------------------------------------------------------
+** Input:   B = right hand side vector
+** Output:  B = solution vector
+** Purpose: solves L*L'*x = B using the supernodal factor L
+**--------------------------------------------------------------
+*/
+{
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *Xsuper = solver->Xsuper;
+    double *blk, *col, bj;
+    int    c, f, r, s, t, nrows, ncols;
+
+    // Forward substitution
+    for (s = 1; s <= solver->Nsuper; s++)
+    {
+        f = Xsuper[s];
+        ncols = Xsuper[s+1] - f;
+        nrows = XLNZ[f+1] - XLNZ[f] + 1;
+        blk = solver->Lsn + solver->Xblock[s];
+        t = XLNZ[f] - 1;
+        for (c = 0; c < ncols; c++)
+        {
+            col = blk + c*nrows;
+            bj = B[f+c] / col[c];
+            B[f+c] = bj;
+            for (r = c + 1; r < nrows; r++) B[NZSUB[t+r]] -= col[r]*bj;
+        }
+    }
+
+    // Backward substitution
+    for (s = solver->Nsuper; s >= 1; s--)
+    {
+        f = Xsuper[s];
+        ncols = Xsuper[s+1] - f;
+        nrows = XLNZ[f+1] - XLNZ[f] + 1;
+        blk = solver->Lsn + solver->Xblock[s];
+        t = XLNZ[f] - 1;
+        for (c = ncols - 1; c >= 0; c--)
+        {
+            col = blk + c*nrows;
+            bj = B[f+c];
+            for (r = c + 1; r < nrows; r++) bj -= col[r]*B[NZSUB[t+r]];
+            B[f+c] = bj / col[c];
+        }
+    }
+}                        /* End of snsolve */
+
+
+int  elimtree(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of rows in solution matrix
+** Output:  returns error code
+** Purpose: builds the elimination tree of the factorized matrix
+**          and splits it into tasks for a parallel factorization
+**
+** NOTE:   The parent of column j is the row of its first
+**         off-diagonal non-zero, so a column depends only on
+**         columns in its own subtree. linsolve()'s linked lists
+**         are replayed without arithmetic to record, for each
+**         column, the columns that update it in the same order
+**         the serial code applies them. Subtrees whose work falls
+**         below a cutoff become tasks; the columns above them are
+**         factorized by whichever task finishes their last child.
+**--------------------------------------------------------------
+*/
+{
+    int    i, j, k, t, cnt, isub, istrt, istop, kfirst, newk;
+    int    errcode = 0;
+    int   *owner = NULL;
+    double *work = NULL;
+    double cutoff;
+
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t *solver = &pr->hydraulics.solver;
+    int   *XLNZ  = solver->XLNZ;
+    int   *NZSUB = solver->NZSUB;
+    int   *link  = solver->Link;
+    int   *first = solver->First;
+
+    solver->Parent  = (int *) calloc(n+1, sizeof(int));
+    solver->Nchild  = (int *) calloc(n+1, sizeof(int));
+    solver->Pending = (int *) calloc(n+1, sizeof(int));
+    solver->Bad     = (int *) calloc(n+1, sizeof(int));
+    solver->Xrow    = (int *) calloc(n+2, sizeof(int));
+    solver->RowK    = (int *) calloc(hyd->Ncoeffs+2, sizeof(int));
+    solver->RowPos  = (int *) calloc(hyd->Ncoeffs+2, sizeof(int));
+    solver->Tcols   = (int *) calloc(n+1, sizeof(int));
+    owner = (int *) calloc(n+1, sizeof(int));
+    work  = (double *) calloc(n+1, sizeof(double));
+    ERRCODE(MEMCHECK(solver->Parent));
+    ERRCODE(MEMCHECK(solver->Nchild));
+    ERRCODE(MEMCHECK(solver->Pending));
+    ERRCODE(MEMCHECK(solver->Bad));
+    ERRCODE(MEMCHECK(solver->Xrow));
+    ERRCODE(MEMCHECK(solver->RowK));
+    ERRCODE(MEMCHECK(solver->RowPos));
+    ERRCODE(MEMCHECK(solver->Tcols));
+    ERRCODE(MEMCHECK(owner));
+    ERRCODE(MEMCHECK(work));
+    if (errcode) goto ENDELIMTREE;
+
+    // Find the parent and number of children of each column
+    for (j = 1; j <= n; j++)
+    {
+        if (XLNZ[j] < XLNZ[j+1])
+        {
+            solver->Parent[j] = NZSUB[XLNZ[j]];
+            solver->Nchild[solver->Parent[j]]++;
+        }
+    }
+
+    // Replay linsolve's column lists to record the order in
+    // which columns update each column (and count the work)
+    cnt = 0;
+    for (j = 1; j <= n; j++)
+    {
+        solver->Xrow[j] = cnt + 1;
+        k = link[j];
+        link[j] = 0;
+        while (k != 0)
+        {
+            newk = link[k];
+            kfirst = first[k];
+            cnt++;
+            solver->RowK[cnt] = k;
+            solver->RowPos[cnt] = kfirst;
+            work[j] += XLNZ[k+1] - kfirst;
+            istrt = kfirst + 1;
+            istop = XLNZ[k+1] - 1;
+            if (istop >= istrt)
+            {
+                first[k] = istrt;
+                isub = NZSUB[istrt];
+                link[k] = link[isub];
+                link[isub] = k;
+            }
+            else link[k] = 0;
+            k = newk;
+        }
+        istrt = XLNZ[j];
+        istop = XLNZ[j+1] - 1;
+        if (istop >= istrt)
+        {
+            first[j] = istrt;
+            isub = NZSUB[istrt];
+            link[j] = link[isub];
+            link[isub] = j;
+        }
+        work[j] += 1.0 + istop - istrt + 1;
+    }
+    solver->Xrow[n+1] = cnt + 1;
+
+    // Accumulate the work of each subtree (children precede parents)
+    cutoff = 0.0;
+    for (j = 1; j <= n; j++)
+    {
+        if (solver->Parent[j] > 0) work[solver->Parent[j]] += work[j];
+        else cutoff += work[j];
+    }
+    cutoff /= 8.0 * solver->Nthreads;
+
+    // Assign each column to the task rooted at its highest ancestor
+    // whose subtree work is below the cutoff (0 if there is none,
+    // unless the column is a leaf which then forms its own task)
+    solver->Ntasks = 0;
+    for (j = n; j >= 1; j--)
+    {
+        k = solver->Parent[j];
+        if (work[j] > cutoff && solver->Nchild[j] > 0) owner[j] = 0;
+        else if (k == 0 || owner[k] == 0)
+        {
+            solver->Ntasks++;
+            owner[j] = j;
+        }
+        else owner[j] = owner[k];
+    }
+
+    // List each task's columns in ascending order
+    solver->Xtask = (int *) calloc(solver->Ntasks+2, sizeof(int));
+    ERRCODE(MEMCHECK(solver->Xtask));
+    if (errcode) goto ENDELIMTREE;
+    t = 0;
+    for (j = 1; j <= n; j++)
+    {
+        if (owner[j] == j) solver->Pending[j] = ++t;
+    }
+    for (j = 1; j <= n; j++)
+    {
+        if (owner[j] > 0) solver->Xtask[solver->Pending[owner[j]]+1]++;
+    }
+    solver->Xtask[1] = 0;
+    for (t = 1; t <= solver->Ntasks; t++)
+    {
+        solver->Xtask[t+1] += solver->Xtask[t];
+    }
+    memset(solver->Bad, 0, (n+1)*sizeof(int));
+    for (j = 1; j <= n; j++)
+    {
+        if (owner[j] == 0) continue;
+        t = solver->Pending[owner[j]];
+        i = solver->Xtask[t] + solver->Bad[t];
+        solver->Tcols[i] = j;
+        solver->Bad[t]++;
+    }
+    memset(solver->Bad, 0, (n+1)*sizeof(int));
+    memset(solver->Pending, 0, (n+1)*sizeof(int));
+
+ENDELIMTREE:
+    FREE(owner);
+    FREE(work);
+    return(errcode);
+}                        /* End of elimtree */
+
+
+int  etfactor(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: computes the Cholesky factor of the solution matrix
+**          by factorizing independent subtrees of its
+**          elimination tree concurrently
+**
+** NOTE:   A column found to be ill-conditioned marks all of its
+**         ancestors as unfactorizable, but other subtrees are
+**         still completed so that the lowest failing column is
+**         reported, as it is by the serial code.
+**--------------------------------------------------------------
+*/
+{
+    solver_t *solver = &pr->hydraulics.solver;
+    int  t;
+    int  errcode = 0;
+
+    memcpy(solver->Pending, solver->Nchild, (n+1)*sizeof(int));
+    memset(solver->Bad, 0, (n+1)*sizeof(int));
+
+#if defined(_OPENMP) && _OPENMP >= 201107
+    #pragma omp parallel num_threads(solver->Nthreads)
+    {
+        #pragma omp single
+        {
+            for (t = 1; t <= solver->Ntasks; t++)
+            {
+                #pragma omp task firstprivate(t)
+                ettask(solver, n, t, &errcode);
+            }
+        }
+    }
+#else
+    for (t = 1; t <= solver->Ntasks; t++) ettask(solver, n, t, &errcode);
+#endif
+    return(errcode);
+}                        /* End of etfactor */
+
+
+void  ettask(solver_t *solver, int n, int t, int *errcode)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          t = index of task
+** Output:  errcode = lowest index of an ill-conditioned column
+** Purpose: factorizes the columns of a subtree task and then
+**          any ancestors for which it supplies the last child
+**--------------------------------------------------------------
+*/
+{
+    double *temp = solver->Temp;
+    int    *Parent = solver->Parent;
+    int    *Bad = solver->Bad;
+    int    i, j, p, left, err;
+
+#if defined(_OPENMP) && _OPENMP >= 201107
+    temp += (size_t)omp_get_thread_num() * (n+1);
+#endif
+
+    i = solver->Xtask[t];
+    j = solver->Tcols[i];
+    for (;;)
+    {
+        // Factorize column j unless a descendant failed
+        p = Parent[j];
+        err = Bad[j];
+        if (!err && factorcolumn(solver, j, temp) > 0)
+        {
+            err = 1;
+#if defined(_OPENMP) && _OPENMP >= 201107
+            #pragma omp critical
+#endif
+            if (*errcode == 0 || j < *errcode) *errcode = j;
+        }
+        if (err && p > 0)
+        {
+#if defined(_OPENMP) && _OPENMP >= 201107
+            #pragma omp atomic write
+#endif
+            Bad[p] = 1;
+        }
+
+        // Move to the task's next column
+        i++;
+        if (i < solver->Xtask[t+1])
+        {
+            j = solver->Tcols[i];
+            continue;
+        }
+
+        // Move to the parent column if all of its children are done
+        if (p == 0) break;
+#if defined(_OPENMP) && _OPENMP >= 201107
+        #pragma omp flush
+        #pragma omp atomic capture
+        left = --solver->Pending[p];
+        #pragma omp flush
+#else
+        left = --solver->Pending[p];
+#endif
+        if (left > 0) break;
+        j = p;
+    }
+}                        /* End of ettask */
+
+
+int  factorcolumn(solver_t *solver, int j, double *temp)
+/*
+**--------------------------------------------------------------
+** Input:   j    = index of column
+**          temp = zeroed work vector
+** Output:  returns 0 if successful or j if column j is
+**          ill-conditioned (temp is left zeroed in either case)
+** Purpose: computes column j of the Cholesky factor from those
+**          columns already computed, exactly as linsolve() does
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, r, k, kfirst, istop, isub;
+    double diagj, ljk;
+
+    diagj = 0.0;
+    for (r = solver->Xrow[j]; r < solver->Xrow[j+1]; r++)
+    {
+        k = solver->RowK[r];
+        kfirst = solver->RowPos[r];
+        ljk = Aij[kfirst];
+        diagj += ljk*ljk;
+        istop = XLNZ[k+1] - 1;
+        for (i = kfirst + 1; i <= istop; i++)
+        {
+            isub = NZSUB[i];
+            temp[isub] += Aij[i]*ljk;
+        }
+    }
+    diagj = Aii[j] - diagj;
+    if (diagj <= 0.0)
+    {
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++) temp[NZSUB[i]] = 0.0;
+        return(j);
+    }
+    diagj = sqrt(diagj);
+    Aii[j] = diagj;
+    for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+    {
+        isub = NZSUB[i];
+        Aij[i] = (Aij[i] - temp[isub])/diagj;
+        temp[isub] = 0.0;
+    }
+    return(0);
+}                        /* End of factorcolumn */
+
+
+int  pcgsolve(EN_Project *pr, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  solver->F = solution values
+**          returns 0 if solution found, or index of
+**          equation causing system to be ill-conditioned
+** Purpose: solves the linearized system of hydraulic equations
+**          by conjugate gradients preconditioned with an
+**          incomplete Cholesky factor
+**
+** NOTE:   The iterations start from the current nodal heads
+**         and stop once the total nodal flow imbalance falls
+**         below PCGTOL*Hacc times the total link flow. This keeps
+**         the error of each step well inside the flow-change
+**         tolerance that hydsolve() converges to.
+**         Rounding can take the iterations a little past the n
+**         that exact arithmetic needs, so 2n are allowed unless
+**         PcgLimit sets another limit. If they stop short of the
+**         tolerance (at the limit, or because rounding has made
+**         the search direction's curvature non-positive) the
+**         equation with the largest imbalance is returned as
+**         ill-conditioned and F is left unchanged.
+**--------------------------------------------------------------
+*/
+{
+    hydraulics_t *hyd = &pr->hydraulics;
+    solver_t     *solver = &pr->hydraulics.solver;
+    double *B = solver->F;
+    double *x = solver->Cgwork;
+    double *r = x + (n+1);
+    double *z = r + (n+1);
+    double *p = z + (n+1);
+    double *q = p + (n+1);
+    int    j, k, iter, maxiter, errcode;
+    double alpha, beta, rz, rznew, pq, rr, tol;
+
+    // Build the preconditioner
+    errcode = icfactor(solver, n);
+    if (errcode) return(errcode);
+
+    // Initial residual from the current heads
+    for (j = 1; j <= n; j++) x[j] = hyd->NodeHead[solver->Order[j]];
+    matvec(solver, n, x, q);
+    rr = 0.0;
+    for (j = 1; j <= n; j++)
+    {
+        r[j] = B[j] - q[j];
+        rr += fabs(r[j]);
+    }
+    icsolve(solver, n, r, z);
+    rz = 0.0;
+    for (j = 1; j <= n; j++)
+    {
+        p[j] = z[j];
+        rz += r[j]*z[j];
+    }
+
+    // Residuals are flow imbalances so they are compared to the
+    // total link flow (as hydsolve() compares flow changes)
+    tol = 0.0;
+    for (k = 1; k <= pr->network.Nlinks; k++) tol += fabs(hyd->LinkFlows[k]);
+    tol *= PCGTOL * hyd->Hacc;
+
+    // Conjugate gradient iterations
+    maxiter = hyd->PcgLimit > 0 ? hyd->PcgLimit : 2*n;
+    for (iter = 0; iter < maxiter && rr > tol; iter++)
+    {
+        matvec(solver, n, p, q);
+        pq = 0.0;
+        for (j = 1; j <= n; j++) pq += p[j]*q[j];
+        if (pq <= 0.0) break;
+        alpha = rz / pq;
+        rr = 0.0;
+        for (j = 1; j <= n; j++)
+        {
+            x[j] += alpha*p[j];
+            r[j] -= alpha*q[j];
+            rr += fabs(r[j]);
+        }
+        icsolve(solver, n, r, z);
+        rznew = 0.0;
+        for (j = 1; j <= n; j++) rznew += r[j]*z[j];
+        beta = rznew / rz;
+        rz = rznew;
+        for (j = 1; j <= n; j++) p[j] = z[j] + beta*p[j];
+    }
+    solver->Cgiter += iter;
+
+    // Report the worst balanced equation if the tolerance was not met
+    if (rr > tol)
+    {
+        k = 1;
+        for (j = 2; j <= n; j++)
+        {
+            if (fabs(r[j]) > fabs(r[k])) k = j;
+        }
+        return(k);
+    }
+    for (j = 1; j <= n; j++) B[j] = x[j];
+    return(0);
+}                        /* End of pcgsolve */
+
+
+int  icfactor(solver_t *solver, int n)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+** Output:  returns 0 if successful, or index of equation
+**          causing system to be ill-conditioned
+** Purpose: computes an incomplete Cholesky factor of the
+**          solution matrix with no fill-in (IC(0))
+**
+** NOTE:   Updates that would fall outside of the matrix's own
+**         non-zeros are dropped. The hydraulic matrix is an
+**         M-matrix for which IC(0) exists in exact arithmetic;
+**         should it still break down the diagonal is enlarged
+**         by an increasing relative shift and the factor retried.
+**         Link is used to locate rows and is left zeroed.
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    double *Lic = solver->Lic;
+    double *Dic = solver->Dic;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    *pos = solver->Link;
+    int    i, j, k, m, row, tries;
+    double d, lij, shift = 0.0;
+
+    for (tries = 0; tries <= ICTRIES; tries++)
+    {
+        for (j = 1; j <= n; j++) Dic[j] = Aii[j] * (1.0 + shift);
+        for (i = 1; i < XLNZ[n+1]; i++) Lic[i] = Aij[i];
+
+        // Compute column j and update the columns to its right
+        for (j = 1; j <= n; j++)
+        {
+            if (Dic[j] <= 0.0) break;
+            d = sqrt(Dic[j]);
+            Dic[j] = d;
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++) Lic[i] /= d;
+            for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+            {
+                row = NZSUB[i];
+                lij = Lic[i];
+                Dic[row] -= lij*lij;
+                if (i + 1 == XLNZ[j+1]) continue;
+                for (k = XLNZ[row]; k < XLNZ[row+1]; k++) pos[NZSUB[k]] = k;
+                for (m = i + 1; m < XLNZ[j+1]; m++)
+                {
+                    k = pos[NZSUB[m]];
+                    if (k > 0) Lic[k] -= Lic[m]*lij;
+                }
+                for (k = XLNZ[row]; k < XLNZ[row+1]; k++) pos[NZSUB[k]] = 0;
+            }
+        }
+        if (j > n) return(0);
+        shift = (tries == 0) ? ICSHIFT : 2.0*shift;
+    }
+    return(j);
+}                        /* End of icfactor */
+
+
+void  icsolve(solver_t *solver, int n, double *r, double *z)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          r = residual vector
+** Output:  z = preconditioned residual
+** Purpose: solves L*L'*z = r with the incomplete Cholesky factor
+**--------------------------------------------------------------
+*/
+{
+    double *Lic = solver->Lic;
+    double *Dic = solver->Dic;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, j;
+    double zj;
+
+    for (j = 1; j <= n; j++) z[j] = r[j];
+
+    // Forward substitution
+    for (j = 1; j <= n; j++)
+    {
+        zj = z[j] / Dic[j];
+        z[j] = zj;
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++) z[NZSUB[i]] -= Lic[i]*zj;
+    }
+
+    // Backward substitution
+    for (j = n; j >= 1; j--)
+    {
+        zj = z[j];
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++) zj -= Lic[i]*z[NZSUB[i]];
+        z[j] = zj / Dic[j];
+    }
+}                        /* End of icsolve */
+
+
+void  matvec(solver_t *solver, int n, double *x, double *y)
+/*
+**--------------------------------------------------------------
+** Input:   n = number of equations
+**          x = vector
+** Output:  y = A*x
+** Purpose: multiplies a vector by the solution matrix
+**--------------------------------------------------------------
+*/
+{
+    double *Aii = solver->Aii;
+    double *Aij = solver->Aij;
+    int    *XLNZ = solver->XLNZ;
+    int    *NZSUB = solver->NZSUB;
+    int    i, j, row;
+    double a, yj;
+
+    for (j = 1; j <= n; j++) y[j] = Aii[j]*x[j];
+    for (j = 1; j <= n; j++)
+    {
+        yj = y[j];
+        for (i = XLNZ[j]; i < XLNZ[j+1]; i++)
+        {
+            row = NZSUB[i];
+            a = Aij[i];
+            yj += a*x[row];
+            y[row] += a*x[j];
+        }
+        y[j] = yj;
+    }
+}                        /* End of matvec */
 
 
 /************************ END OF SMATRIX.C ************************/
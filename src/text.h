@@ -151,6 +151,10 @@ AUTHOR:     L. Rossman
 #define   w_REQUIRED    "REQ"
 #define   w_EXPONENT    "EXP"
 
+#define   w_MMD         "MMD"
+#define   w_ND          "ND"
+#define   w_AMD         "AMD"
+
 #define   w_SECONDS     "SEC"
 #define   w_MINUTES     "MIN"
 #define   w_HOURS       "HOU"
@@ -411,7 +415,9 @@ AUTHOR:     L. Rossman
 #define FMT55  "%10s: %s %s changed by timer control"
 #define FMT56  "            %s %s setting changed to %-.2f"
 #define FMT57  "            %s %s switched from %s to %s"
+#define FMT57a "            %s %s held at its status after %d reversals"
 #define FMT58  "%10s: Balanced after %-d trials"
+#define FMT58a "%10s: Balanced by a cached solution"
 #define FMT59  "%10s: Unbalanced after %-d trials (flow change = %-.6f)"
 
 #define FMT60a "            Max. flow imbalance is %.4f %s at Node %s"         
@@ -428,6 +434,9 @@ AUTHOR:     L. Rossman
 #define FMT67  "                      maximum  flow change = %.4f for Node %s"
 #define FMT68  "                      maximum  head error  = %.4f for Link %s\n"
 
+#define FMT69  "Matrix Re-orderings:"
+#define FMT70  "    %-4s %10d non-zeros %16.0f flops%s"
+
 /* -------------------- Energy Report Table ------------------- */
 #define FMT71  "Energy Usage:"
 #define FMT72  \
@@ -53,6 +53,7 @@ typedef  int          INT4;
 #define   MAXLINE   1024     /* Max. # characters read from input line */
 #define   MAXFNAME  259      /* Max. # characters in file name         */
 #define   MAXTOKS   40       /* Max. items per line of input           */
+#define   MAXTHREADS 256     /* Max. # threads factorizing the matrix  */
 #define   TZERO     1.E-4    /* Zero time tolerance                    */
 #define   TRUE      1
 #define   FALSE     0
@@ -329,6 +330,24 @@ typedef enum {
     PDA         // Pressure Driven Analysis
 } DemandModelType;
 
+typedef enum {
+    CHOLESKY,   // Column-by-column sparse Cholesky
+    SUPERNODAL, // Supernodal (dense block) sparse Cholesky
+    PCG,        // Incomplete Cholesky preconditioned conj. gradient
+    SCHUR       // Subdomains in parallel, separator by Schur complement
+} LinSolverType;
+
+typedef enum {
+    MMD,        // Multiple minimum degree
+    ND,         // Nested dissection
+    AMD         // Approximate minimum degree
+} OrderingType;
+
+typedef enum {
+    GGA,        // Global gradient algorithm on nodal heads
+    NULLSPACE   // Newton method on the loop flows of a spanning tree
+} HydEngineType;
+
 /*
 ------------------------------------------------------
    Global Data Structures
@@ -777,7 +796,27 @@ typedef struct {
   *Aij,        /* Non-zero, off-diagonal coeffs. of A */
   *F,          /* Right hand side coeffs.             */
   *P,          /* Inverse headloss derivatives        */
-  *Y;          /* Flow correction factors             */
+  *Y,          /* Flow correction factors             */
+  *Temp,       /* Factorization work vector           */
+  *Lsn,        /* Dense blocks of supernodal factor   */
+  *Work,       /* Supernodal update work array        */
+  *Lic,        /* Incomplete Cholesky factor (PCG)    */
+  *Dic,        /* Incomplete Cholesky diagonal (PCG)  */
+  *Cgwork,     /* Conjugate gradient work vectors     */
+  *Adiag0,     /* Diagonal of A when last factorized  */
+  *Lii,        /* Diagonal of kept Cholesky factor    */
+  *Lij,        /* Off-diagonal of kept Cholesky factor */
+  *Aij0,       /* Off-diagonal of A of kept factor    */
+  *Resid,      /* Chord step work vectors             */
+  *Mpwork,     /* Iterative refinement work vectors   */
+  *Upd,        /* Separator updates of each subdomain */
+  *Ywork,      /* Separator sums of each subdomain    */
+  *Sdense;     /* Dense Schur complement and factor   */
+
+  float
+  *Fii,        /* Diagonal of single precision factor */
+  *Fij,        /* Off-diagonal of single prec. factor */
+  *Ftemp;      /* Single precision factorization work */
 
   int
   *Order,      /* Node-to-row of A                    */
@@ -785,10 +824,211 @@ typedef struct {
   *Ndx,        /* Index of link's coeff. in Aij       */
   *XLNZ,       /* Start position of each column in NZSUB  */
   *NZSUB,      /* Row index of each coeff. in each column */
-  *LNZ,        /* Position of each coeff. in Aij array    */
-  *Degree;     /* Number of links adjacent to each node  */
+  *LNZ,        /* Position of each coeff. in Aij (set-up only) */
+  *Degree,     /* Number of links adjacent to each node  */
+  *Link,       /* Factorization work vector (column lists)   */
+  *First,      /* Factorization work vector (column starts)  */
+  *Xsuper,     /* First column of each supernode             */
+  *Snode,      /* Supernode containing each column           */
+  *Xblock,     /* Start of each supernode's block in Lsn     */
+  *Slink,      /* Supernodal work vector (supernode lists)   */
+  *Sfirst,     /* Supernodal work vector (block row starts)  */
+  *Map,        /* Supernodal work vector (row to block row)  */
+  *Parent,     /* Parent of each column in elimination tree  */
+  *Nchild,     /* Number of children of each column in tree  */
+  *Pending,    /* Parallel work vector (unfactored children) */
+  *Bad,        /* Parallel work vector (failed descendants)  */
+  *Xrow,       /* Start of each column's updates in RowK     */
+  *RowK,       /* Columns that update each column, in order  */
+  *RowPos,     /* Position in NZSUB of each such update      */
+  *Xtask,      /* Start of each task's columns in Tcols      */
+  *Tcols,      /* Columns factorized by each parallel task   */
+  *Xfill,      /* Position in Aij of coeff. joining the two
+                  neighbours of each series row              */
+  *NodeBlock,  /* Independent block containing each node     */
+  *LinkBlock,  /* Independent block containing each link     */
+  *Xbrow,      /* First core row of each independent block   */
+  *Xdom,       /* First core row of each subdomain (and of
+                  the separator after the last one)          */
+  *Xif,        /* Start of each subdomain's rows in Ifrows   */
+  *Ifrows,     /* Separator rows joined to each subdomain    */
+  *Ifloc,      /* Position in its subdomain's Ifrows of each
+                  subdomain coeff. in a separator row        */
+  *Xupd;       /* Start of each subdomain's updates in Upd   */
+
+  char
+  *Frozen;     /* TRUE for each block held at its solution   */
+
+  double
+  *Bqsum,      /* Total flow of each block in last trial     */
+  *Bdqsum;     /* Total flow change of each block            */
+
+  int
+  Ncore,       /* Number of rows of the network's looped core */
+  Nblocks,     /* Number of hydraulically independent blocks */
+  Nfrozen,     /* Number of blocks held at their solution    */
+  Ndomains,    /* Number of subdomains of the Schur solver   */
+  Nsep,        /* Number of separator rows of the Schur solver */
+  Nsuper,      /* Number of supernodes                       */
+  Nwork,       /* Size of supernodal update work array       */
+  Nthreads,    /* Number of factorization threads            */
+  Ntasks,      /* Number of independent subtree tasks        */
+  Cgiter,      /* Conjugate gradient iterations of solution  */
+  Nfactor,     /* Numerical factorizations of solution       */
+  Nupdate,     /* Rank-1 updates of kept factor in solution  */
+  Nrefine,     /* Iterative refinement steps of solution     */
+  Mpfail,      /* TRUE if refinement failed in solution      */
+  Chord,       /* TRUE if a factor is kept for chord steps   */
+  Chordstep,   /* TRUE if last solution used the kept factor */
+  Refactor;    /* TRUE if matrix must be factorized again    */
+
+  double
+  Flops;       /* Predicted flops to factorize the matrix    */
 } solver_t;
 
+/*
+ ** Contiguous copies of the link data read on every trial of the
+ ** hydraulic solution, so that the coeffs. of all pipes are found by
+ ** a single branch-free loop that streams only the data it needs
+ ** instead of the full link records, and lists of the only links
+ ** whose status can change (see loadlinkarrays() in HYDCOEFFS.C).
+ */
+typedef struct {
+  int
+  *N1,         /* Start node of each link                    */
+  *N2,         /* End node of each link                      */
+  *Pipe,       /* Link index of each pipe                    */
+  *Other,      /* Link index of each pump and valve          */
+  *Checked,    /* Links checked by linkstatus()              */
+  *Pvalves;    /* PRVs & PSVs checked by valvestatus()       */
+
+  double
+  *R,          /* Resistance coeff. of each pipe             */
+  *Km,         /* Minor loss coeff. of each pipe             */
+  *Qa,         /* Low flow limit of each pipe                */
+  *Erel,       /* Relative roughness of each pipe (D-W)      */
+  *Vd,         /* Viscosity times diameter of each pipe (D-W) */
+  *Q,          /* Flow of each pipe (SIMD kernels only)      */
+  *Pp,         /* P coeff. of each pipe (SIMD kernels only)  */
+  *Yp;         /* Y coeff. of each pipe (SIMD kernels only)  */
+
+  int
+  Npipes,      /* Number of pipes (incl. those with a CV)    */
+  Nother,      /* Number of pumps and valves                 */
+  Nchecked,    /* Number of links in Checked                 */
+  Npvalves,    /* Number of valves in Pvalves                */
+  Width;       /* SIMD width used for pipe coeffs. (1 = none) */
+} linkarrays_t;
+
+/*
+** Hydraulic kernels chosen by setkernels() (see HYDCOEFFS.C) for
+** the head loss formula, demand model and emitters of a run, so that
+** the loops that find the matrix coeffs. never test for them.
+*/
+struct EN_Project;
+typedef struct {
+  void (*Pipecoeffs)(struct EN_Project *, int, int); /* Coeffs. of pipes    */
+  void (*Pipecoeff)(struct EN_Project *, int);       /* Coeffs. of one pipe */
+  void (*Emittercoeffs)(struct EN_Project *);        /* Emitter coeffs.     */
+  void (*Demandcoeffs)(struct EN_Project *);         /* PDA demand coeffs.  */
+  void (*Junctioncoeffs)(struct EN_Project *);       /* Junction coeffs.    */
+
+  int
+  *Emitter,    /* Index of each junction with an emitter     */
+  Nemitters;   /* Number of junctions with an emitter        */
+} kernels_t;
+
+/*
+** Solutions at past demand levels used to predict the flows that
+** start the solution of the next time period (see predictflows()
+** in HYDRAUL.C).
+*/
+typedef struct {
+  double
+  *Q[3],       /* Link flows of last 3 solutions (0 = latest)    */
+  *E[3],       /* Emitter flows of last 3 solutions              */
+  D[3],        /* Total junction demand of last 3 solutions      */
+  Dnow,        /* Total junction demand of current period        */
+  Saved;       /* Estimated trials saved in last period          */
+
+  StatType
+  *Stat;       /* Status of each link in latest solution         */
+
+  char
+  *Nsame;      /* Solutions in a row with link's latest status   */
+
+  int
+  Nsaved,      /* Number of solutions saved (up to 3)            */
+  Predicted,   /* TRUE if flows of current period were predicted */
+  Trials,      /* Trials of periods that were not predicted      */
+  Periods;     /* Number of periods that were not predicted      */
+} predictor_t;
+
+/*
+** Solutions of past time periods kept for reuse by later periods
+** with the same demands, link statuses and settings and tank
+** levels (see HYDCACHE.C).
+*/
+typedef struct {
+  unsigned int
+  *Key;        /* Signature of the demands & link states of each entry */
+
+  double
+  *X;          /* Inputs and solution of each entry (Nx per entry) */
+
+  StatType
+  *S;          /* Link statuses before and after each entry's solution */
+
+  char
+  *Used;       /* TRUE if an entry holds a solution                */
+
+  int
+  Size,        /* Number of entries                                */
+  Nx,          /* Values held in X for each entry                  */
+  Slot,        /* Entry of the current period                      */
+  Reused,      /* TRUE if the current period's solution was cached */
+  Lookups,     /* Time periods looked up in the cache              */
+  Hits,        /* Periods whose solution was taken from the cache  */
+  Starts;      /* Periods started from a cached solution           */
+} cache_t;
+
+/*
+ ** Null-space (loop flow) engine: the junctions plus a ground node
+ ** (0) standing for all nodes of known head form a graph whose edges
+ ** are the links between junctions and the ground coeffs. of each
+ ** junction. Heads follow from the flows in a spanning tree of this
+ ** graph once the flows in its co-tree edges (one per loop) are known.
+ */
+typedef struct {
+  int
+  *Ea,         /* Start junction of each edge                */
+  *Eb,         /* End junction (0 = ground) of each edge     */
+  *Esort,      /* Edges in order of decreasing conductance   */
+  *Set,        /* Union-find parent of each junction         */
+  *Xtree,      /* Start of each junction's edges in Tree     */
+  *Tree,       /* Spanning tree edges adjacent to each junction */
+  *Parent,     /* Parent junction of each junction in tree   */
+  *Pedge,      /* Edge joining each junction to its parent   */
+  *Border,     /* Junctions in breadth-first order from ground */
+  *Cotree;     /* Co-tree edge closing each loop             */
+
+  double
+  *G,          /* Conductance of each edge                   */
+  *G0,         /* Conductance when spanning tree was found   */
+  *Cur,        /* Flow from each junction to its parent      */
+  *Head,       /* Head of each junction                      */
+  *M,          /* Dense loop matrix and its Cholesky factor  */
+  *Xloop;      /* Head mismatch, then flow, of each loop     */
+
+  int
+  Nedges,      /* Number of edges in last solution           */
+  Nloops,      /* Number of loops in last solution           */
+  Treeok;      /* Spanning tree fits the current edges       */
+
+  size_t
+  Mcap;        /* Allocated size of loop matrix              */
+} loops_t;
+
 typedef struct {
   double
   *NodeDemand,           // Node actual total outflow
@@ -810,6 +1050,8 @@ typedef struct {
   Hacc,                  /* Hydraulics solution accuracy */
   FlowChangeLimit,       /* Hydraulics flow change limit */
   HeadErrorLimit,        /* Hydraulics head error limit  */
+  ChordTol,              // Matrix change allowed in chord steps
+  CacheTol,              // Tank head change allowed in a cached solution
 
   DampLimit,             /* Solution damping threshold   */
   Viscos,                /* Kin. viscosity (sq ft/sec)   */
@@ -824,7 +1066,22 @@ typedef struct {
   int
   DefPat,                /* Default demand pattern       */
   Epat,                  /* Energy cost time pattern     */
-  DemandModel;           // Fixed or pressure dependent
+  DemandModel,           // Fixed or pressure dependent
+  LinSolver,             // Linear equation solver
+  Threads,               // Threads used to factorize matrix
+  Ordering,              // Re-ordering of solution matrix
+  MixedPrec,             // Single precision factor if TRUE
+  Skeletonize,           // Series junctions solved outside matrix if TRUE
+  BlockSolve,            // Converged blocks held fixed if TRUE
+  Subdomains,            // Subdomains of the Schur complement solver
+  Engine,                // Hydraulic solution engine
+  Simd,                  // Use SIMD kernels for pipe coeffs.
+  Predictor,             // Order of flow predictor (0 = none)
+  StepControl,           // Flow steps adapted to convergence if TRUE
+  FlipLimit,             // Status reversals before a link is held (0 = none)
+  PcgLimit,              // PCG iterations allowed per trial (0 = 2n)
+  StatusLists,           // Status checked only where it can change if TRUE
+  CacheSize;             // Solutions kept in the solution cache (0 = none)
 
   StatType
   *LinkStatus,           /* Link status                  */
@@ -851,8 +1108,23 @@ typedef struct {
   int Haltflag;
   /* Relaxation factor used for updating flow changes */
   double RelaxFactor;
-
-  solver_t solver;
+  /* Fraction of the full flow step taken with step control */
+  double StepSize;
+  int    StepCuts;
+  /* Status reversals of each link, the status it last changed from,
+     whether it is held at its status and the number of times links
+     were held in a solution (see holdstatus() in HYDSTATUS.C) */
+  int      *Flips;
+  StatType *PrevStat;
+  char     *Held;
+  int      HeldLinks;
+
+  solver_t     solver;
+  loops_t      loops;
+  linkarrays_t links;
+  kernels_t    kernels;
+  predictor_t  predictor;
+  cache_t      cache;
 
 } hydraulics_t;
 
@@ -0,0 +1,955 @@
+//
+// test_solver_options.cpp
+//
+
+/*
+These are tests for the hydraulic solver options. A network is solved with
+an alternative solver setting and its heads and flows are compared to those
+found with the default settings over an extended period simulation.
+*/
+
+#define BOOST_TEST_MODULE "toolkit"
+#include <boost/test/included/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include "epanet2.h"
+
+// NOTE: Project Home needs to be updated to run unit test
+#define DATA_PATH_INP "./example_0.inp"
+#define DATA_PATH_NET1 "./net1.inp"
+#define DATA_PATH_CONTROLS "./valve_controls.inp"
+#define DATA_PATH_GRID "./valve_grid.inp"
+#define DATA_PATH_RPT "./test.rpt"
+#define DATA_PATH_OUT "./test.out"
+
+using namespace std;
+
+typedef vector< pair<int, double> > Options;
+typedef map<int, double> Totals;
+
+// Runs an extended period hydraulic analysis of a network with the given
+// options and returns the node heads and link flows of each time period.
+// If a link is named it is closed after the first period, and the rank-1
+// factor updates made in the remaining periods are counted. Each analysis
+// statistic entered in totals is added up over the time periods. A
+// duration (in seconds) replaces that of the input file if given.
+int run_analysis(const char *inpfile, const Options& options,
+    vector<float>& results, const char *closed, int *updates,
+    Totals *totals, long duration)
+{
+    EN_ProjectHandle ph;
+    int error, i, nnodes, nlinks, index;
+    long t, tstep;
+    EN_API_FLOAT_TYPE v;
+    Totals::iterator it;
+
+    results.clear();
+    if (updates) *updates = 0;
+    if (totals) {
+        for (it = totals->begin(); it != totals->end(); ++it) it->second = 0.0;
+    }
+    EN_createproject(&ph);
+    error = EN_open(ph, inpfile, DATA_PATH_RPT, DATA_PATH_OUT);
+    for (i = 0; !error && i < (int)options.size(); i++)
+        error = EN_setoption(ph, options[i].first, options[i].second);
+    if (!error && duration > 0)
+        error = EN_settimeparam(ph, EN_DURATION, duration);
+    if (!error) error = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+    if (!error) error = EN_getcount(ph, EN_LINKCOUNT, &nlinks);
+    if (!error) error = EN_openH(ph);
+    if (!error) error = EN_initH(ph, 0);
+    while (!error) {
+        error = EN_runH(ph, &t);
+        for (i = 1; !error && i <= nnodes; i++) {
+            error = EN_getnodevalue(ph, i, EN_HEAD, &v);
+            results.push_back(v);
+        }
+        for (i = 1; !error && i <= nlinks; i++) {
+            error = EN_getlinkvalue(ph, i, EN_FLOW, &v);
+            results.push_back(v);
+        }
+        if (!error && totals) {
+            for (it = totals->begin(); !error && it != totals->end(); ++it) {
+                error = EN_getstatistic(ph, it->first, &v);
+                it->second += v;
+            }
+        }
+        if (!error && closed && t > 0) {
+            error = EN_getstatistic(ph, EN_FACTORUPDATES, &v);
+            if (updates) *updates += (int)v;
+        }
+        if (!error && closed && t == 0) {
+            error = EN_getlinkindex(ph, (char *)closed, &index);
+            if (!error) error = EN_setlinkvalue(ph, index, EN_STATUS, 0);
+        }
+        if (!error) error = EN_nextH(ph, &tstep);
+        if (tstep <= 0) break;
+    }
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+    return error;
+}
+
+// Runs an analysis of the test network (see run_analysis())
+int run_hydraulics(const Options& options, vector<float>& results,
+    const char *closed = NULL, int *updates = NULL, long duration = 0)
+{
+    return run_analysis(DATA_PATH_INP, options, results, closed, updates,
+        NULL, duration);
+}
+
+// Runs an analysis of a network, adding up the statistics in totals
+int run_totals(const char *inpfile, const Options& options,
+    vector<float>& results, Totals& totals, long duration = 0)
+{
+    return run_analysis(inpfile, options, results, NULL, NULL, &totals,
+        duration);
+}
+
+// Checks that two sets of results agree to within a tolerance
+boost::test_tools::predicate_result check_results(const vector<float>& test,
+    const vector<float>& ref, double tol)
+{
+    if (test.size() != ref.size()) return false;
+    for (size_t i = 0; i < ref.size(); i++) {
+        if (fabs(test[i] - ref[i]) > tol * (1.0 + fabs(ref[i]))) return false;
+    }
+    return true;
+}
+
+struct Fixture {
+    Fixture() {
+        error = run_hydraulics(Options(), reference);
+    }
+
+    int error;
+    vector<float> reference;
+};
+
+BOOST_AUTO_TEST_SUITE(test_solver_options)
+
+BOOST_FIXTURE_TEST_CASE(test_supernodal, Fixture)
+{
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    options.push_back(make_pair((int)EN_LINSOLVER, (double)EN_SUPERNODAL));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_pcg, Fixture)
+{
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    // The iterative solver only converges to within the accuracy limit
+    options.push_back(make_pair((int)EN_LINSOLVER, (double)EN_PCG));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-2));
+}
+
+BOOST_AUTO_TEST_CASE(test_pcg_limit)
+{
+    vector<float> results;
+    Options options;
+    int error;
+
+    // Iterations stopped short of the tolerance leave the equations
+    // unsolved instead of passing on an inaccurate solution
+    options.push_back(make_pair((int)EN_LINSOLVER, (double)EN_PCG));
+    options.push_back(make_pair((int)EN_PCGLIMIT, 1.0));
+    error = run_hydraulics(options, results);
+    BOOST_CHECK(error == 110);
+
+    // Enough iterations for each trial solve the network again
+    options.back().second = 1000.0;
+    error = run_hydraulics(options, results);
+    BOOST_CHECK(error == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_threads, Fixture)
+{
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    // The parallel factorization reproduces the serial one exactly
+    options.push_back(make_pair((int)EN_THREADS, 4.0));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 0.0));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_orderings, Fixture)
+{
+    vector<float> results;
+    Options options;
+    int ordering;
+    BOOST_REQUIRE(error == 0);
+
+    for (ordering = EN_ND; ordering <= EN_AMD; ordering++) {
+        options.clear();
+        options.push_back(make_pair((int)EN_ORDERING, (double)ordering));
+        error = run_hydraulics(options, results);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(check_results(results, reference, 1.e-3));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_chord, Fixture)
+{
+    vector<float> results;
+    Options options;
+    Totals totals;
+    int solver;
+    BOOST_REQUIRE(error == 0);
+
+    // Chord steps end with a trial on a fresh factor, so they converge
+    // to the solution that Newton steps find
+    for (solver = EN_CHOLESKY; solver <= EN_SUPERNODAL; solver++) {
+        options.clear();
+        options.push_back(make_pair((int)EN_LINSOLVER, (double)solver));
+        options.push_back(make_pair((int)EN_CHORDTOL, 0.1));
+        error = run_hydraulics(options, results);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(check_results(results, reference, 1.e-3));
+    }
+
+    // Both solvers reuse their factor at a looser tolerance
+    for (solver = EN_CHOLESKY; solver <= EN_SUPERNODAL; solver++) {
+        options.clear();
+        options.push_back(make_pair((int)EN_LINSOLVER, (double)solver));
+        options.push_back(make_pair((int)EN_CHORDTOL, 1.0));
+        totals[EN_ITERATIONS] = 0.0;
+        totals[EN_FACTORIZATIONS] = 0.0;
+        error = run_totals(DATA_PATH_INP, options, results, totals);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(totals[EN_FACTORIZATIONS] < totals[EN_ITERATIONS]);
+        BOOST_CHECK(check_results(results, reference, 1.e-2));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_mixed_precision, Fixture)
+{
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    // Refinement recovers the double precision heads
+    options.push_back(make_pair((int)EN_MIXEDPRECISION, 1.0));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_skeletonize, Fixture)
+{
+    vector<float> results, refresults;
+    Options options;
+    Totals trials, reftrials;
+    const char *inpfiles[] = {DATA_PATH_NET1, DATA_PATH_GRID};
+    int i, solver;
+    BOOST_REQUIRE(error == 0);
+
+    // Removing series junctions from the matrix leaves the solution unchanged
+    for (solver = EN_CHOLESKY; solver <= EN_SUPERNODAL; solver++) {
+        options.clear();
+        options.push_back(make_pair((int)EN_LINSOLVER, (double)solver));
+        options.push_back(make_pair((int)EN_SKELETONIZE, 1.0));
+        error = run_hydraulics(options, results);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(check_results(results, reference, 1.e-3));
+    }
+
+    // ... and since their elimination is exact it takes no more trials
+    // (compared at the same accuracy)
+    for (i = 0; i < 2; i++) {
+        options.clear();
+        reftrials[EN_ITERATIONS] = 0.0;
+        error = run_totals(inpfiles[i], options, refresults, reftrials);
+        BOOST_REQUIRE(error == 0);
+        options.push_back(make_pair((int)EN_SKELETONIZE, 1.0));
+        trials[EN_ITERATIONS] = 0.0;
+        error = run_totals(inpfiles[i], options, results, trials);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(trials[EN_ITERATIONS] <= reftrials[EN_ITERATIONS]);
+        BOOST_CHECK(check_results(results, refresults, 1.e-3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_factor_update)
+{
+    vector<float> results, reference;
+    Options options;
+    int error, updates;
+
+    // Closing a pipe during a run updates the kept factor
+    error = run_hydraulics(options, reference, "114");
+    BOOST_REQUIRE(error == 0);
+    options.push_back(make_pair((int)EN_CHORDTOL, 0.1));
+    error = run_hydraulics(options, results, "114", &updates);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(updates > 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-2));
+}
+
+BOOST_AUTO_TEST_CASE(test_chord_valves)
+{
+    vector<float> results, reference;
+    Options options;
+    const double chordtols[] = {5.0, 10.0, 50.0, 100.0};
+    int error, i, solver;
+
+    // Pressure controls and valves that keep changing status take
+    // their CBIG coeffs. in and out of the matrix, which the kept
+    // factor must not be updated for (both are solved to a tight
+    // accuracy as in test_predictor)
+    options.push_back(make_pair((int)EN_ACCURACY, 2.e-5));
+    error = run_analysis(DATA_PATH_CONTROLS, options, reference, NULL, NULL,
+        NULL, 0);
+    BOOST_REQUIRE(error == 0);
+    for (solver = EN_CHOLESKY; solver <= EN_SUPERNODAL; solver++) {
+        for (i = 0; i < 4; i++) {
+            options.resize(1);
+            options.push_back(make_pair((int)EN_LINSOLVER, (double)solver));
+            options.push_back(make_pair((int)EN_CHORDTOL, chordtols[i]));
+            error = run_analysis(DATA_PATH_CONTROLS, options, results, NULL,
+                NULL, NULL, 0);
+            BOOST_REQUIRE(error == 0);
+            BOOST_CHECK(check_results(results, reference, 1.e-3));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_solve_demands)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    long t;
+    int error, i, s, solver, nnodes;
+    const int count = 3;
+
+    for (solver = EN_CHOLESKY; solver <= EN_PCG; solver++) {
+        EN_createproject(&ph);
+        error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+        BOOST_REQUIRE(error == 0);
+        error = EN_setoption(ph, EN_LINSOLVER, solver);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+        BOOST_REQUIRE(error == 0);
+        error = EN_openH(ph);
+        BOOST_REQUIRE(error == 0);
+        error = EN_initH(ph, 0);
+        BOOST_REQUIRE(error == 0);
+        error = EN_runH(ph, &t);
+        BOOST_REQUIRE(error == 0);
+
+        // Scenario 0 has the current demands, the others scaled ones
+        vector<EN_API_FLOAT_TYPE> demands(count * nnodes), heads(count * nnodes);
+        vector<EN_API_FLOAT_TYPE> single(nnodes);
+        for (i = 1; i <= nnodes; i++) {
+            error = EN_getnodevalue(ph, i, EN_DEMAND, &v);
+            BOOST_REQUIRE(error == 0);
+            for (s = 0; s < count; s++) demands[s*nnodes + i-1] = v * (1.0 + 0.1*s);
+        }
+        error = EN_solvedemands(ph, count, &demands[0], &heads[0]);
+        BOOST_REQUIRE(error == 0);
+
+        // The current demands reproduce the current heads
+        for (i = 1; i <= nnodes; i++) {
+            error = EN_getnodevalue(ph, i, EN_HEAD, &v);
+            BOOST_REQUIRE(error == 0);
+            BOOST_CHECK(fabs(heads[i-1] - v) < 1.e-2 * (1.0 + fabs(v)));
+        }
+
+        // Each scenario solved on its own gives the same heads
+        for (s = 0; s < count; s++) {
+            error = EN_solvedemands(ph, 1, &demands[s*nnodes], &single[0]);
+            BOOST_REQUIRE(error == 0);
+            for (i = 0; i < nnodes; i++) {
+                BOOST_CHECK(fabs(single[i] - heads[s*nnodes + i]) <
+                    1.e-4 * (1.0 + fabs(single[i])));
+            }
+        }
+
+        EN_closeH(ph);
+        EN_close(ph);
+        EN_deleteproject(&ph);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_forest_core)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v, ncore;
+    int error, njuncs, ntanks;
+
+    // Only the junctions of the network's loops are left in the matrix
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getcount(ph, EN_NODECOUNT, &njuncs);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getcount(ph, EN_TANKCOUNT, &ntanks);
+    BOOST_REQUIRE(error == 0);
+    njuncs -= ntanks;
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getstatistic(ph, EN_CORENODES, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0 && v < njuncs);
+    EN_closeH(ph);
+
+    // Series junctions are removed too when skeletonizing
+    error = EN_setoption(ph, EN_SKELETONIZE, 1.0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getstatistic(ph, EN_CORENODES, &ncore);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(ncore < v);
+    error = EN_setoption(ph, EN_SKELETONIZE, 0.0);
+    BOOST_CHECK(error == 262);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+}
+
+BOOST_AUTO_TEST_CASE(test_blocks)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    vector<float> results[2];
+    int error, i, k, tank, node, link, nnodes, nlinks;
+    long t, tstep;
+    const char *junctions[] = {"31", "32"};
+    const char *pipes[] = {"121", "122"};
+
+    for (k = 0; k <= 1; k++) {
+        EN_createproject(&ph);
+        error = EN_open(ph, "./net1.inp", DATA_PATH_RPT, DATA_PATH_OUT);
+        BOOST_REQUIRE(error == 0);
+
+        // Net1's junctions form a single block ...
+        error = EN_openH(ph);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getstatistic(ph, EN_BLOCKS, &v);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(v == 1.0);
+        EN_closeH(ph);
+
+        // ... until junctions 31 and 32 are fed only from Tank 2
+        error = EN_getnodeindex(ph, (char *)"2", &tank);
+        BOOST_REQUIRE(error == 0);
+        for (i = 0; i < 2; i++) {
+            error = EN_getnodeindex(ph, (char *)junctions[i], &node);
+            BOOST_REQUIRE(error == 0);
+            error = EN_getlinkindex(ph, (char *)pipes[i], &link);
+            BOOST_REQUIRE(error == 0);
+            error = EN_setlinknodes(ph, link, tank, node);
+            BOOST_REQUIRE(error == 0);
+        }
+        error = EN_setoption(ph, EN_BLOCKSOLVE, k);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getcount(ph, EN_LINKCOUNT, &nlinks);
+        BOOST_REQUIRE(error == 0);
+        error = EN_openH(ph);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getstatistic(ph, EN_BLOCKS, &v);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(v == 2.0);
+        error = EN_setoption(ph, EN_BLOCKSOLVE, 0.0);
+        BOOST_CHECK(error == 262);
+
+        error = EN_initH(ph, 0);
+        BOOST_REQUIRE(error == 0);
+        do {
+            error = EN_runH(ph, &t);
+            BOOST_REQUIRE(error == 0);
+            for (i = 1; i <= nnodes; i++) {
+                EN_getnodevalue(ph, i, EN_HEAD, &v);
+                results[k].push_back(v);
+            }
+            for (i = 1; i <= nlinks; i++) {
+                EN_getlinkvalue(ph, i, EN_FLOW, &v);
+                results[k].push_back(v);
+            }
+            error = EN_nextH(ph, &tstep);
+            BOOST_REQUIRE(error == 0);
+        } while (tstep > 0);
+        EN_closeH(ph);
+        EN_close(ph);
+        EN_deleteproject(&ph);
+    }
+
+    // Holding each block once it has converged leaves the solution unchanged
+    BOOST_CHECK(check_results(results[1], results[0], 1.e-3));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_schur, Fixture)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    vector<float> results, serial;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    // The core is split into subdomains joined through a separator
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_SUBDOMAINS, 1.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_LINSOLVER, EN_SCHUR);
+    BOOST_REQUIRE(error == 0);
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getstatistic(ph, EN_SEPARATOR, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    error = EN_setoption(ph, EN_SUBDOMAINS, 2.0);
+    BOOST_CHECK(error == 262);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    options.push_back(make_pair((int)EN_LINSOLVER, (double)EN_SCHUR));
+    error = run_hydraulics(options, serial);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(serial, reference, 1.e-3));
+
+    // Factorizing the subdomains concurrently gives the same results
+    options.push_back(make_pair((int)EN_THREADS, 4.0));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, serial, 0.0));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_nullspace, Fixture)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    long t;
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    // The loop flows of the network are solved for
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_HYDENGINE, 2.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_HYDENGINE, EN_NULLSPACE);
+    BOOST_REQUIRE(error == 0);
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_initH(ph, 0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_runH(ph, &t);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getstatistic(ph, EN_LOOPS, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    error = EN_setoption(ph, EN_HYDENGINE, EN_GGA);
+    BOOST_CHECK(error == 262);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    options.push_back(make_pair((int)EN_HYDENGINE, (double)EN_NULLSPACE));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_simd, Fixture)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    vector<float> results;
+    Options options;
+    BOOST_REQUIRE(error == 0);
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getoption(ph, EN_SIMD, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v == 1.0);
+    error = EN_setoption(ph, EN_SIMD, 2.0);
+    BOOST_CHECK(error == 202);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    // The scalar pipe coeffs. give the same solution as the SIMD
+    // kernels used by default where the CPU has them
+    options.push_back(make_pair((int)EN_SIMD, 0.0));
+    error = run_hydraulics(options, results);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_AUTO_TEST_CASE(test_predictor)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    vector<float> results, reference;
+    Options options;
+    Totals trials, reftrials;
+    int error, order;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_PREDICTOR, 3.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_PREDICTOR, 1.0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_solveH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getstatistic(ph, EN_TRIALSSAVED, &v);
+    BOOST_REQUIRE(error == 0);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    // Starting each period from predicted flows takes fewer trials to
+    // reach the same solution (both are solved to a tight accuracy
+    // since the default one lets either stop well short of it)
+    options.push_back(make_pair((int)EN_ACCURACY, 2.e-5));
+    reftrials[EN_ITERATIONS] = 0.0;
+    error = run_totals(DATA_PATH_GRID, options, reference, reftrials);
+    BOOST_REQUIRE(error == 0);
+    for (order = 1; order <= 2; order++) {
+        options.push_back(make_pair((int)EN_PREDICTOR, (double)order));
+        trials[EN_ITERATIONS] = 0.0;
+        error = run_totals(DATA_PATH_GRID, options, results, trials);
+        options.pop_back();
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(trials[EN_ITERATIONS] < reftrials[EN_ITERATIONS]);
+        BOOST_CHECK(check_results(results, reference, 1.e-3));
+    }
+
+    // Net3's junctions follow several demand patterns, so flows
+    // predicted from its total demand are dropped rather than let
+    // them take more trials
+    reftrials[EN_ITERATIONS] = 0.0;
+    error = run_totals(DATA_PATH_INP, options, reference, reftrials);
+    BOOST_REQUIRE(error == 0);
+    for (order = 1; order <= 2; order++) {
+        options.push_back(make_pair((int)EN_PREDICTOR, (double)order));
+        trials[EN_ITERATIONS] = 0.0;
+        error = run_totals(DATA_PATH_INP, options, results, trials);
+        options.pop_back();
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(trials[EN_ITERATIONS] <= reftrials[EN_ITERATIONS]);
+        BOOST_CHECK(check_results(results, reference, 1.e-3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_step_control)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    vector<float> results, reference;
+    Options options;
+    Totals totals;
+    int error;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_STEPCONTROL, 2.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_STEPCONTROL, 1.0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getoption(ph, EN_STEPCONTROL, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v == 1.0);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    // The first period of the valve grid makes flow steps that raise
+    // the convergence error, and cutting them back converges to the
+    // same solution (both are solved to a tight accuracy as in
+    // test_predictor)
+    options.push_back(make_pair((int)EN_ACCURACY, 2.e-5));
+    error = run_analysis(DATA_PATH_GRID, options, reference, NULL, NULL,
+        NULL, 0);
+    BOOST_REQUIRE(error == 0);
+    options.push_back(make_pair((int)EN_STEPCONTROL, 1.0));
+    totals[EN_STEPCUTS] = 0.0;
+    error = run_totals(DATA_PATH_GRID, options, results, totals);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(totals[EN_STEPCUTS] > 0.0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_AUTO_TEST_CASE(test_flip_limit)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v, flips = 0.0;
+    vector<float> results, reference;
+    Options options;
+    int error, k, nlinks;
+    long t;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_GRID, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_FLIPLIMIT, -1.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_FLIPLIMIT, 2.0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getoption(ph, EN_FLIPLIMIT, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v == 2.0);
+
+    // Links of the valve grid keep reversing status in its first
+    // period, and those that reach the limit are held
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_initH(ph, 0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_runH(ph, &t);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getcount(ph, EN_LINKCOUNT, &nlinks);
+    BOOST_REQUIRE(error == 0);
+    for (k = 1; k <= nlinks; k++) {
+        error = EN_getlinkvalue(ph, k, EN_STATUSFLIPS, &v);
+        BOOST_REQUIRE(error == 0);
+        flips = fmax(flips, v);
+    }
+    BOOST_CHECK(flips >= 2.0);
+    error = EN_getstatistic(ph, EN_HELDLINKS, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    // Holding them finds the same solution (both are solved to a
+    // tight accuracy as in test_predictor)
+    options.push_back(make_pair((int)EN_ACCURACY, 2.e-5));
+    error = run_analysis(DATA_PATH_GRID, options, reference, NULL, NULL,
+        NULL, 0);
+    BOOST_REQUIRE(error == 0);
+    options.push_back(make_pair((int)EN_FLIPLIMIT, 2.0));
+    error = run_analysis(DATA_PATH_GRID, options, results, NULL, NULL,
+        NULL, 0);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_AUTO_TEST_CASE(test_status_lists)
+{
+    EN_ProjectHandle ph[2];
+    EN_API_FLOAT_TYPE v[2];
+    const char *inpfiles[] = {DATA_PATH_GRID, DATA_PATH_INP};
+    int error, f, i, k, nlinks;
+    long t[2], tstep[2];
+
+    // Checking the status of only those links whose status can change
+    // (CVs, pumps, PRVs, PSVs, FCVs and links to tanks) makes the same
+    // status changes in the same trials as checking every link, on the
+    // valve grid and on a network with pumps and tanks
+    for (f = 0; f < 2; f++) {
+        for (i = 0; i < 2; i++) {
+            EN_createproject(&ph[i]);
+            error = EN_open(ph[i], inpfiles[f], DATA_PATH_RPT, "");
+            BOOST_REQUIRE(error == 0);
+        }
+        error = EN_getoption(ph[1], EN_STATUSLISTS, &v[1]);
+        BOOST_REQUIRE(error == 0);
+        BOOST_CHECK(v[1] == 1.0);
+        error = EN_setoption(ph[0], EN_STATUSLISTS, 2.0);
+        BOOST_CHECK(error == 202);
+        error = EN_setoption(ph[0], EN_STATUSLISTS, 0.0);
+        BOOST_REQUIRE(error == 0);
+        error = EN_getcount(ph[0], EN_LINKCOUNT, &nlinks);
+        BOOST_REQUIRE(error == 0);
+        for (i = 0; !error && i < 2; i++) {
+            error = EN_openH(ph[i]);
+            if (!error) error = EN_initH(ph[i], 0);
+        }
+        BOOST_REQUIRE(error == 0);
+        do {
+            for (i = 0; i < 2; i++) {
+                error = EN_runH(ph[i], &t[i]);
+                BOOST_REQUIRE(error == 0);
+            }
+            BOOST_REQUIRE(t[0] == t[1]);
+            for (i = 0; i < 2; i++) {
+                EN_getstatistic(ph[i], EN_ITERATIONS, &v[i]);
+            }
+            BOOST_CHECK(v[0] == v[1]);
+            for (k = 1; k <= nlinks; k++) {
+                for (i = 0; i < 2; i++) {
+                    EN_getlinkvalue(ph[i], k, EN_STATUS, &v[i]);
+                }
+                BOOST_CHECK(v[0] == v[1]);
+                for (i = 0; i < 2; i++) {
+                    EN_getlinkvalue(ph[i], k, EN_FLOW, &v[i]);
+                }
+                BOOST_CHECK(v[0] == v[1]);
+            }
+            for (i = 0; i < 2; i++) {
+                error = EN_nextH(ph[i], &tstep[i]);
+                BOOST_REQUIRE(error == 0);
+            }
+            BOOST_REQUIRE(tstep[0] == tstep[1]);
+        } while (tstep[0] > 0);
+        for (i = 0; i < 2; i++) {
+            EN_closeH(ph[i]);
+            EN_close(ph[i]);
+            EN_deleteproject(&ph[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_solution_cache)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE hits, starts, v;
+    vector<float> results, reference;
+    Options options;
+    Totals totals;
+    long t, tstep, days = 3*24*3600;
+    int error;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_CACHESIZE, -1.0);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_CACHESIZE, 64.0);
+    BOOST_REQUIRE(error == 0);
+    error = EN_settimeparam(ph, EN_DURATION, days);
+    BOOST_REQUIRE(error == 0);
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_CACHESIZE, 32.0);
+    BOOST_CHECK(error == 262);
+    error = EN_getstatistic(ph, EN_CACHEMEMORY, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    error = EN_initH(ph, 0);
+    while (!error) {
+        error = EN_runH(ph, &t);
+        if (!error) error = EN_nextH(ph, &tstep);
+        if (tstep <= 0) break;
+    }
+    BOOST_REQUIRE(error == 0);
+
+    // Later days repeat the demands and link states of the first
+    EN_getstatistic(ph, EN_CACHEHITS, &hits);
+    EN_getstatistic(ph, EN_CACHESTARTS, &starts);
+    BOOST_CHECK(hits + starts > 0.0);
+    EN_getstatistic(ph, EN_CACHEHITRATE, &v);
+    BOOST_CHECK(v > 0.0 && v <= 100.0);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+
+    // Solutions reused as they are leave the valve that a pressure
+    // control set during the solution at that setting, so later
+    // periods find the same heads and flows as without the cache
+    options.push_back(make_pair((int)EN_ACCURACY, 2.e-5));
+    error = run_analysis(DATA_PATH_CONTROLS, options, reference, NULL, NULL,
+        NULL, days);
+    BOOST_REQUIRE(error == 0);
+    options.push_back(make_pair((int)EN_CACHESIZE, 64.0));
+    options.push_back(make_pair((int)EN_CACHETOL, 0.5));
+    totals[EN_CACHEHITS] = 0.0;
+    error = run_totals(DATA_PATH_CONTROLS, options, results, totals, days);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(totals[EN_CACHEHITS] > 0.0);
+    BOOST_CHECK(check_results(results, reference, 1.e-3));
+}
+
+BOOST_AUTO_TEST_CASE(test_option_while_open)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    int error;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+
+    error = EN_setoption(ph, EN_LINSOLVER, EN_SUPERNODAL);
+    BOOST_REQUIRE(error == 0);
+    error = EN_getoption(ph, EN_LINSOLVER, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v == EN_SUPERNODAL);
+
+    // Solver options cannot change while the hydraulic solver is open
+    error = EN_openH(ph);
+    BOOST_REQUIRE(error == 0);
+    error = EN_setoption(ph, EN_LINSOLVER, EN_CHOLESKY);
+    BOOST_CHECK(error == 262);
+
+    error = EN_getstatistic(ph, EN_SOLVERMEMORY, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    error = EN_getstatistic(ph, EN_NONZEROS, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+    error = EN_getstatistic(ph, EN_FACTORFLOPS, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v > 0.0);
+
+    error = EN_setoption(ph, EN_CHORDTOL, 0.1);
+    BOOST_CHECK(error == 262);
+
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+}
+
+BOOST_AUTO_TEST_CASE(test_option_values)
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    const int whole[] = {EN_LINSOLVER, EN_THREADS, EN_ORDERING,
+        EN_MIXEDPRECISION, EN_SKELETONIZE, EN_BLOCKSOLVE, EN_SUBDOMAINS,
+        EN_HYDENGINE, EN_SIMD, EN_PREDICTOR, EN_STEPCONTROL, EN_FLIPLIMIT,
+        EN_CACHESIZE, EN_PCGLIMIT, EN_STATUSLISTS};
+    int error, i;
+
+    EN_createproject(&ph);
+    error = EN_open(ph, DATA_PATH_INP, DATA_PATH_RPT, DATA_PATH_OUT);
+    BOOST_REQUIRE(error == 0);
+
+    // Options that take whole numbers reject fractions and keep
+    // their value
+    for (i = 0; i < (int)(sizeof(whole) / sizeof(int)); i++) {
+        error = EN_setoption(ph, whole[i], 1.5);
+        BOOST_CHECK(error == 213);
+    }
+    error = EN_getoption(ph, EN_LINSOLVER, &v);
+    BOOST_REQUIRE(error == 0);
+    BOOST_CHECK(v == EN_CHOLESKY);
+
+    // The thread count is bounded
+    error = EN_setoption(ph, EN_THREADS, 1.e6);
+    BOOST_CHECK(error == 202);
+    error = EN_setoption(ph, EN_THREADS, 2.0);
+    BOOST_CHECK(error == 0);
+
+    EN_close(ph);
+    EN_deleteproject(&ph);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
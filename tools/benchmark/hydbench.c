@@ -0,0 +1,282 @@
+/*
+*******************************************************************
+
+HYDBENCH.C -- Benchmark of the EPANET hydraulic solution engines.
+
+Usage:  hydbench copies file1.inp [file2.inp ...]
+
+Each network is scaled up by adding copies of all of its nodes,
+links and simple controls to it through the toolkit API, which
+gives a network with several times as many junctions and loops.
+An extended period hydraulic analysis of the scaled network is
+then made with the gradient (GGA) and the null-space (loop flow)
+engines, and for each engine the time taken, the total number of
+trials and the loops of the last solution are reported, together
+with the largest difference between the heads they find.
+
+Rule-based controls are not copied.
+*******************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "epanet2.h"
+
+#define MAXCOPIES 1000
+
+static int  scalenetwork(EN_ProjectHandle ph, int copies);
+static int  copyname(char *id, int copy, char *newid);
+static int  runengine(const char *inpfile, int copies, int engine,
+                      double *secs, int *trials, int *loops,
+                      float **heads, int *nheads);
+
+
+int main(int argc, char *argv[])
+{
+    int i, j, engine, copies, errcode;
+    int trials[2], loops[2], nheads[2];
+    double secs[2], dmax;
+    float *heads[2];
+
+    if (argc < 3)
+    {
+        printf("\nUsage: hydbench copies file1.inp [file2.inp ...]\n");
+        return 1;
+    }
+    copies = atoi(argv[1]);
+    if (copies < 1 || copies > MAXCOPIES)
+    {
+        printf("\nNumber of copies must be between 1 and %d\n", MAXCOPIES);
+        return 1;
+    }
+
+    printf("\n%-24s %8s %10s %10s %8s %8s %12s", "Network", "Engine",
+           "Junctions", "Seconds", "Trials", "Loops", "Max. Diff.");
+    for (i = 2; i < argc; i++)
+    {
+        heads[0] = heads[1] = NULL;
+        for (engine = EN_GGA; engine <= EN_NULLSPACE; engine++)
+        {
+            errcode = runengine(argv[i], copies, engine, &secs[engine],
+                                &trials[engine], &loops[engine],
+                                &heads[engine], &nheads[engine]);
+            if (errcode)
+            {
+                printf("\n%-24s error %d", argv[i], errcode);
+                break;
+            }
+        }
+        if (!errcode && nheads[0] == nheads[1])
+        {
+            dmax = 0.0;
+            for (j = 0; j < nheads[0]; j++)
+            {
+                dmax = fmax(dmax, fabs(heads[1][j] - heads[0][j]));
+            }
+            printf("\n%-24s %8s %10d %10.3f %8d %8s %12s", argv[i], "GGA",
+                   nheads[0], secs[0], trials[0], "-", "-");
+            printf("\n%-24s %8s %10d %10.3f %8d %8d %12.4g", "", "NULLSPACE",
+                   nheads[1], secs[1], trials[1], loops[1], dmax);
+        }
+        free(heads[0]);
+        free(heads[1]);
+    }
+    printf("\n");
+    return 0;
+}
+
+
+int runengine(const char *inpfile, int copies, int engine, double *secs,
+              int *trials, int *loops, float **heads, int *nheads)
+/*
+**--------------------------------------------------------------
+** Input:   inpfile = name of network input file
+**          copies  = number of copies of the network to solve
+**          engine  = hydraulic solution engine
+** Output:  secs   = time taken by the hydraulic analysis
+**          trials = total trials of all time periods
+**          loops  = loops of the last hydraulic solution
+**          heads  = junction heads at the last time period
+**          nheads = number of junctions
+**          returns error code
+** Purpose: runs an extended period hydraulic analysis of a
+**          scaled up network with a given engine
+**--------------------------------------------------------------
+*/
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    int i, type, nnodes, errcode;
+    long t, tstep;
+    clock_t start;
+
+    *trials = 0;
+    *nheads = 0;
+    EN_createproject(&ph);
+    errcode = EN_open(ph, inpfile, "hydbench.rpt", "");
+    if (!errcode) errcode = scalenetwork(ph, copies);
+    if (!errcode) errcode = EN_setoption(ph, EN_HYDENGINE, (EN_API_FLOAT_TYPE)engine);
+    if (!errcode) errcode = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+    if (errcode)
+    {
+        EN_close(ph);
+        EN_deleteproject(&ph);
+        return errcode;
+    }
+
+    // Time the hydraulic analysis
+    start = clock();
+    errcode = EN_openH(ph);
+    if (!errcode) errcode = EN_initH(ph, 0);
+    while (!errcode)
+    {
+        errcode = EN_runH(ph, &t);
+        if (errcode > 100) break;
+        errcode = 0;
+        EN_getstatistic(ph, EN_ITERATIONS, &v);
+        *trials += (int)v;
+        EN_getstatistic(ph, EN_LOOPS, &v);
+        *loops = (int)v;
+        EN_nextH(ph, &tstep);
+        if (tstep <= 0) break;
+    }
+    *secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // Save the junction heads of the last time period
+    *heads = (float *) calloc(nnodes, sizeof(float));
+    if (*heads == NULL) errcode = 101;
+    for (i = 1; !errcode && i <= nnodes; i++)
+    {
+        EN_getnodetype(ph, i, &type);
+        if (type != EN_JUNCTION) continue;
+        EN_getnodevalue(ph, i, EN_HEAD, &v);
+        (*heads)[(*nheads)++] = v;
+    }
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+    return errcode;
+}
+
+
+int scalenetwork(EN_ProjectHandle ph, int copies)
+/*
+**--------------------------------------------------------------
+** Input:   copies = number of copies of the network wanted
+** Output:  returns error code
+** Purpose: adds copies - 1 copies of the network's nodes,
+**          links and simple controls to the network
+**
+** NOTE: nodes are looked up by ID since adding a junction
+**       changes the indexes of the tanks that follow it.
+**--------------------------------------------------------------
+*/
+{
+    static const int nodeprops[] = {EN_ELEVATION, EN_BASEDEMAND, EN_PATTERN,
+        EN_EMITTER, EN_TANKDIAM, EN_MAXLEVEL, EN_MINLEVEL, EN_TANKLEVEL};
+    static const int linkprops[] = {EN_LENGTH, EN_DIAMETER, EN_ROUGHNESS,
+        EN_MINORLOSS, EN_INITSTATUS, EN_INITSETTING};
+    int c, i, p, n1, n2, index, type, curve, errcode = 0;
+    int nnodes, nlinks, ncontrols, ctype, link, node;
+    EN_LinkType ltype;
+    EN_API_FLOAT_TYPE v, setting, level;
+    char id[EN_MAXID+1], newid[EN_MAXID+1];
+    char id1[EN_MAXID+1], id2[EN_MAXID+1];
+    char (*nodeid)[EN_MAXID+1];
+
+    // Save the ID of each original node
+    EN_getcount(ph, EN_NODECOUNT, &nnodes);
+    EN_getcount(ph, EN_LINKCOUNT, &nlinks);
+    EN_getcount(ph, EN_CONTROLCOUNT, &ncontrols);
+    nodeid = calloc(nnodes+1, sizeof(*nodeid));
+    if (nodeid == NULL) return 101;
+    for (i = 1; i <= nnodes; i++) EN_getnodeid(ph, i, nodeid[i]);
+    for (c = 1; !errcode && c < copies; c++)
+    {
+        // Copy each node with its properties
+        for (i = 1; !errcode && i <= nnodes; i++)
+        {
+            EN_getnodeindex(ph, nodeid[i], &node);
+            errcode = copyname(nodeid[i], c, newid);
+            if (!errcode) errcode = EN_getnodetype(ph, node, &type);
+            if (!errcode) errcode = EN_addnode(ph, newid, (EN_NodeType)type);
+            if (errcode) break;
+            EN_getnodeindex(ph, nodeid[i], &node);
+            EN_getnodeindex(ph, newid, &index);
+            for (p = 0; p < (int)(sizeof(nodeprops)/sizeof(int)); p++)
+            {
+                if (type != EN_TANK && p > 3) break;
+                if (type == EN_RESERVOIR && p == 1) continue;
+                if (EN_getnodevalue(ph, node, nodeprops[p], &v)) continue;
+                EN_setnodevalue(ph, index, nodeprops[p], v);
+            }
+        }
+
+        // Copy each link between the copies of its nodes
+        for (i = 1; !errcode && i <= nlinks; i++)
+        {
+            EN_getlinkid(ph, i, id);
+            EN_getlinktype(ph, i, &ltype);
+            EN_getlinknodes(ph, i, &n1, &n2);
+            EN_getnodeid(ph, n1, id1);
+            EN_getnodeid(ph, n2, id2);
+            errcode = copyname(id, c, newid);
+            if (!errcode) errcode = copyname(id1, c, id1);
+            if (!errcode) errcode = copyname(id2, c, id2);
+            if (!errcode) errcode = EN_addlink(ph, newid, ltype, id1, id2);
+            if (errcode) break;
+            EN_getlinkindex(ph, newid, &index);
+            for (p = 0; p < (int)(sizeof(linkprops)/sizeof(int)); p++)
+            {
+                if (EN_getlinkvalue(ph, i, linkprops[p], &v)) continue;
+                EN_setlinkvalue(ph, index, linkprops[p], v);
+            }
+            if (ltype == EN_PUMP && EN_getheadcurveindex(ph, i, &curve) == 0 &&
+                curve > 0) EN_setheadcurveindex(ph, index, curve);
+        }
+
+        // Copy each simple control onto the copies of its link and node
+        for (i = 1; !errcode && i <= ncontrols; i++)
+        {
+            EN_getcontrol(ph, i, &ctype, &link, &setting, &node, &level);
+            EN_getlinkid(ph, link, id);
+            copyname(id, c, newid);
+            EN_getlinkindex(ph, newid, &link);
+            if (node > 0)
+            {
+                EN_getnodeid(ph, node, id);
+                copyname(id, c, newid);
+                EN_getnodeindex(ph, newid, &node);
+            }
+            errcode = EN_addcontrol(ph, &index, ctype, link, setting, node, level);
+        }
+    }
+    free(nodeid);
+    return errcode;
+}
+
+
+int copyname(char *id, int copy, char *newid)
+/*
+**--------------------------------------------------------------
+** Input:   id   = ID name of a node or link
+**          copy = number of the copy
+** Output:  newid = ID name of the copy of the node or link
+**          returns error code
+** Purpose: names the copy of a node or link
+**--------------------------------------------------------------
+*/
+{
+    char name[EN_MAXID+1];
+
+    if (snprintf(name, sizeof(name), "%s_%d", id, copy) >= (int)sizeof(name))
+    {
+        return 252;
+    }
+    strcpy(newid, name);
+    return 0;
+}
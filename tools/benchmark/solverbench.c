@@ -0,0 +1,311 @@
+/*
+*******************************************************************
+
+SOLVERBENCH.C -- Benchmark of the EPANET hydraulic linear solvers.
+
+Usage:  solverbench size [scenarios]
+
+A meshed network of size x size junctions, laid out as a grid of
+pipes fed from a reservoir at one corner, is written to the file
+solverbench.inp. A single period hydraulic analysis of it is then
+made with the column and the supernodal Cholesky solvers, and for
+each the fastest of several timed solutions, the trials and matrix
+factorizations made and the time per factorization are reported,
+together with the largest difference between the heads they find.
+
+If a number of demand scenarios is given, the heads of that many
+scaled sets of the network's demands are then found with a single
+call to EN_solvedemands() and with one call per scenario, and the
+time taken by each is reported.
+*******************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "epanet2.h"
+
+#define INPFILE  "solverbench.inp"
+#define MAXSIZE  1000
+#define REPEATS  5        // timed runs per solver, fastest is kept
+
+static int  writegrid(const char *inpfile, int size);
+static int  runsolver(const char *inpfile, int solver, double *secs,
+                      int *trials, int *factors, float **heads, int *nheads);
+static int  runscenarios(const char *inpfile, int count);
+
+
+int main(int argc, char *argv[])
+{
+    static const char *names[] = {"CHOLESKY", "SUPERNODAL"};
+    static const int solvers[] = {EN_CHOLESKY, EN_SUPERNODAL};
+    int i, j, r, size, count = 0, errcode = 0;
+    int trials[2], factors[2], nheads[2];
+    double secs[2], t, dmax;
+    float *heads[2] = {NULL, NULL};
+
+    if (argc < 2)
+    {
+        printf("\nUsage: solverbench size [scenarios]\n");
+        return 1;
+    }
+    size = atoi(argv[1]);
+    if (argc > 2) count = atoi(argv[2]);
+    if (size < 2 || size > MAXSIZE)
+    {
+        printf("\nGrid size must be between 2 and %d\n", MAXSIZE);
+        return 1;
+    }
+    if (writegrid(INPFILE, size))
+    {
+        printf("\nCould not write %s\n", INPFILE);
+        return 1;
+    }
+
+    printf("\n%-12s %10s %10s %8s %8s %14s %12s", "Solver", "Junctions",
+           "Seconds", "Trials", "Factors", "Secs./Factor", "Max. Diff.");
+    for (i = 0; i < 2; i++)
+    {
+        secs[i] = 0.0;
+        for (r = 0; r < REPEATS && !errcode; r++)
+        {
+            free(heads[i]);
+            errcode = runsolver(INPFILE, solvers[i], &t, &trials[i],
+                                &factors[i], &heads[i], &nheads[i]);
+            if (r == 0 || t < secs[i]) secs[i] = t;
+        }
+        if (errcode)
+        {
+            printf("\n%-12s error %d", names[i], errcode);
+            break;
+        }
+        dmax = 0.0;
+        for (j = 0; i > 0 && j < nheads[i] && j < nheads[0]; j++)
+        {
+            dmax = fmax(dmax, fabs(heads[i][j] - heads[0][j]));
+        }
+        printf("\n%-12s %10d %10.3f %8d %8d %14.5f %12.4g", names[i],
+               nheads[i], secs[i], trials[i], factors[i],
+               factors[i] > 0 ? secs[i] / factors[i] : 0.0, dmax);
+    }
+    printf("\n");
+    free(heads[0]);
+    free(heads[1]);
+
+    if (!errcode && count > 0)
+    {
+        errcode = runscenarios(INPFILE, count);
+        if (errcode) printf("\nScenarios error %d\n", errcode);
+    }
+    return 0;
+}
+
+
+int writegrid(const char *inpfile, int size)
+/*
+**--------------------------------------------------------------
+** Input:   inpfile = name of network input file
+**          size    = number of junctions along a side of grid
+** Output:  returns 1 if file cannot be written, 0 otherwise
+** Purpose: writes the input file of a meshed grid network
+**
+** NOTE:    Elevations and pipe diameters vary over the grid in
+**          a fixed pattern so that every run sees the same
+**          network.
+**--------------------------------------------------------------
+*/
+{
+    static const int diams[] = {6, 8, 10, 12};
+    FILE *f;
+    int i, j, k = 0;
+
+    f = fopen(inpfile, "wt");
+    if (f == NULL) return 1;
+    fprintf(f, "[TITLE]\nSolver benchmark grid\n\n[JUNCTIONS]\n");
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < size; j++)
+        {
+            fprintf(f, "J%d_%d %d %d\n", i, j, 100 + (i * 7 + j * 3) % 20,
+                    (i + j) % 5 ? 1 : 0);
+        }
+    }
+    fprintf(f, "\n[RESERVOIRS]\nR 250\n\n[PIPES]\n");
+    fprintf(f, "P0 R J0_0 100 %d 100\n", 8 * size);
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < size; j++)
+        {
+            if (j > 0) fprintf(f, "P%d J%d_%d J%d_%d 500 %d 100\n", ++k,
+                               i, j-1, i, j, diams[(i + 2*j) % 4]);
+            if (i > 0) fprintf(f, "P%d J%d_%d J%d_%d 500 %d 100\n", ++k,
+                               i-1, j, i, j, diams[(3*i + j) % 4]);
+        }
+    }
+    fprintf(f, "\n[OPTIONS]\nUnits GPM\nHeadloss H-W\n");
+    fprintf(f, "\n[TIMES]\nDuration 0\n\n[REPORT]\nStatus No\nSummary No\n");
+    fprintf(f, "\n[END]\n");
+    fclose(f);
+    return 0;
+}
+
+
+int runsolver(const char *inpfile, int solver, double *secs, int *trials,
+              int *factors, float **heads, int *nheads)
+/*
+**--------------------------------------------------------------
+** Input:   inpfile = name of network input file
+**          solver  = linear equation solver
+** Output:  secs    = time taken by the hydraulic solution
+**          trials  = trials of the hydraulic solution
+**          factors = matrix factorizations made
+**          heads   = junction heads
+**          nheads  = number of junctions
+**          returns error code
+** Purpose: runs a single period hydraulic analysis with a given
+**          linear equation solver
+**--------------------------------------------------------------
+*/
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v;
+    int i, type, nnodes, errcode;
+    long t;
+    clock_t start;
+
+    *secs = 0.0;
+    *nheads = 0;
+    EN_createproject(&ph);
+    errcode = EN_open(ph, inpfile, "solverbench.rpt", "");
+    if (!errcode) errcode = EN_setoption(ph, EN_LINSOLVER, (EN_API_FLOAT_TYPE)solver);
+    if (!errcode) errcode = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+    if (errcode)
+    {
+        EN_close(ph);
+        EN_deleteproject(&ph);
+        return errcode;
+    }
+
+    // Time the hydraulic solution (the matrix is ordered and its
+    // factor's structure found by EN_openH beforehand)
+    errcode = EN_openH(ph);
+    if (!errcode) errcode = EN_initH(ph, 0);
+    start = clock();
+    if (!errcode) errcode = EN_runH(ph, &t);
+    *secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (errcode > 100)
+    {
+        EN_closeH(ph);
+        EN_close(ph);
+        EN_deleteproject(&ph);
+        return errcode;
+    }
+    errcode = 0;
+    EN_getstatistic(ph, EN_ITERATIONS, &v);
+    *trials = (int)v;
+    EN_getstatistic(ph, EN_FACTORIZATIONS, &v);
+    *factors = (int)v;
+
+    // Save the junction heads
+    *heads = (float *) calloc(nnodes, sizeof(float));
+    if (*heads == NULL) errcode = 101;
+    for (i = 1; !errcode && i <= nnodes; i++)
+    {
+        EN_getnodetype(ph, i, &type);
+        if (type != EN_JUNCTION) continue;
+        EN_getnodevalue(ph, i, EN_HEAD, &v);
+        (*heads)[(*nheads)++] = v;
+    }
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+    return errcode;
+}
+
+
+int runscenarios(const char *inpfile, int count)
+/*
+**--------------------------------------------------------------
+** Input:   inpfile = name of network input file
+**          count   = number of demand scenarios
+** Output:  returns error code
+** Purpose: times the solution of several demand scenarios with
+**          a single batched call and with one call for each
+**
+** NOTE:    Scenario s has the network's demands scaled by
+**          1 + 0.01*s.
+**--------------------------------------------------------------
+*/
+{
+    EN_ProjectHandle ph;
+    EN_API_FLOAT_TYPE v, *demands = NULL, *batched = NULL, *single = NULL;
+    int i, s, nnodes, errcode;
+    long t;
+    double secs[2], dmax = 0.0;
+    clock_t start;
+
+    EN_createproject(&ph);
+    errcode = EN_open(ph, inpfile, "solverbench.rpt", "");
+    if (!errcode) errcode = EN_getcount(ph, EN_NODECOUNT, &nnodes);
+    if (!errcode) errcode = EN_openH(ph);
+    if (!errcode) errcode = EN_initH(ph, 0);
+    if (!errcode) errcode = EN_runH(ph, &t);
+    if (errcode > 100) goto DONE;
+    errcode = 0;
+
+    demands = (EN_API_FLOAT_TYPE *) calloc((size_t)count*nnodes,
+                                           sizeof(EN_API_FLOAT_TYPE));
+    batched = (EN_API_FLOAT_TYPE *) calloc((size_t)count*nnodes,
+                                           sizeof(EN_API_FLOAT_TYPE));
+    single = (EN_API_FLOAT_TYPE *) calloc((size_t)count*nnodes,
+                                          sizeof(EN_API_FLOAT_TYPE));
+    if (demands == NULL || batched == NULL || single == NULL)
+    {
+        errcode = 101;
+        goto DONE;
+    }
+    for (i = 1; i <= nnodes; i++)
+    {
+        EN_getnodevalue(ph, i, EN_DEMAND, &v);
+        for (s = 0; s < count; s++)
+        {
+            demands[s*nnodes + i-1] = v * (1.0f + 0.01f*s);
+        }
+    }
+
+    // Solve all scenarios with one factorization ...
+    start = clock();
+    errcode = EN_solvedemands(ph, count, demands, batched);
+    secs[0] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // ... and then with one for each
+    start = clock();
+    for (s = 0; !errcode && s < count; s++)
+    {
+        errcode = EN_solvedemands(ph, 1, demands + s*nnodes,
+                                  single + s*nnodes);
+    }
+    secs[1] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (errcode) goto DONE;
+
+    for (i = 0; i < count*nnodes; i++)
+    {
+        dmax = fmax(dmax, fabs(batched[i] - single[i]));
+    }
+    printf("\n%-12s %10s %10s %12s", "Scenarios", "Calls", "Seconds",
+           "Max. Diff.");
+    printf("\n%-12d %10d %10.3f %12s", count, 1, secs[0], "");
+    printf("\n%-12d %10d %10.3f %12.4g\n", count, count, secs[1], dmax);
+
+DONE:
+    free(demands);
+    free(batched);
+    free(single);
+    EN_closeH(ph);
+    EN_close(ph);
+    EN_deleteproject(&ph);
+    return errcode;
+}